@@ -53,26 +53,25 @@ static bool remoteControlEnable = FALSE;
 static bool startContestSignalA = FALSE;
 
 #if PL_CONFIG_HAS_EVENTS
-void APP_EventHandler(EVNT_Handle event) {
-
-  uint8 dummyValue = 0;
-
-  switch(event) {
-  case EVNT_STARTUP:
+static void APP_OnStartup(EVNT_Handle event) {
     LED1_On(); /* just do something */
 	#if PL_CONFIG_HAS_BUZZER
     BUZ_PlayTune(BUZ_TUNE_WELCOME);
 	#endif
-    break;
+}
 
-  case EVNT_LED_HEARTBEAT:
+static void APP_OnLedHeartbeat(EVNT_Handle event) {
 	  LED1_Neg();
-	  break;
+}
 
 #if PL_CONFIG_HAS_KEYS
 
 #if PL_CONFIG_NOF_KEYS>=1
-  case EVNT_SW1_PRESSED:
+static void APP_OnSw1Pressed(EVNT_Handle event) {
+#if PL_CONFIG_BOARD_IS_REMOTE
+  uint8 dummyValue = 0;
+#endif
+
     LED2_Neg();
 #if PL_CONFIG_HAS_REFLECTANCE
     //REF_CalibrateStartStop(); //added by Kusi
@@ -98,11 +97,15 @@ void APP_EventHandler(EVNT_Handle event) {
 			LCDMenu_OnEvent(LCDMENU_EVENT_DRAW, NULL);
 		#endif
     }
-    break;
+}
 #endif
 
 #if PL_CONFIG_NOF_KEYS>=2
-  case EVNT_SW2_PRESSED:
+static void APP_OnSw2Pressed(EVNT_Handle event) {
+#if PL_CONFIG_BOARD_IS_REMOTE
+  uint8 dummyValue = 0;
+#endif
+
      LED2_Neg();
      //CLS1_SendStr("SW2 pressed\r\n", CLS1_GetStdio()->stdOut);
      SHELL_SendString("SW2 pressed\r\n");  /*\todo disabled shell */
@@ -121,11 +124,15 @@ void APP_EventHandler(EVNT_Handle event) {
     		LCDMenu_OnEvent(LCDMENU_EVENT_DRAW, NULL);
 		#endif
     }
-     break;
+}
 #endif
 
 #if PL_CONFIG_NOF_KEYS>=3
-  case EVNT_SW3_PRESSED:
+static void APP_OnSw3Pressed(EVNT_Handle event) {
+#if PL_CONFIG_BOARD_IS_REMOTE
+  uint8 dummyValue = 0;
+#endif
+
     LED2_Neg();
     //CLS1_SendStr("SW3 pressed\r\n", CLS1_GetStdio()->stdOut);
     SHELL_SendString("SW3 pressed\r\n");  /*\todo disabled shell */
@@ -144,11 +151,15 @@ void APP_EventHandler(EVNT_Handle event) {
 			LCDMenu_OnEvent(LCDMENU_EVENT_DRAW, NULL);
 		#endif
     }
-    break;
+}
 #endif
 
 #if PL_CONFIG_NOF_KEYS>=4
-  case EVNT_SW4_PRESSED:
+static void APP_OnSw4Pressed(EVNT_Handle event) {
+#if PL_CONFIG_BOARD_IS_REMOTE
+  uint8 dummyValue = 0;
+#endif
+
     LED2_Neg();
     //CLS1_SendStr("SW4 pressed\r\n", CLS1_GetStdio()->stdOut);
     SHELL_SendString("SW4 pressed\r\n");  /*\todo disabled shell */
@@ -167,12 +178,16 @@ void APP_EventHandler(EVNT_Handle event) {
 			LCDMenu_OnEvent(LCDMENU_EVENT_DRAW, NULL);
 		#endif
     }
-    break;
+}
 #endif
 
 
 #if PL_CONFIG_NOF_KEYS>=5
-  case EVNT_SW5_PRESSED:
+static void APP_OnSw5Pressed(EVNT_Handle event) {
+#if PL_CONFIG_BOARD_IS_REMOTE
+  uint8 dummyValue = 0;
+#endif
+
     LED2_Neg();
     //CLS1_SendStr("SW5 pressed\r\n", CLS1_GetStdio()->stdOut);
     SHELL_SendString("SW5 pressed\r\n");  /*\todo disabled shell */
@@ -194,11 +209,15 @@ void APP_EventHandler(EVNT_Handle event) {
 //			}
 		#endif
     }
-    break;
+}
 #endif
 
 #if PL_CONFIG_NOF_KEYS>=6
-  case EVNT_SW6_PRESSED:
+static void APP_OnSw6Pressed(EVNT_Handle event) {
+#if PL_CONFIG_BOARD_IS_REMOTE
+  uint8 dummyValue = 0;
+#endif
+
     LED2_Neg();
     //CLS1_SendStr("SW6 pressed\r\n", CLS1_GetStdio()->stdOut);
     SHELL_SendString("SW6 pressed\r\n");  /*\todo disabled shell */
@@ -214,11 +233,15 @@ void APP_EventHandler(EVNT_Handle event) {
 		(void)RAPP_SendPayloadDataBlock(&dummyValue, sizeof(dummyValue), RAPP_MSG_TYPE_REMOTE_DISABLE, RNETA_GetDestAddr(), RPHY_PACKET_FLAGS_NONE);
 		remoteControlEnable = FALSE;
 	#endif
-    break;
+}
 #endif
 
 #if PL_CONFIG_NOF_KEYS>=7
-  case EVNT_SW7_PRESSED:
+static void APP_OnSw7Pressed(EVNT_Handle event) {
+#if PL_CONFIG_BOARD_IS_REMOTE
+  uint8 dummyValue = 0;
+#endif
+
     LED2_Neg();
     //CLS1_SendStr("SW7 pressed\r\n", CLS1_GetStdio()->stdOut);
     SHELL_SendString("SW7 pressed\r\n");  /*\todo disabled shell */
@@ -235,12 +258,51 @@ void APP_EventHandler(EVNT_Handle event) {
 		ContestSendSignal('T');
 		remoteControlEnable = TRUE;
 	#endif
-    break;
+}
 #endif
 #endif /* PL_CONFIG_HAS_KEYS */
 
-    /* \todo extend handler as needed */
-   } /* switch */
+/* handler for each event, registered with the event module */
+static const struct {
+  EVNT_Handle event;
+  EVNT_HandlerFct handler;
+} APP_EventHandlers[] = {
+  {EVNT_STARTUP,        APP_OnStartup},
+  {EVNT_LED_HEARTBEAT,  APP_OnLedHeartbeat},
+#if PL_CONFIG_HAS_KEYS && PL_CONFIG_NOF_KEYS>=1
+  {EVNT_SW1_PRESSED,    APP_OnSw1Pressed},
+#endif
+#if PL_CONFIG_HAS_KEYS && PL_CONFIG_NOF_KEYS>=2
+  {EVNT_SW2_PRESSED,    APP_OnSw2Pressed},
+#endif
+#if PL_CONFIG_HAS_KEYS && PL_CONFIG_NOF_KEYS>=3
+  {EVNT_SW3_PRESSED,    APP_OnSw3Pressed},
+#endif
+#if PL_CONFIG_HAS_KEYS && PL_CONFIG_NOF_KEYS>=4
+  {EVNT_SW4_PRESSED,    APP_OnSw4Pressed},
+#endif
+#if PL_CONFIG_HAS_KEYS && PL_CONFIG_NOF_KEYS>=5
+  {EVNT_SW5_PRESSED,    APP_OnSw5Pressed},
+#endif
+#if PL_CONFIG_HAS_KEYS && PL_CONFIG_NOF_KEYS>=6
+  {EVNT_SW6_PRESSED,    APP_OnSw6Pressed},
+#endif
+#if PL_CONFIG_HAS_KEYS && PL_CONFIG_NOF_KEYS>=7
+  {EVNT_SW7_PRESSED,    APP_OnSw7Pressed},
+#endif
+};
+
+static void APP_RegisterEventHandlers(void) {
+  unsigned int i;
+
+  for(i=0;i<sizeof(APP_EventHandlers)/sizeof(APP_EventHandlers[0]);i++) {
+    EVNT_SetHandler(APP_EventHandlers[i].event, APP_EventHandlers[i].handler);
+  }
+}
+
+/* called for events without a registered handler */
+void APP_EventHandler(EVNT_Handle event) {
+  (void)event; /* \todo extend handler as needed */
 }
 #endif /* PL_CONFIG_HAS_EVENTS */
 
@@ -320,6 +382,7 @@ void APP_Start(void) {
 #endif
   PL_Init();
 #if PL_CONFIG_HAS_EVENTS
+  APP_RegisterEventHandlers();
   EVNT_SetEvent(EVNT_STARTUP);
 #endif
 #if CLS1_DEFAULT_SERIAL
@@ -0,0 +1,228 @@
+/**
+ * \file
+ * \brief Implementation of the data bus between the modules.
+ *
+ * Each topic is a double buffer with a version counter, the same scheme as the set point mailboxes of the drive:
+ * the publisher fills the buffer the consumers are not reading, then switches the index and counts up the version.
+ * As a topic has only one publisher, publishing needs no lock. A consumer copies the current buffer and repeats the copy
+ * if the version has changed in the meantime, so it never sees a half written sample.
+ * Subscribers either get called back by the publisher, or wait on a binary semaphore given by the publisher.
+ */
+
+#include "Platform.h"
+#if PL_CONFIG_HAS_BUS
+#include "Bus.h"
+#include "FRTOS1.h"
+#include "UTIL1.h"
+#if PL_CONFIG_HAS_SHELL
+  #include "CLS1.h"
+#endif
+
+#define BUS_MAX_SUBSCRIBERS       8 /* total number of subscribers over all topics */
+#define BUS_MAX_TOPIC_SUBSCRIBERS 4 /* number of subscribers of a single topic */
+
+struct BUS_Subscriber {
+  BUS_Topic topic;        /* subscribed topic */
+  uint32_t version;       /* version of the last sample seen with BUS_Wait() */
+  BUS_NotifyFct notify;   /* called for every new sample, or NULL */
+  xSemaphoreHandle sem;   /* given for every new sample if there is no callback */
+};
+
+typedef struct {
+  BUS_Sample buf[2];      /* double buffer: the publisher always fills the buffer not pointed to by idx */
+  volatile uint8_t idx;   /* index of the latest published sample */
+  volatile uint32_t version; /* version of the latest published sample */
+  BUS_Subscriber *subs[BUS_MAX_TOPIC_SUBSCRIBERS]; /* subscribers of the topic */
+  volatile uint8_t nofSubs; /* number of entries in subs[] */
+  uint32_t nofNotified;   /* number of notifications sent, for the status */
+} BUS_TopicData;
+
+static BUS_TopicData BUS_topics[BUS_NOF_TOPICS];
+static BUS_Subscriber BUS_subscribers[BUS_MAX_SUBSCRIBERS];
+static uint8_t BUS_nofSubscribers = 0;
+
+BUS_Sample *BUS_Claim(BUS_Topic topic) {
+  BUS_TopicData *t = &BUS_topics[topic];
+
+  return &t->buf[t->idx^1];
+}
+
+void BUS_Publish(BUS_Topic topic) {
+  BUS_TopicData *t = &BUS_topics[topic];
+  BUS_Sample *sample;
+  uint8_t i, n, idx;
+
+  idx = t->idx^1;
+  sample = &t->buf[idx];
+  sample->version = t->version+1;
+  sample->ticks = FRTOS1_xTaskGetTickCount();
+  __asm volatile ("" ::: "memory"); /* buffer is not volatile: fill it before switching the index */
+  t->idx = idx; /* switch first, a consumer which has seen the old version repeats its copy */
+  t->version = sample->version;
+  n = t->nofSubs;
+  for(i=0;i<n;i++) {
+    if (t->subs[i]->notify!=NULL) {
+      t->subs[i]->notify();
+    } else {
+      (void)FRTOS1_xSemaphoreGive(t->subs[i]->sem);
+    }
+  }
+  t->nofNotified += n;
+}
+
+uint32_t BUS_GetVersion(BUS_Topic topic) {
+  return BUS_topics[topic].version;
+}
+
+/* copies the latest sample and returns its version */
+static uint32_t BUS_Copy(BUS_TopicData *t, BUS_Sample *sample) {
+  uint32_t version;
+
+  do {
+    version = t->version;
+    __asm volatile ("" ::: "memory"); /* keep the copy between the two reads of the version */
+    *sample = t->buf[t->idx];
+    __asm volatile ("" ::: "memory");
+  } while (version!=t->version); /* publisher has been active while we were copying: take the newer sample */
+  return version;
+}
+
+bool BUS_Get(BUS_Topic topic, BUS_Sample *sample) {
+  return BUS_Copy(&BUS_topics[topic], sample)!=0;
+}
+
+/* copies the latest sample of a topic if it is newer than the one seen before, and updates lastVersion */
+static bool BUS_Poll(BUS_Topic topic, uint32_t *lastVersion, BUS_Sample *sample) {
+  BUS_TopicData *t = &BUS_topics[topic];
+
+  if (t->version==*lastVersion) {
+    return FALSE; /* nothing new */
+  }
+  *lastVersion = BUS_Copy(t, sample);
+  return TRUE;
+}
+
+uint32_t BUS_GetAgeMs(const BUS_Sample *sample) {
+  return (uint32_t)(FRTOS1_xTaskGetTickCount()-sample->ticks)*portTICK_PERIOD_MS;
+}
+
+BUS_Subscriber *BUS_Subscribe(BUS_Topic topic, BUS_NotifyFct notify) {
+  BUS_TopicData *t = &BUS_topics[topic];
+  BUS_Subscriber *sub = NULL;
+  xSemaphoreHandle sem = NULL;
+
+  if (notify==NULL) {
+    FRTOS1_vSemaphoreCreateBinary(sem);
+    if (sem==NULL) {
+      return NULL;
+    }
+    (void)FRTOS1_xSemaphoreTake(sem, 0); /* empty token */
+  }
+  FRTOS1_taskENTER_CRITICAL();
+  if (BUS_nofSubscribers<BUS_MAX_SUBSCRIBERS && t->nofSubs<BUS_MAX_TOPIC_SUBSCRIBERS) {
+    sub = &BUS_subscribers[BUS_nofSubscribers++];
+    sub->topic = topic;
+    sub->version = t->version; /* only samples published from now on are new */
+    sub->notify = notify;
+    sub->sem = sem;
+    t->subs[t->nofSubs] = sub;
+    t->nofSubs++; /* the entry is complete before the publisher can see it */
+  }
+  FRTOS1_taskEXIT_CRITICAL();
+  if (sub==NULL && sem!=NULL) {
+    FRTOS1_vSemaphoreDelete(sem);
+  }
+  return sub;
+}
+
+bool BUS_Wait(BUS_Subscriber *sub, BUS_Sample *sample, portTickType timeoutTicks) {
+  for(;;) {
+    if (BUS_Poll(sub->topic, &sub->version, sample)) {
+      return TRUE;
+    }
+    /* a token may be left from a sample already read, then we check again */
+    if (sub->sem==NULL || FRTOS1_xSemaphoreTake(sub->sem, timeoutTicks)!=pdTRUE) {
+      return FALSE;
+    }
+  }
+}
+
+#if PL_CONFIG_HAS_SHELL
+static const char *BUS_TopicStr(BUS_Topic topic) {
+  switch(topic) {
+    case BUS_TOPIC_LINE:    return "line";
+    case BUS_TOPIC_WHEELS:  return "wheels";
+    default:                return "unknown";
+  }
+}
+
+static void BUS_PrintHelp(const CLS1_StdIOType *io) {
+  CLS1_SendHelpStr((unsigned char*)"bus", (unsigned char*)"Group of data bus commands\r\n", io->stdOut);
+  CLS1_SendHelpStr((unsigned char*)"  help|status", (unsigned char*)"Shows bus help or status\r\n", io->stdOut);
+}
+
+static void BUS_PrintStatus(const CLS1_StdIOType *io) {
+  unsigned char buf[48], name[12];
+  BUS_Sample sample;
+  BUS_Topic topic;
+
+  CLS1_SendStatusStr((unsigned char*)"bus", (unsigned char*)"\r\n", io->stdOut);
+  for(topic=(BUS_Topic)0;topic<BUS_NOF_TOPICS;topic++) {
+    if (BUS_Get(topic, &sample)) {
+      UTIL1_strcpy(buf, sizeof(buf), (unsigned char*)"v");
+      UTIL1_strcatNum32u(buf, sizeof(buf), sample.version);
+      UTIL1_strcat(buf, sizeof(buf), (unsigned char*)", ");
+      UTIL1_strcatNum32u(buf, sizeof(buf), BUS_GetAgeMs(&sample));
+      UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" ms old, ");
+    } else {
+      UTIL1_strcpy(buf, sizeof(buf), (unsigned char*)"empty, ");
+    }
+    UTIL1_strcatNum8u(buf, sizeof(buf), BUS_topics[topic].nofSubs);
+    UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" subs, ");
+    UTIL1_strcatNum32u(buf, sizeof(buf), BUS_topics[topic].nofNotified);
+    UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" notified\r\n");
+    UTIL1_strcpy(name, sizeof(name), (unsigned char*)"  ");
+    UTIL1_strcat(name, sizeof(name), (unsigned char*)BUS_TopicStr(topic));
+    CLS1_SendStatusStr(name, buf, io->stdOut);
+  }
+}
+
+uint8_t BUS_ParseCommand(const unsigned char *cmd, bool *handled, const CLS1_StdIOType *io) {
+  uint8_t res = ERR_OK;
+
+  if (UTIL1_strcmp((char*)cmd, (char*)CLS1_CMD_HELP)==0 || UTIL1_strcmp((char*)cmd, (char*)"bus help")==0) {
+    BUS_PrintHelp(io);
+    *handled = TRUE;
+  } else if (UTIL1_strcmp((char*)cmd, (char*)CLS1_CMD_STATUS)==0 || UTIL1_strcmp((char*)cmd, (char*)"bus status")==0) {
+    BUS_PrintStatus(io);
+    *handled = TRUE;
+  }
+  return res;
+}
+#endif /* PL_CONFIG_HAS_SHELL */
+
+void BUS_Deinit(void) {
+  uint8_t i;
+
+  for(i=0;i<BUS_nofSubscribers;i++) {
+    if (BUS_subscribers[i].sem!=NULL) {
+      FRTOS1_vSemaphoreDelete(BUS_subscribers[i].sem);
+      BUS_subscribers[i].sem = NULL;
+    }
+  }
+  BUS_nofSubscribers = 0;
+}
+
+void BUS_Init(void) {
+  BUS_Topic topic;
+
+  for(topic=(BUS_Topic)0;topic<BUS_NOF_TOPICS;topic++) {
+    BUS_topics[topic].idx = 0;
+    BUS_topics[topic].version = 0;
+    BUS_topics[topic].nofSubs = 0;
+    BUS_topics[topic].nofNotified = 0;
+  }
+  BUS_nofSubscribers = 0;
+}
+
+#endif /* PL_CONFIG_HAS_BUS */
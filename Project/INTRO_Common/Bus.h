@@ -0,0 +1,117 @@
+/**
+ * \file
+ * \brief Interface to the data bus between the modules.
+ *
+ * A topic holds the latest sample of a producer, e.g. the line position of the reflectance sensors or the wheel speeds.
+ * Every sample carries a version number and the tick count of when it has been published, so a consumer knows
+ * if a value is new and how old it is. Topics are statically allocated and have exactly one publisher.
+ * The publisher writes the sample in place and does not block, consumers either read the latest sample
+ * or subscribe to the topic, and get woken up or called back as soon as a new sample is published.
+ */
+
+#ifndef BUS_H_
+#define BUS_H_
+
+#include "Platform.h"
+#if PL_CONFIG_HAS_BUS
+#include "FRTOS1.h"
+
+#if PL_CONFIG_HAS_SHELL
+#include "CLS1.h"
+/*!
+ * \brief Shell command line parser.
+ * \param[in] cmd Pointer to command string
+ * \param[out] handled If command is handled by the parser
+ * \param[in] io Std I/O handler of shell
+ */
+uint8_t BUS_ParseCommand(const unsigned char *cmd, bool *handled, const CLS1_StdIOType *io);
+#endif
+
+typedef enum {
+  BUS_TOPIC_LINE,     /* line position and kind, published by the reflectance task for every frame */
+  BUS_TOPIC_WHEELS,   /* wheel speeds and positions, published by the drive task for every control cycle */
+  BUS_NOF_TOPICS      /* Sentinel */
+} BUS_Topic;
+
+typedef struct {
+  uint32_t version;   /* number of the sample, counts up with every publication, 0 if nothing has been published */
+  portTickType ticks; /* tick count when the sample has been published */
+  union {
+    struct {
+      uint16_t value; /* line position, REF_MIDDLE_LINE_VALUE is the middle */
+      uint8_t kind;   /* REF_LineKind */
+    } line;
+    struct {
+      int32_t speedLeft, speedRight; /* steps per second */
+      int32_t posLeft, posRight;     /* quadrature counter positions */
+    } wheels;
+  } u;
+} BUS_Sample;
+
+typedef void (*BUS_NotifyFct)(void);
+
+typedef struct BUS_Subscriber BUS_Subscriber;
+
+/*!
+ * \brief Returns the buffer for the next sample of a topic. Only the publisher of the topic may call this.
+ * The sample is filled in place and becomes visible to the consumers with BUS_Publish().
+ * \param topic Topic to publish
+ * \return Pointer to the sample to fill
+ */
+BUS_Sample *BUS_Claim(BUS_Topic topic);
+
+/*!
+ * \brief Publishes the sample filled after BUS_Claim(), and notifies the subscribers. Does not block.
+ * \param topic Topic to publish
+ */
+void BUS_Publish(BUS_Topic topic);
+
+/*!
+ * \brief Returns the version of the latest sample of a topic.
+ * \param topic Topic
+ * \return Version, 0 if nothing has been published yet
+ */
+uint32_t BUS_GetVersion(BUS_Topic topic);
+
+/*!
+ * \brief Copies the latest sample of a topic.
+ * \param topic Topic to read
+ * \param[out] sample Where to store the sample
+ * \return TRUE if there is a sample, FALSE if nothing has been published yet
+ */
+bool BUS_Get(BUS_Topic topic, BUS_Sample *sample);
+
+/*!
+ * \brief Returns the age of a sample.
+ * \param sample Sample
+ * \return Milliseconds since the sample has been published
+ */
+uint32_t BUS_GetAgeMs(const BUS_Sample *sample);
+
+/*!
+ * \brief Subscribes to a topic.
+ * \param topic Topic to subscribe
+ * \param notify Called by the publisher for every new sample, NULL to wait with BUS_Wait() instead.
+ *   Runs in the context of the publisher, so it must not block.
+ * \return Subscriber handle, NULL if there are no free subscribers left
+ */
+BUS_Subscriber *BUS_Subscribe(BUS_Topic topic, BUS_NotifyFct notify);
+
+/*!
+ * \brief Waits for a new sample of the subscribed topic.
+ * \param sub Subscriber handle of a subscription without notification callback
+ * \param[out] sample Where to store the sample
+ * \param timeoutTicks Maximum time to wait
+ * \return TRUE if there is a new sample, FALSE on timeout
+ */
+bool BUS_Wait(BUS_Subscriber *sub, BUS_Sample *sample, portTickType timeoutTicks);
+
+/*! \brief Module de-initialization. */
+void BUS_Deinit(void);
+
+/*! \brief Module initialization. */
+void BUS_Init(void);
+
+#endif /* PL_CONFIG_HAS_BUS */
+
+#endif /* BUS_H_ */
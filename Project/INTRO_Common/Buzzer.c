@@ -22,6 +22,8 @@ typedef struct {
 } BUZ_TrgInfo;
 
 static volatile BUZ_TrgInfo trgInfo;
+static TRG_Handle BUZ_BeepTrigger = TRG_NO_TRIGGER; /* toggles the buzzer */
+static TRG_Handle BUZ_TuneTrigger = TRG_NO_TRIGGER; /* plays the next note of a tune */
 
 typedef struct {
   int freq; /* frequency */
@@ -73,7 +75,7 @@ static void BUZ_Toggle(void *dataPtr) {
   } else {
     trgInfo->buzIterationCntr--;
     BUZ1_NegVal();
-    (void)TRG_SetTrigger(TRG_BUZ_BEEP, trgInfo->buzPeriodTicks, BUZ_Toggle, trgInfo);
+    (void)TRG_SetTrigger(BUZ_BeepTrigger, trgInfo->buzPeriodTicks, BUZ_Toggle, trgInfo);
   }
 }
 
@@ -82,7 +84,7 @@ uint8_t BUZ_Beep(uint16_t freq, uint16_t durationMs) {
     BUZ1_SetVal(); /* turn buzzer on */
     trgInfo.buzPeriodTicks = (1000*TRG_TICKS_MS)/freq;
     trgInfo.buzIterationCntr = durationMs/TRG_TICKS_MS/trgInfo.buzPeriodTicks;
-    return TRG_SetTrigger(TRG_BUZ_BEEP, trgInfo.buzPeriodTicks, BUZ_Toggle, (void*)&trgInfo);
+    return TRG_SetTrigger(BUZ_BeepTrigger, trgInfo.buzPeriodTicks, BUZ_Toggle, (void*)&trgInfo);
   } else {
     return ERR_BUSY;
   }
@@ -94,7 +96,7 @@ static void BUZ_Play(void *dataPtr) {
   BUZ_Beep(melody->melody[melody->idx].freq, melody->melody[melody->idx].ms);
   melody->idx++;
   if (melody->idx<melody->maxIdx) {
-    TRG_SetTrigger(TRG_BUZ_TUNE, melody->melody[melody->idx-1].ms/TRG_TICKS_MS, BUZ_Play, (void*)melody);
+    TRG_SetTrigger(BUZ_TuneTrigger, melody->melody[melody->idx-1].ms/TRG_TICKS_MS, BUZ_Play, (void*)melody);
   }
 }
 
@@ -103,7 +105,7 @@ uint8_t BUZ_PlayTune(BUZ_Tunes tune) {
     return ERR_OVERFLOW;
   }
   BUZ_Melodies[tune].idx = 0; /* reset index */
-  return TRG_SetTrigger(TRG_BUZ_TUNE, 0, BUZ_Play, (void*)&BUZ_Melodies[tune]);
+  return TRG_SetTrigger(BUZ_TuneTrigger, 0, BUZ_Play, (void*)&BUZ_Melodies[tune]);
 }
 
 
@@ -150,12 +152,20 @@ uint8_t BUZ_ParseCommand(const unsigned char *cmd, bool *handled, const CLS1_Std
 #endif /* PL_CONFIG_HAS_SHELL */
 
 void BUZ_Deinit(void) {
-  /* nothing to do */
+  TRG_FreeTrigger(BUZ_TuneTrigger);
+  TRG_FreeTrigger(BUZ_BeepTrigger);
+  BUZ_TuneTrigger = BUZ_BeepTrigger = TRG_NO_TRIGGER;
 }
 
 void BUZ_Init(void) {
   BUZ1_SetVal(); /* turn buzzer off */
   trgInfo.buzPeriodTicks = 0;
   trgInfo.buzIterationCntr = 0;
+  BUZ_BeepTrigger = TRG_AllocTrigger();
+  BUZ_TuneTrigger = TRG_AllocTrigger();
+  if (BUZ_BeepTrigger==TRG_NO_TRIGGER || BUZ_TuneTrigger==TRG_NO_TRIGGER) {
+    for(;;){} /* increase TRG_MAX_TRIGGERS */
+  }
+  TRG_SetRunInIsr(BUZ_BeepTrigger, TRUE); /* toggles the pin, task latency would distort the tone */
 }
 #endif /* PL_CONFIG_HAS_BUZZER */
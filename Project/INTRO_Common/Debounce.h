@@ -46,7 +46,7 @@ typedef struct DBNC_FSMData {
   DBNC_KeyStateKinds state;  /*!< status of the state machine to detect long and short keys */
   DBNC_KeySet scanValue;  /*!< value of keys scanned in */
   uint16_t longKeyCnt; /*!< counting how long we press a key */
-  TRG_TriggerKind trigger; /*!< trigger to be used to iterate through state machine */
+  TRG_Handle trigger; /*!< trigger to be used to iterate through state machine */
   uint16_t debounceTicks; /*!< number of trigger ticks needed for debouncing */
   uint16_t longKeyTicks; /*!< number of trigger ticks needed for long key press */
 } DBNC_FSMData;
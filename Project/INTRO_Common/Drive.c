@@ -10,6 +10,7 @@
 #include "Drive.h"
 #include "FRTOS1.h"
 #include "UTIL1.h"
+#include "Util.h"
 #include "Tacho.h"
 #include "Pid.h"
 #include "Motor.h"
@@ -20,6 +21,9 @@
 #include "Q4CRight.h"
 #include "Shell.h"
 #include "WAIT1.h"
+#if PL_CONFIG_HAS_ODOMETRY
+  #include "Odometry.h"
+#endif
 
 struct {
   DRV_Mode mode;
@@ -29,107 +33,232 @@ struct {
   struct {
     int32_t left, right;
   } pos;
+#if PL_CONFIG_HAS_ODOMETRY
+  struct {
+    int32_t linear, angular; /* mm/s and degree/s */
+    int32_t left, right;     /* resulting wheel speeds in steps/s, separate from the SPEED mode set points */
+  } twist;
+#endif
 } DRV_Status;
 
+#define DRV_CONFIG_SETPOINT_QUEUE  0
+  /*!< 1: pass the set points through the FIFO queue like the mode changes, as it has been before the mailbox.
+   * Used to compare the set point latency of both ways with 'drive status'. */
+
 typedef enum {
   DRV_SET_MODE,
   DRV_SET_SPEED,
   DRV_SET_POS,
+#if PL_CONFIG_HAS_ODOMETRY
+  DRV_SET_TWIST,
+#endif
 } DRV_Commands;
 
+typedef struct {
+  int32_t left, right;
+  portTickType postTicks; /* tick count when the value has been posted, for latency measurement */
+} DRV_Setpoint;
+
+/* Mode changes are passed through a FIFO queue, as the order of them matters */
 typedef struct {
   DRV_Commands cmd;
-  union {
-    DRV_Mode mode; /* DRV_SET_MODE */
-    struct {
-      int32_t left, right;
-    } speed; /* DRV_SET_SPEED */
-   struct {
-      int32_t left, right;
-    } pos; /* DRV_SET_POS */
-  } u;
+  DRV_Mode mode;    /* DRV_SET_MODE */
+#if DRV_CONFIG_SETPOINT_QUEUE
+  DRV_Setpoint sp;  /* all other commands */
+#endif
 } DRV_Command;
 
 #define QUEUE_LENGTH      4 /* number of items in queue, that's my buffer size */
 #define QUEUE_ITEM_SIZE   sizeof(DRV_Command) /* each item is a single drive command */
 static xQueueHandle DRV_Queue;
 
-bool DRV_IsStopped(void) {
-  Q4CLeft_QuadCntrType leftPos;
-  Q4CRight_QuadCntrType rightPos;
+#if !DRV_CONFIG_SETPOINT_QUEUE
+/* Speed and position set points are passed through a 'latest value' mailbox: producers never block
+ * and overwrite the previous value, the drive task only picks up the most recent value. */
+typedef struct {
+  DRV_Setpoint buf[2]; /* double buffer: the writer always fills the buffer not pointed to by idx */
+  volatile uint8_t idx; /* index of the most recent valid buffer */
+  volatile uint32_t seq; /* sequence number, incremented with every new value */
+} DRV_Mailbox;
+
+static DRV_Mailbox DRV_SpeedMailbox, DRV_PosMailbox;
+#if PL_CONFIG_HAS_ODOMETRY
+static DRV_Mailbox DRV_TwistMailbox; /* left is linear, right is angular velocity */
+#endif
+#endif /* !DRV_CONFIG_SETPOINT_QUEUE */
+
+/* latency statistics, from posting a set point until the drive task applies it */
+static struct {
+  portTickType lastTicks, maxTicks; /* latency in ticks */
+  uint32_t nofApplied; /* number of set points applied */
+  uint32_t nofDropped; /* number of set points overwritten before they have been applied */
+} DRV_Latency;
 
-  if (FRTOS1_uxQueueMessagesWaiting(DRV_Queue)>0) {
-    return FALSE; /* still messages in command queue, so there is something pending */
+#if DRV_CONFIG_SETPOINT_QUEUE
+static uint8_t DRV_PostSetpoint(DRV_Commands kind, int32_t left, int32_t right) {
+  DRV_Command cmd;
+
+  cmd.cmd = kind;
+  cmd.mode = DRV_MODE_NONE; /* not used */
+  cmd.sp.left = left;
+  cmd.sp.right = right;
+  cmd.sp.postTicks = FRTOS1_xTaskGetTickCount();
+  if (FRTOS1_xQueueSendToBack(DRV_Queue, &cmd, portMAX_DELAY)!=pdPASS) {
+    return ERR_FAILED;
   }
-  /* do *not* use/calculate speed: too slow! Use position encoder instead */
-  leftPos = Q4CLeft_GetPos();
-  rightPos = Q4CRight_GetPos();
-  if (DRV_Status.mode==DRV_MODE_POS) {
-    if (DRV_Status.pos.left!=(int32_t)leftPos) {
-      return FALSE;
-    }
-    if (DRV_Status.pos.right!=(int32_t)rightPos) {
-      return FALSE;
-    }
-    return TRUE;
-  } if (DRV_Status.mode==DRV_MODE_STOP) {
-    return TRUE;
+  FRTOS1_taskYIELD(); /* yield so drive task has a chance to read message */
+  return ERR_OK;
+}
+#else
+static uint8_t DRV_PostSetpoint(DRV_Commands kind, int32_t left, int32_t right) {
+  DRV_Mailbox *mb;
+  uint8_t idx;
+
+  if (kind==DRV_SET_SPEED) {
+    mb = &DRV_SpeedMailbox;
+  } else if (kind==DRV_SET_POS) {
+    mb = &DRV_PosMailbox;
+#if PL_CONFIG_HAS_ODOMETRY
+  } else if (kind==DRV_SET_TWIST) {
+    mb = &DRV_TwistMailbox;
+#endif
   } else {
-    /* ???? what to do otherwise ???? */
-    return FALSE;
+    return ERR_FAILED;
   }
+  FRTOS1_taskENTER_CRITICAL(); /* only a few instructions, serializes multiple producers */
+  idx = mb->idx^1; /* use the buffer the reader is not using */
+  mb->buf[idx].left = left;
+  mb->buf[idx].right = right;
+  mb->buf[idx].postTicks = FRTOS1_xTaskGetTickCount();
+  __asm volatile ("" ::: "memory"); /* buffer is not volatile: fill it before switching the index */
+  mb->idx = idx;
+  mb->seq++;
+  FRTOS1_taskEXIT_CRITICAL();
+  return ERR_OK; /* does not block, the drive task picks it up with the next control cycle */
 }
 
-uint8_t DRV_Stop(int32_t timeoutMs) {
-  DRV_SetMode(DRV_MODE_STOP); /* stop it */
+/*!
+ * \brief Fetches the latest set point from a mailbox.
+ * \param mb Mailbox to read
+ * \param lastSeq Sequence number of the last value read, gets updated
+ * \param sp Where to store the set point
+ * \return TRUE if there is a new value, FALSE otherwise
+ */
+static bool DRV_FetchSetpoint(DRV_Mailbox *mb, uint32_t *lastSeq, DRV_Setpoint *sp) {
+  uint32_t seq;
+
+  if (mb->seq==*lastSeq) {
+    return FALSE; /* nothing new */
+  }
   do {
-    if (DRV_IsStopped()) {
-      break;
-    }
-    WAIT1_WaitOSms(5);
-    timeoutMs -= 5;
-  } while (timeoutMs>0);
+    seq = mb->seq;
+    __asm volatile ("" ::: "memory"); /* keep the copy between the two reads of seq */
+    *sp = mb->buf[mb->idx];
+    __asm volatile ("" ::: "memory");
+  } while (seq!=mb->seq); /* writer has been active while we were copying: take the newer value */
+  DRV_Latency.nofDropped += seq-*lastSeq-1; /* values we never have seen */
+  *lastSeq = seq;
+  return TRUE;
+}
+#endif /* DRV_CONFIG_SETPOINT_QUEUE */
+
+static void DRV_UpdateLatency(const DRV_Setpoint *sp) {
+  DRV_Latency.lastTicks = FRTOS1_xTaskGetTickCount()-sp->postTicks;
+  if (DRV_Latency.lastTicks>DRV_Latency.maxTicks) {
+    DRV_Latency.maxTicks = DRV_Latency.lastTicks;
+  }
+  DRV_Latency.nofApplied++;
+}
+
+#define DRV_EVENTS_ALL  (DRV_EVENT_STOPPED|DRV_EVENT_POS_REACHED)
+static EventGroupHandle_t DRV_EventGroup; /* completion events, set by the drive task */
+
+static bool match(int32_t pos, int32_t target) {
+  #define MATCH_MARGIN  10
+  return (pos>=target-MATCH_MARGIN && pos<=target+MATCH_MARGIN);
+}
+
+/*!
+ * \brief Evaluates the completion conditions, called by the drive task after processing the commands.
+ * The events are level triggered: they get set while the condition is true and cleared otherwise.
+ */
+static void DRV_UpdateEvents(void) {
+  #define DRV_STOP_SPEED_LOW 50 /* below this speed (steps/sec) we consider the wheel as not moving */
+  int32_t speedL, speedR;
+  EventBits_t set = 0;
+  bool isSlow, inPos;
+
+  speedL = TACHO_GetSpeed(TRUE);
+  speedR = TACHO_GetSpeed(FALSE);
+  isSlow = speedL>-DRV_STOP_SPEED_LOW && speedL<DRV_STOP_SPEED_LOW && speedR>-DRV_STOP_SPEED_LOW && speedR<DRV_STOP_SPEED_LOW;
+  if (DRV_Status.mode==DRV_MODE_POS) {
+    /* do *not* use position reached without low speed: we might just be passing the target */
+    inPos = isSlow && match((int32_t)Q4CLeft_GetPos(), DRV_Status.pos.left) && match((int32_t)Q4CRight_GetPos(), DRV_Status.pos.right);
+  } else {
+    inPos = TRUE; /* nothing to reach */
+  }
+  if (inPos) {
+    set |= DRV_EVENT_POS_REACHED;
+  }
+  if (isSlow && inPos) {
+    set |= DRV_EVENT_STOPPED;
+  }
+  if (set!=0) {
+    (void)FRTOS1_xEventGroupSetBits(DRV_EventGroup, set);
+  }
+  if ((set&DRV_EVENTS_ALL)!=DRV_EVENTS_ALL) {
+    (void)FRTOS1_xEventGroupClearBits(DRV_EventGroup, DRV_EVENTS_ALL&~set);
+  }
+}
+
+uint8_t DRV_WaitForEvent(DRV_Event events, int32_t timeoutMs) {
+  EventBits_t bits;
+
   if (timeoutMs<0) {
+    timeoutMs = 0;
+  }
+  bits = FRTOS1_xEventGroupWaitBits(DRV_EventGroup, (EventBits_t)events, pdFALSE /* do not clear, level triggered */, pdFALSE /* any bit */, timeoutMs/portTICK_PERIOD_MS);
+  if ((bits&(EventBits_t)events)==0) {
     return ERR_BUSY; /* timeout */
   }
   return ERR_OK;
 }
 
+uint8_t DRV_WaitForCycle(int32_t timeoutMs) {
+  EventBits_t bits;
+
+  if (timeoutMs<0) {
+    timeoutMs = 0;
+  }
+  bits = FRTOS1_xEventGroupWaitBits(DRV_EventGroup, DRV_EVENT_CYCLE, pdTRUE /* clear, edge triggered */, pdFALSE, timeoutMs/portTICK_PERIOD_MS);
+  if ((bits&DRV_EVENT_CYCLE)==0) {
+    return ERR_BUSY; /* timeout */
+  }
+  return ERR_OK;
+}
+
+bool DRV_IsStopped(void) {
+  return (FRTOS1_xEventGroupGetBits(DRV_EventGroup)&DRV_EVENT_STOPPED)!=0;
+}
+
+uint8_t DRV_Stop(int32_t timeoutMs) {
+  DRV_SetMode(DRV_MODE_STOP); /* stop it */
+  return DRV_WaitForEvent(DRV_EVENT_STOPPED, timeoutMs);
+}
+
 bool DRV_IsDrivingBackward(void) {
+#if PL_CONFIG_HAS_ODOMETRY
+  if (DRV_Status.mode==DRV_MODE_TWIST) {
+    return DRV_Status.twist.left<0 && DRV_Status.twist.right<0;
+  }
+#endif
   return DRV_Status.mode==DRV_MODE_SPEED
       && DRV_Status.speed.left<0
       && DRV_Status.speed.right<0;
 }
 
-static bool match(int32_t pos, int32_t target) {
-  #define MATCH_MARGIN  10
-  return (pos>=target-MATCH_MARGIN && pos<=target+MATCH_MARGIN);
-}
-
 bool DRV_HasTurned(void) {
-  int32_t pos;
-
-  if (FRTOS1_uxQueueMessagesWaiting(DRV_Queue)>0) {
-    return FALSE; /* still messages in command queue, so there is something pending */
-  }
-  if (DRV_Status.mode==DRV_MODE_POS) {
-    #define DRV_TURN_SPEED_LOW 50
-    int32_t speedL, speedR;
-
-    speedL = TACHO_GetSpeed(TRUE);
-    speedR = TACHO_GetSpeed(FALSE);
-    if (speedL>-DRV_TURN_SPEED_LOW && speedL<DRV_TURN_SPEED_LOW && speedR>-DRV_TURN_SPEED_LOW && speedR<DRV_TURN_SPEED_LOW) { /* speed close to zero */
-      pos = Q4CLeft_GetPos();
-      if (match(pos, DRV_Status.pos.left)) {
-        pos = Q4CRight_GetPos();
-        if (match(pos, DRV_Status.pos.right)) {
-          return TRUE;
-        }
-      }
-    }
-    return FALSE;
-  } /* if */
-  return TRUE;
+  return (FRTOS1_xEventGroupGetBits(DRV_EventGroup)&DRV_EVENT_POS_REACHED)!=0;
 }
 
 DRV_Mode DRV_GetMode(void) {
@@ -140,40 +269,137 @@ uint8_t DRV_SetMode(DRV_Mode mode) {
   DRV_Command cmd;
 
   cmd.cmd = DRV_SET_MODE;
-  cmd.u.mode = mode;
+  cmd.mode = mode;
   if (FRTOS1_xQueueSendToBack(DRV_Queue, &cmd, portMAX_DELAY)!=pdPASS) {
     return ERR_FAILED;
   }
+  /* new command: old completion events are not valid any more. The drive task re-evaluates them after processing the command */
+  (void)FRTOS1_xEventGroupClearBits(DRV_EventGroup, DRV_EVENTS_ALL);
   FRTOS1_taskYIELD(); /* yield so drive task has a chance to read message */
   return ERR_OK;
 }
 
 uint8_t DRV_SetSpeed(int32_t left, int32_t right) {
-  DRV_Command cmd;
-
-  cmd.cmd = DRV_SET_SPEED;
-  cmd.u.speed.left = left;
-  cmd.u.speed.right = right;
-  if (FRTOS1_xQueueSendToBack(DRV_Queue, &cmd, portMAX_DELAY)!=pdPASS) {
+  if (DRV_PostSetpoint(DRV_SET_SPEED, left, right)!=ERR_OK) {
     return ERR_FAILED;
   }
-  FRTOS1_taskYIELD(); /* yield so drive task has a chance to read message */
+  (void)FRTOS1_xEventGroupClearBits(DRV_EventGroup, DRV_EVENTS_ALL);
   return ERR_OK;
 }
 
 uint8_t DRV_SetPos(int32_t left, int32_t right) {
-  DRV_Command cmd;
+  if (DRV_PostSetpoint(DRV_SET_POS, left, right)!=ERR_OK) {
+    return ERR_FAILED;
+  }
+  (void)FRTOS1_xEventGroupClearBits(DRV_EventGroup, DRV_EVENTS_ALL);
+  return ERR_OK;
+}
 
-  cmd.cmd = DRV_SET_POS;
-  cmd.u.pos.left = left;
-  cmd.u.pos.right = right;
-  if (FRTOS1_xQueueSendToBack(DRV_Queue, &cmd, portMAX_DELAY)!=pdPASS) {
+#if PL_CONFIG_HAS_ODOMETRY
+uint8_t DRV_SetTwist(int32_t linearMmSec, int32_t angularDegSec) {
+  if (DRV_PostSetpoint(DRV_SET_TWIST, linearMmSec, angularDegSec)!=ERR_OK) {
     return ERR_FAILED;
   }
-  FRTOS1_taskYIELD(); /* yield so drive task has a chance to read message */
+  (void)FRTOS1_xEventGroupClearBits(DRV_EventGroup, DRV_EVENTS_ALL);
   return ERR_OK;
 }
 
+#define DRV_TWIST_MAX_WHEEL_MM_SEC  600 /* maximum speed of a wheel in twist mode */
+
+/* Velocity ramp with limited acceleration and jerk. The value is kept in 1/1000 units so small
+ * acceleration steps per control period do not get lost. */
+typedef struct {
+  int32_t val;     /* current value, 1/1000 units/s */
+  int32_t acc;     /* current acceleration, units/s^2 */
+  int32_t maxAcc;  /* acceleration limit, units/s^2 */
+  int32_t maxJerk; /* jerk limit, units/s^3, 0 for no jerk limit */
+} DRV_Ramp;
+
+static DRV_Ramp DRV_LinearRamp, DRV_AngularRamp; /* mm/s and degree/s */
+
+static void DRV_RampReset(DRV_Ramp *ramp) {
+  ramp->val = 0;
+  ramp->acc = 0;
+}
+
+/*!
+ * \brief Moves the ramp value one control period towards the target.
+ * \param ramp Ramp to update
+ * \param target Target value, in units/s
+ * \return New value, in units/s
+ */
+static int32_t DRV_RampStep(DRV_Ramp *ramp, int32_t target) {
+  int32_t err, absErr, accDes, jerkStep;
+
+  err = target*1000-ramp->val;
+  absErr = err<0?-err:err;
+  if (absErr<1000 && (ramp->acc==0 || ramp->maxJerk==0)) { /* less than one unit away */
+    ramp->val = target*1000;
+    ramp->acc = 0;
+    return target;
+  }
+  /* highest acceleration we can reduce to zero again before reaching the target: a^2/(2*jerk) <= err */
+  accDes = ramp->maxAcc;
+  if (ramp->maxJerk!=0 && absErr/1000<=(int32_t)(0x7FFFFFFFUL/2/(uint32_t)ramp->maxJerk)) {
+    int32_t accBrake = (int32_t)UTIL_ISqrt(2*(uint32_t)ramp->maxJerk*(uint32_t)(absErr/1000));
+    if (accBrake<accDes) {
+      accDes = accBrake;
+    }
+  }
+  if (err<0) {
+    accDes = -accDes;
+  }
+  if (ramp->maxJerk==0) {
+    ramp->acc = accDes;
+  } else {
+    jerkStep = (ramp->maxJerk*DRV_TASK_PERIOD_MS)/1000;
+    if (jerkStep==0) {
+      jerkStep = 1;
+    }
+    if (ramp->acc<accDes-jerkStep) {
+      ramp->acc += jerkStep;
+    } else if (ramp->acc>accDes+jerkStep) {
+      ramp->acc -= jerkStep;
+    } else {
+      ramp->acc = accDes;
+    }
+  }
+  ramp->val += ramp->acc*DRV_TASK_PERIOD_MS; /* units/s^2 * ms = 1/1000 units/s */
+  if ((err>0 && ramp->val>target*1000) || (err<0 && ramp->val<target*1000)) { /* overshoot */
+    ramp->val = target*1000;
+    ramp->acc = 0;
+  }
+  return ramp->val/1000;
+}
+
+/*!
+ * \brief Calculates the wheel speeds for the twist mode, called by the drive task every control period.
+ * \param speedL Where to store the speed of the left wheel, in steps/s
+ * \param speedR Where to store the speed of the right wheel, in steps/s
+ */
+static void DRV_TwistToWheels(int32_t *speedL, int32_t *speedR) {
+  int32_t linear, angular, rot, absRot, absLin;
+
+  linear = DRV_RampStep(&DRV_LinearRamp, DRV_Status.twist.linear);
+  angular = DRV_RampStep(&DRV_AngularRamp, DRV_Status.twist.angular);
+  /* wheel speed difference due rotation: angular*pi/180*wheelbase/2, pi/360 is about 286/2^15 */
+  rot = (angular*(int32_t)ODO_GetWheelBaseMm()*286)>>15;
+  /* on saturation reduce the linear part first, as the rotation is what keeps us on track */
+  absRot = rot<0?-rot:rot;
+  if (absRot>DRV_TWIST_MAX_WHEEL_MM_SEC) {
+    rot = rot<0?-DRV_TWIST_MAX_WHEEL_MM_SEC:DRV_TWIST_MAX_WHEEL_MM_SEC;
+    absRot = DRV_TWIST_MAX_WHEEL_MM_SEC;
+  }
+  absLin = linear<0?-linear:linear;
+  if (absLin+absRot>DRV_TWIST_MAX_WHEEL_MM_SEC) {
+    linear = linear<0?-(DRV_TWIST_MAX_WHEEL_MM_SEC-absRot):(DRV_TWIST_MAX_WHEEL_MM_SEC-absRot);
+    DRV_LinearRamp.val = linear*1000; /* do not wind up the ramp beyond what we can do */
+  }
+  *speedL = ODO_MmToSteps(linear-rot);
+  *speedR = ODO_MmToSteps(linear+rot);
+}
+#endif /* PL_CONFIG_HAS_ODOMETRY */
+
 #if PL_CONFIG_HAS_SHELL
 uint8_t *DRV_GetModeStr(DRV_Mode mode) {
   switch(mode) {
@@ -181,6 +407,9 @@ uint8_t *DRV_GetModeStr(DRV_Mode mode) {
     case DRV_MODE_STOP:   return (uint8_t*)"STOP";
     case DRV_MODE_SPEED:  return (uint8_t*)"SPEED";
     case DRV_MODE_POS:    return (uint8_t*)"POS";
+#if PL_CONFIG_HAS_ODOMETRY
+    case DRV_MODE_TWIST:  return (uint8_t*)"TWIST";
+#endif
     default: return (uint8_t*)"UNKNOWN";
   }
 }
@@ -188,10 +417,20 @@ uint8_t *DRV_GetModeStr(DRV_Mode mode) {
 static void DRV_PrintHelp(const CLS1_StdIOType *io) {
   CLS1_SendHelpStr((unsigned char*)"drive", (unsigned char*)"Group of drive commands\r\n", io->stdOut);
   CLS1_SendHelpStr((unsigned char*)"  help|status", (unsigned char*)"Shows drive help or status\r\n", io->stdOut);
+#if PL_CONFIG_HAS_ODOMETRY
+  CLS1_SendHelpStr((unsigned char*)"  mode <mode>", (unsigned char*)"Set driving mode (none|stop|speed|pos|twist)\r\n", io->stdOut);
+#else
   CLS1_SendHelpStr((unsigned char*)"  mode <mode>", (unsigned char*)"Set driving mode (none|stop|speed|pos)\r\n", io->stdOut);
+#endif
   CLS1_SendHelpStr((unsigned char*)"  speed <left> <right>", (unsigned char*)"Move left and right motors with given speed\r\n", io->stdOut);
   CLS1_SendHelpStr((unsigned char*)"  pos <left> <right>", (unsigned char*)"Move left and right wheels to given position\r\n", io->stdOut);
   CLS1_SendHelpStr((unsigned char*)"  pos reset", (unsigned char*)"Reset drive and wheel position\r\n", io->stdOut);
+#if PL_CONFIG_HAS_ODOMETRY
+  CLS1_SendHelpStr((unsigned char*)"  twist <mm/s> <deg/s>", (unsigned char*)"Move with linear and angular velocity\r\n", io->stdOut);
+  CLS1_SendHelpStr((unsigned char*)"  twist accel <lin> <ang>", (unsigned char*)"Twist acceleration limits (mm/s^2, deg/s^2)\r\n", io->stdOut);
+  CLS1_SendHelpStr((unsigned char*)"  twist jerk <lin> <ang>", (unsigned char*)"Twist jerk limits (mm/s^3, deg/s^3), 0 for none\r\n", io->stdOut);
+#endif
+  CLS1_SendHelpStr((unsigned char*)"  latency reset", (unsigned char*)"Reset set point latency statistics\r\n", io->stdOut);
 }
 
 static void DRV_PrintStatus(const CLS1_StdIOType *io) {
@@ -225,6 +464,54 @@ static void DRV_PrintStatus(const CLS1_StdIOType *io) {
   UTIL1_strcatNum32s(buf, sizeof(buf), (int32_t)Q4CRight_GetPos());
   UTIL1_strcat(buf, sizeof(buf), (unsigned char*)")\r\n");
   CLS1_SendStatusStr((unsigned char*)"  pos right", buf, io->stdOut);
+
+#if PL_CONFIG_HAS_ODOMETRY
+  UTIL1_Num32sToStr(buf, sizeof(buf), DRV_Status.twist.linear);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" mm/s (curr: ");
+  UTIL1_strcatNum32s(buf, sizeof(buf), DRV_LinearRamp.val/1000);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)")\r\n");
+  CLS1_SendStatusStr((unsigned char*)"  twist lin", buf, io->stdOut);
+
+  UTIL1_Num32sToStr(buf, sizeof(buf), DRV_Status.twist.angular);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" deg/s (curr: ");
+  UTIL1_strcatNum32s(buf, sizeof(buf), DRV_AngularRamp.val/1000);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)")\r\n");
+  CLS1_SendStatusStr((unsigned char*)"  twist ang", buf, io->stdOut);
+
+  UTIL1_Num32sToStr(buf, sizeof(buf), DRV_Status.twist.left);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)", ");
+  UTIL1_strcatNum32s(buf, sizeof(buf), DRV_Status.twist.right);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" steps/sec\r\n");
+  CLS1_SendStatusStr((unsigned char*)"  twist wheels", buf, io->stdOut);
+
+  UTIL1_Num32sToStr(buf, sizeof(buf), DRV_LinearRamp.maxAcc);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" mm/s^2, ");
+  UTIL1_strcatNum32s(buf, sizeof(buf), DRV_AngularRamp.maxAcc);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" deg/s^2\r\n");
+  CLS1_SendStatusStr((unsigned char*)"  twist accel", buf, io->stdOut);
+
+  UTIL1_Num32sToStr(buf, sizeof(buf), DRV_LinearRamp.maxJerk);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" mm/s^3, ");
+  UTIL1_strcatNum32s(buf, sizeof(buf), DRV_AngularRamp.maxJerk);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" deg/s^3\r\n");
+  CLS1_SendStatusStr((unsigned char*)"  twist jerk", buf, io->stdOut);
+#endif
+
+  UTIL1_Num32uToStr(buf, sizeof(buf), DRV_Latency.lastTicks*portTICK_PERIOD_MS);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" ms (max: ");
+  UTIL1_strcatNum32u(buf, sizeof(buf), DRV_Latency.maxTicks*portTICK_PERIOD_MS);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" ms)\r\n");
+  CLS1_SendStatusStr((unsigned char*)"  latency", buf, io->stdOut);
+
+  UTIL1_Num32uToStr(buf, sizeof(buf), DRV_Latency.nofApplied);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" applied, ");
+  UTIL1_strcatNum32u(buf, sizeof(buf), DRV_Latency.nofDropped);
+#if DRV_CONFIG_SETPOINT_QUEUE
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" overwritten (queue)\r\n");
+#else
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" overwritten (mailbox)\r\n");
+#endif
+  CLS1_SendStatusStr((unsigned char*)"  setpoints", buf, io->stdOut);
 }
 
 uint8_t DRV_ParseCommand(const unsigned char *cmd, bool *handled, const CLS1_StdIOType *io) {
@@ -253,12 +540,49 @@ uint8_t DRV_ParseCommand(const unsigned char *cmd, bool *handled, const CLS1_Std
       CLS1_SendStr((unsigned char*)"Wrong argument(s)\r\n", io->stdErr);
       res = ERR_FAILED;
     }
-  } else if (UTIL1_strncmp((char*)cmd, (char*)"drive pos reset", sizeof("drive pos reset")-1)==0) {
-    Q4CLeft_SetPos(0);
-    Q4CRight_SetPos(0);
-    if (DRV_SetPos(0, 0)!=ERR_OK) {
-      CLS1_SendStr((unsigned char*)"failed\r\n", io->stdErr);
+#if PL_CONFIG_HAS_ODOMETRY
+  } else if (UTIL1_strncmp((char*)cmd, (char*)"drive twist accel ", sizeof("drive twist accel ")-1)==0
+          || UTIL1_strncmp((char*)cmd, (char*)"drive twist jerk ", sizeof("drive twist jerk ")-1)==0) {
+    bool isAccel = UTIL1_strncmp((char*)cmd, (char*)"drive twist accel ", sizeof("drive twist accel ")-1)==0;
+
+    p = cmd+(isAccel?sizeof("drive twist accel"):sizeof("drive twist jerk"));
+    if (UTIL1_xatoi(&p, &val1)==ERR_OK && UTIL1_xatoi(&p, &val2)==ERR_OK && val1>=0 && val2>=0 && (!isAccel || (val1>0 && val2>0))) {
+      FRTOS1_taskENTER_CRITICAL();
+      if (isAccel) {
+        DRV_LinearRamp.maxAcc = val1;
+        DRV_AngularRamp.maxAcc = val2;
+      } else {
+        DRV_LinearRamp.maxJerk = val1;
+        DRV_AngularRamp.maxJerk = val2;
+      }
+      FRTOS1_taskEXIT_CRITICAL();
+      *handled = TRUE;
+    } else {
+      CLS1_SendStr((unsigned char*)"Wrong argument(s)\r\n", io->stdErr);
+      res = ERR_FAILED;
     }
+  } else if (UTIL1_strncmp((char*)cmd, (char*)"drive twist ", sizeof("drive twist ")-1)==0) {
+    p = cmd+sizeof("drive twist");
+    if (UTIL1_xatoi(&p, &val1)==ERR_OK && UTIL1_xatoi(&p, &val2)==ERR_OK) {
+      if (DRV_SetTwist(val1, val2)!=ERR_OK) {
+        CLS1_SendStr((unsigned char*)"failed\r\n", io->stdErr);
+      }
+      *handled = TRUE;
+    } else {
+      CLS1_SendStr((unsigned char*)"Wrong argument(s)\r\n", io->stdErr);
+      res = ERR_FAILED;
+    }
+#endif
+  } else if (UTIL1_strcmp((char*)cmd, (char*)"drive latency reset")==0) {
+    FRTOS1_taskENTER_CRITICAL();
+    DRV_Latency.lastTicks = 0;
+    DRV_Latency.maxTicks = 0;
+    DRV_Latency.nofApplied = 0;
+    DRV_Latency.nofDropped = 0;
+    FRTOS1_taskEXIT_CRITICAL();
+    *handled = TRUE;
+  } else if (UTIL1_strncmp((char*)cmd, (char*)"drive pos reset", sizeof("drive pos reset")-1)==0) {
+    DRV_Reset();
     *handled = TRUE;
   } else if (UTIL1_strncmp((char*)cmd, (char*)"drive pos ", sizeof("drive pos ")-1)==0) {
     p = cmd+sizeof("drive pos");
@@ -293,6 +617,12 @@ uint8_t DRV_ParseCommand(const unsigned char *cmd, bool *handled, const CLS1_Std
       if (DRV_SetMode(DRV_MODE_POS)!=ERR_OK) {
         res = ERR_FAILED;
       }
+#if PL_CONFIG_HAS_ODOMETRY
+    } else if (UTIL1_strcmp((char*)p, (char*)"twist")==0) {
+      if (DRV_SetMode(DRV_MODE_TWIST)!=ERR_OK) {
+        res = ERR_FAILED;
+      }
+#endif
     } else {
       res = ERR_FAILED;
     }
@@ -305,6 +635,22 @@ uint8_t DRV_ParseCommand(const unsigned char *cmd, bool *handled, const CLS1_Std
 }
 #endif /* PL_CONFIG_HAS_SHELL */
 
+static void DRV_ApplySetpoint(DRV_Commands kind, const DRV_Setpoint *sp) {
+  if (kind==DRV_SET_SPEED) {
+    DRV_Status.speed.left = sp->left;
+    DRV_Status.speed.right = sp->right;
+  } else if (kind==DRV_SET_POS) {
+    DRV_Status.pos.left = sp->left;
+    DRV_Status.pos.right = sp->right;
+#if PL_CONFIG_HAS_ODOMETRY
+  } else if (kind==DRV_SET_TWIST) {
+    DRV_Status.twist.linear = sp->left;
+    DRV_Status.twist.angular = sp->right;
+#endif
+  }
+  DRV_UpdateLatency(sp);
+}
+
 static uint8_t GetCmd(void) {
   DRV_Command cmd;
   portBASE_TYPE res;
@@ -317,18 +663,58 @@ static uint8_t GetCmd(void) {
   FRTOS1_taskENTER_CRITICAL();
   if (cmd.cmd==DRV_SET_MODE) {
     PID_Start(); /* reset PID, especially integral counters */
-    DRV_Status.mode = cmd.u.mode;
-  } else if (cmd.cmd==DRV_SET_SPEED) {
-    DRV_Status.speed.left = cmd.u.speed.left;
-    DRV_Status.speed.right = cmd.u.speed.right;
-  } else if (cmd.cmd==DRV_SET_POS) {
-    DRV_Status.pos.left = cmd.u.pos.left;
-    DRV_Status.pos.right = cmd.u.pos.right;
+#if PL_CONFIG_HAS_ODOMETRY
+    if (cmd.mode==DRV_MODE_TWIST && DRV_Status.mode!=DRV_MODE_TWIST) {
+      DRV_RampReset(&DRV_LinearRamp); /* ramp up from standstill */
+      DRV_RampReset(&DRV_AngularRamp);
+    }
+#endif
+    DRV_Status.mode = cmd.mode;
+#if DRV_CONFIG_SETPOINT_QUEUE
+  } else {
+    DRV_ApplySetpoint(cmd.cmd, &cmd.sp);
+#endif
   }
   FRTOS1_taskEXIT_CRITICAL();
   return ERR_OK;
 }
 
+static void GetSetpoints(void) {
+#if !DRV_CONFIG_SETPOINT_QUEUE
+  static uint32_t speedSeq = 0, posSeq = 0; /* sequence numbers of last values used */
+#if PL_CONFIG_HAS_ODOMETRY
+  static uint32_t twistSeq = 0;
+#endif
+  DRV_Setpoint sp;
+
+  if (DRV_FetchSetpoint(&DRV_SpeedMailbox, &speedSeq, &sp)) {
+    DRV_ApplySetpoint(DRV_SET_SPEED, &sp);
+  }
+  if (DRV_FetchSetpoint(&DRV_PosMailbox, &posSeq, &sp)) {
+    DRV_ApplySetpoint(DRV_SET_POS, &sp);
+  }
+#if PL_CONFIG_HAS_ODOMETRY
+  if (DRV_FetchSetpoint(&DRV_TwistMailbox, &twistSeq, &sp)) {
+    DRV_ApplySetpoint(DRV_SET_TWIST, &sp);
+  }
+#endif
+#endif /* !DRV_CONFIG_SETPOINT_QUEUE */
+}
+
+/* the tacho samples in the timer interrupt only while the wheels are driven, or until they have come to a stop */
+static void DRV_UpdateSampling(void) {
+  bool idle;
+
+  if (DRV_Status.mode==DRV_MODE_STOP) {
+    idle = TRUE;
+  } else if (DRV_Status.mode==DRV_MODE_NONE) { /* the motors may be driven directly, e.g. by the line following */
+    idle = MOT_GetMotorHandle(MOT_MOTOR_LEFT)->currSpeedPercent==0 && MOT_GetMotorHandle(MOT_MOTOR_RIGHT)->currSpeedPercent==0;
+  } else {
+    idle = FALSE;
+  }
+  TACHO_SetSampling(!(idle && (FRTOS1_xEventGroupGetBits(DRV_EventGroup)&DRV_EVENT_STOPPED)!=0));
+}
+
 static void DriveTask(void *pvParameters) {
   portTickType xLastWakeTime;
 
@@ -336,33 +722,52 @@ static void DriveTask(void *pvParameters) {
   xLastWakeTime = xTaskGetTickCount();
   for(;;) {
     while (GetCmd()==ERR_OK) { /* returns ERR_RXEMPTY if queue is empty */
-      /* process incoming commands */
+      /* process incoming mode changes */
     }
+    GetSetpoints(); /* use the latest speed and position values */
+    DRV_UpdateSampling();
     TACHO_CalcSpeed();
+#if PL_CONFIG_HAS_ODOMETRY
+    ODO_Update();
+#endif
     if (DRV_Status.mode==DRV_MODE_SPEED) {
-      PID_Speed(TACHO_GetSpeed(TRUE), DRV_Status.speed.left, TRUE);
-      PID_Speed(TACHO_GetSpeed(FALSE), DRV_Status.speed.right, FALSE);
+      PID_SpeedSync(TACHO_GetSpeed(TRUE), TACHO_GetSpeed(FALSE), DRV_Status.speed.left, DRV_Status.speed.right,
+          Q4CLeft_GetPos(), Q4CRight_GetPos());
     } else if (DRV_Status.mode==DRV_MODE_STOP) {
       PID_Speed(TACHO_GetSpeed(TRUE), 0, TRUE);
       PID_Speed(TACHO_GetSpeed(FALSE), 0, FALSE);
     } else if (DRV_Status.mode==DRV_MODE_POS) {
       PID_Pos(Q4CLeft_GetPos(), DRV_Status.pos.left, TRUE);
       PID_Pos(Q4CRight_GetPos(), DRV_Status.pos.right, FALSE);
+#if PL_CONFIG_HAS_ODOMETRY
+    } else if (DRV_Status.mode==DRV_MODE_TWIST) {
+      DRV_TwistToWheels(&DRV_Status.twist.left, &DRV_Status.twist.right);
+      PID_SpeedSync(TACHO_GetSpeed(TRUE), TACHO_GetSpeed(FALSE), DRV_Status.twist.left, DRV_Status.twist.right,
+          Q4CLeft_GetPos(), Q4CRight_GetPos());
+#endif
     } else if (DRV_Status.mode==DRV_MODE_NONE) {
       /* do nothing */
     }
-    FRTOS1_vTaskDelayUntil(&xLastWakeTime, 5/portTICK_PERIOD_MS);
+    DRV_UpdateEvents(); /* notify tasks waiting for completion */
+    (void)FRTOS1_xEventGroupSetBits(DRV_EventGroup, DRV_EVENT_CYCLE);
+    FRTOS1_vTaskDelayUntil(&xLastWakeTime, DRV_TASK_PERIOD_MS/portTICK_PERIOD_MS);
   } /* for */
 }
 
 void DRV_Deinit(void) {
   FRTOS1_vQueueDelete(DRV_Queue);
+  FRTOS1_vEventGroupDelete(DRV_EventGroup);
 }
 
 void DRV_Reset(void){
-	Q4CLeft_SetPos(0);
-	Q4CRight_SetPos(0);
-	DRV_SetPos(0, 0);
+  FRTOS1_taskENTER_CRITICAL();
+  Q4CLeft_SetPos(0);
+  Q4CRight_SetPos(0);
+#if PL_CONFIG_HAS_ODOMETRY
+  ODO_SyncEncoders(); /* encoder reset is not a movement */
+#endif
+  FRTOS1_taskEXIT_CRITICAL();
+  (void)DRV_SetPos(0, 0);
 }
 
 void DRV_Init(void) {
@@ -371,11 +776,41 @@ void DRV_Init(void) {
   DRV_Status.speed.right = 0;
   DRV_Status.pos.left = 0;
   DRV_Status.pos.right = 0;
+#if !DRV_CONFIG_SETPOINT_QUEUE
+  DRV_SpeedMailbox.idx = 0;
+  DRV_SpeedMailbox.seq = 0;
+  DRV_PosMailbox.idx = 0;
+  DRV_PosMailbox.seq = 0;
+#if PL_CONFIG_HAS_ODOMETRY
+  DRV_TwistMailbox.idx = 0;
+  DRV_TwistMailbox.seq = 0;
+#endif
+#endif
+#if PL_CONFIG_HAS_ODOMETRY
+  DRV_Status.twist.linear = 0;
+  DRV_Status.twist.angular = 0;
+  DRV_Status.twist.left = 0;
+  DRV_Status.twist.right = 0;
+  DRV_RampReset(&DRV_LinearRamp);
+  DRV_LinearRamp.maxAcc = 1500;   /* mm/s^2 */
+  DRV_LinearRamp.maxJerk = 30000; /* mm/s^3 */
+  DRV_RampReset(&DRV_AngularRamp);
+  DRV_AngularRamp.maxAcc = 3600;   /* deg/s^2 */
+  DRV_AngularRamp.maxJerk = 72000; /* deg/s^3 */
+#endif
+  DRV_Latency.lastTicks = 0;
+  DRV_Latency.maxTicks = 0;
+  DRV_Latency.nofApplied = 0;
+  DRV_Latency.nofDropped = 0;
   DRV_Queue = FRTOS1_xQueueCreate(QUEUE_LENGTH, QUEUE_ITEM_SIZE);
   if (DRV_Queue==NULL) {
     for(;;){} /* out of memory? */
   }
   FRTOS1_vQueueAddToRegistry(DRV_Queue, "Drive");
+  DRV_EventGroup = FRTOS1_xEventGroupCreate();
+  if (DRV_EventGroup==NULL) {
+    for(;;){} /* out of memory? */
+  }
   if (FRTOS1_xTaskCreate(DriveTask, "Drive", configMINIMAL_STACK_SIZE, NULL, tskIDLE_PRIORITY+3, NULL) != pdPASS) {
     for(;;){} /* error */
   }
@@ -30,17 +30,61 @@ typedef enum {
   DRV_MODE_STOP,
   DRV_MODE_SPEED,
   DRV_MODE_POS,
+#if PL_CONFIG_HAS_ODOMETRY
+  DRV_MODE_TWIST, /* linear and angular velocity, with acceleration and jerk limits */
+#endif
 } DRV_Mode;
 
+#define DRV_TASK_PERIOD_MS  5
+  /*!< period of the drive control loop in milliseconds */
+
+/*! \brief Completion events signaled by the drive task, can be or-ed together */
+typedef enum {
+  DRV_EVENT_STOPPED     = (1<<0), /*!< robot is standing still (and at its target position in DRV_MODE_POS) */
+  DRV_EVENT_POS_REACHED = (1<<1), /*!< wheels are at the target position (always set if not in DRV_MODE_POS) */
+  DRV_EVENT_CYCLE       = (1<<2), /*!< a control period has been completed, see DRV_WaitForCycle() */
+} DRV_Event;
+
 uint8_t DRV_SetSpeed(int32_t left, int32_t right);
 uint8_t DRV_SetPos(int32_t left, int32_t right);
 bool DRV_IsDrivingBackward(void);
+
+#if PL_CONFIG_HAS_ODOMETRY
+/*!
+ * \brief Sets the desired linear and angular velocity of the robot, used in DRV_MODE_TWIST.
+ * The drive task converts them into wheel speeds using the odometry calibration (wheel base, steps per meter)
+ * and ramps towards them with limited acceleration and jerk. If a wheel would exceed its maximum speed,
+ * the linear velocity gets reduced first, so the robot still turns as requested.
+ * \param linearMmSec Linear velocity in mm/s, positive is forward
+ * \param angularDegSec Angular velocity in degree/s, positive is counter-clockwise (left turn)
+ * \return Error code, ERR_OK if everything was fine
+ */
+uint8_t DRV_SetTwist(int32_t linearMmSec, int32_t angularDegSec);
+#endif
 uint8_t DRV_SetMode(DRV_Mode mode);
 DRV_Mode DRV_GetMode(void);
 bool DRV_IsStopped(void);
 bool DRV_HasTurned(void);
 void DRV_Reset(void);
 
+/*!
+ * \brief Blocks the calling task until the drive task signals one of the given events.
+ * The events are evaluated by the drive task once per control period, so the caller gets woken up
+ * at most DRV_TASK_PERIOD_MS after the condition is met.
+ * \param events Set of DRV_Event to wait for (any of them)
+ * \param timeoutMs Timeout in milliseconds
+ * \return ERR_OK if the event has been signaled, ERR_BUSY for timeout condition.
+ */
+uint8_t DRV_WaitForEvent(DRV_Event events, int32_t timeoutMs);
+
+/*!
+ * \brief Blocks the calling task until the drive task has completed the next control period,
+ * e.g. to pass a new set point for every period. Only one task should wait for it, as the event is cleared on wake up.
+ * \param timeoutMs Timeout in milliseconds
+ * \return ERR_OK if a control period has been completed, ERR_BUSY for timeout condition.
+ */
+uint8_t DRV_WaitForCycle(int32_t timeoutMs);
+
 /*!
  * \brief Stops the engines
  * \param timoutMs timout in milliseconds for operation
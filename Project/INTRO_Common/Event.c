@@ -6,7 +6,13 @@
  * This module implements a generic event driver. We are using numbered events starting with zero.
  * EVNT_HandleEvent() can be used to process the pending events. Note that the event with the number zero
  * has the highest priority and will be handled first.
- * \tod_o Make this module reentrant and thread safe!
+ *
+ * The events are stored in 32bit words, event zero in the most significant bit of the first word.
+ * A second level word has a bit set for every word with a pending event, so the event with the highest
+ * priority is found with two count leading zeros operations, independent of the number of events (up to 1024).
+ * On the Cortex-M4 the bits are set and cleared with exclusive load/store (LDREX/STREX), so interrupts are
+ * never disabled. The Cortex-M0+ has neither exclusive access nor CLZ: there a very short critical section
+ * is used for the update, and the leading zeros are counted with a binary search.
  */
 
 #include "Platform.h"
@@ -14,89 +20,162 @@
 #include "Event.h" /* our own interface */
 #include "CS1.h"
 
-typedef uint16_t EVNT_MemUnit; /*!< memory unit used to store events flags */
+typedef uint32_t EVNT_MemUnit; /*!< memory unit used to store events flags */
 #define EVNT_MEM_UNIT_NOF_BITS  (sizeof(EVNT_MemUnit)*8)
   /*!< number of bits in memory unit */
+#define EVNT_NOF_MEM_UNITS      (((EVNT_NOF_EVENTS-1)/EVNT_MEM_UNIT_NOF_BITS)+1)
+  /*!< number of memory units, at most EVNT_MEM_UNIT_NOF_BITS */
+#define EVNT_MSB                ((EVNT_MemUnit)1<<(EVNT_MEM_UNIT_NOF_BITS-1))
+
+#define EVNT_UNIT(event)  ((event)/EVNT_MEM_UNIT_NOF_BITS)            /*!< memory unit of the event */
+#define EVNT_MASK(event)  (EVNT_MSB>>((event)%EVNT_MEM_UNIT_NOF_BITS)) /*!< bit of the event in the memory unit */
+
+static volatile EVNT_MemUnit EVNT_Events[EVNT_NOF_MEM_UNITS]; /*!< Bit set of events */
+static volatile EVNT_MemUnit EVNT_Pending; /*!< Bit set of memory units with an event set, first unit is the MSB */
+static EVNT_HandlerFct EVNT_Handlers[EVNT_NOF_EVENTS]; /*!< Handler for each event, or NULL */
+
+#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__) /* Cortex-M3/M4 */
+/* sets bits with exclusive access, returns the previous value */
+static inline EVNT_MemUnit EVNT_AtomicOr(volatile EVNT_MemUnit *addr, EVNT_MemUnit mask) {
+  EVNT_MemUnit old, val;
+  uint32_t failed;
+
+  __asm volatile (
+    "1: ldrex %0, [%3]\n"
+    "   orr %1, %0, %4\n"
+    "   strex %2, %1, [%3]\n"
+    "   cmp %2, #0\n"
+    "   bne 1b\n" /* another access in between: try again */
+    : "=&r" (old), "=&r" (val), "=&r" (failed)
+    : "r" (addr), "r" (mask)
+    : "cc", "memory"
+  );
+  return old;
+}
 
-static EVNT_MemUnit EVNT_Events[((EVNT_NOF_EVENTS-1)/EVNT_MEM_UNIT_NOF_BITS)+1]; /*!< Bit set of events */
-
-#define SET_EVENT(event) \
-  EVNT_Events[(event)/EVNT_MEM_UNIT_NOF_BITS] |= (1<<(EVNT_MEM_UNIT_NOF_BITS-1))>>(((event)%EVNT_MEM_UNIT_NOF_BITS)) /*!< Set the event */
-#define CLR_EVENT(event) \
-  EVNT_Events[(event)/EVNT_MEM_UNIT_NOF_BITS] &= ~((1<<(EVNT_MEM_UNIT_NOF_BITS-1))>>(((event)%EVNT_MEM_UNIT_NOF_BITS))) /*!< Clear the event */
-#define GET_EVENT(event) \
-  (bool)(EVNT_Events[(event)/EVNT_MEM_UNIT_NOF_BITS]&((1<<(EVNT_MEM_UNIT_NOF_BITS-1))>>(((event)%EVNT_MEM_UNIT_NOF_BITS)))) /*!< Return TRUE if event is set */
+/* keeps the bits of the mask with exclusive access, returns the previous value */
+static inline EVNT_MemUnit EVNT_AtomicAnd(volatile EVNT_MemUnit *addr, EVNT_MemUnit mask) {
+  EVNT_MemUnit old, val;
+  uint32_t failed;
+
+  __asm volatile (
+    "1: ldrex %0, [%3]\n"
+    "   and %1, %0, %4\n"
+    "   strex %2, %1, [%3]\n"
+    "   cmp %2, #0\n"
+    "   bne 1b\n" /* another access in between: try again */
+    : "=&r" (old), "=&r" (val), "=&r" (failed)
+    : "r" (addr), "r" (mask)
+    : "cc", "memory"
+  );
+  return old;
+}
 
-void EVNT_SetEvent(EVNT_Handle event) {
-  //* \tod_o Make it reentrant */
+#define EVNT_CountLeadingZeros(val)  ((uint8_t)__builtin_clz(val)) /* CLZ instruction, val must not be zero */
+#else /* Cortex-M0+ */
+static EVNT_MemUnit EVNT_AtomicOr(volatile EVNT_MemUnit *addr, EVNT_MemUnit mask) {
+  EVNT_MemUnit old;
   CS1_CriticalVariable();
-  CS1_EnterCritical();
-
-  SET_EVENT(event);
 
+  CS1_EnterCritical();
+  old = *addr;
+  *addr = old|mask;
   CS1_ExitCritical();
+  return old;
 }
 
-void EVNT_ClearEvent(EVNT_Handle event) {
-  /* \tod_o Make it reentrant */
+static EVNT_MemUnit EVNT_AtomicAnd(volatile EVNT_MemUnit *addr, EVNT_MemUnit mask) {
+  EVNT_MemUnit old;
   CS1_CriticalVariable();
+
   CS1_EnterCritical();
+  old = *addr;
+  *addr = old&mask;
+  CS1_ExitCritical();
+  return old;
+}
 
-  CLR_EVENT(event);
+/* val must not be zero */
+static uint8_t EVNT_CountLeadingZeros(EVNT_MemUnit val) {
+  uint8_t n = 0;
 
-  CS1_ExitCritical();
+  if ((val&0xFFFF0000)==0) { n += 16; val <<= 16; }
+  if ((val&0xFF000000)==0) { n += 8;  val <<= 8; }
+  if ((val&0xF0000000)==0) { n += 4;  val <<= 4; }
+  if ((val&0xC0000000)==0) { n += 2;  val <<= 2; }
+  if ((val&0x80000000)==0) { n += 1; }
+  return n;
 }
+#endif
 
-bool EVNT_EventIsSet(EVNT_Handle event) {
-  /* \tod_o Make it reentrant */
-  bool res;
-  CS1_CriticalVariable();
-  CS1_EnterCritical();
+/* the memory unit has no event left: clear it in the pending set */
+static void EVNT_UnitCleared(uint8_t unit) {
+  (void)EVNT_AtomicAnd(&EVNT_Pending, ~(EVNT_MSB>>unit));
+  if (EVNT_Events[unit]!=0) { /* an event has been set in the meantime */
+    (void)EVNT_AtomicOr(&EVNT_Pending, EVNT_MSB>>unit);
+  }
+}
 
-  res = GET_EVENT(event);
+/* clears an event, returns TRUE if it has been set */
+static bool EVNT_Clear(EVNT_Handle event) {
+  EVNT_MemUnit old;
 
-  CS1_ExitCritical();
+  old = EVNT_AtomicAnd(&EVNT_Events[EVNT_UNIT(event)], ~EVNT_MASK(event));
+  if ((old&~EVNT_MASK(event))==0) {
+    EVNT_UnitCleared(EVNT_UNIT(event));
+  }
+  return (old&EVNT_MASK(event))!=0;
+}
 
-  return res;
+void EVNT_SetEvent(EVNT_Handle event) {
+  (void)EVNT_AtomicOr(&EVNT_Events[EVNT_UNIT(event)], EVNT_MASK(event));
+  (void)EVNT_AtomicOr(&EVNT_Pending, EVNT_MSB>>EVNT_UNIT(event)); /* after the event, so it is found */
 }
 
-bool EVNT_EventIsSetAutoClear(EVNT_Handle event) {
-  bool res;
-  /* \tod_o Make it reentrant */
-  CS1_CriticalVariable();
-  CS1_EnterCritical();
+void EVNT_ClearEvent(EVNT_Handle event) {
+  (void)EVNT_Clear(event);
+}
 
-  res = GET_EVENT(event);
-  if (res) {
-    CLR_EVENT(event); /* automatically clear event */
-  }
+bool EVNT_EventIsSet(EVNT_Handle event) {
+  return (EVNT_Events[EVNT_UNIT(event)]&EVNT_MASK(event))!=0; /* single read, no lock needed */
+}
 
-  CS1_ExitCritical();
-  return res;
+bool EVNT_EventIsSetAutoClear(EVNT_Handle event) {
+  return EVNT_Clear(event); /* automatically clear event */
+}
+
+void EVNT_SetHandler(EVNT_Handle event, EVNT_HandlerFct handler) {
+  EVNT_Handlers[event] = handler;
 }
 
 void EVNT_HandleEvent(void (*callback)(EVNT_Handle), bool clearEvent) {
-   /* Handle the one with the highest priority. Zero is the event with the highest priority. */
-   EVNT_Handle event;
-   CS1_CriticalVariable();
-   /* \tod_o Make it reentrant */
-   CS1_EnterCritical();
-   for (event=(EVNT_Handle)0; event<EVNT_NOF_EVENTS; event++) { /* does a test on every event */
-     if (GET_EVENT(event)) { /* event present? */
-       if (clearEvent) {
-         CLR_EVENT(event); /* clear event */
-       }
-       break; /* get out of loop */
-     }
-   }
-   CS1_ExitCritical();
-
-   if (event != EVNT_NOF_EVENTS) {
-     callback(event);
-     /* Note: if the callback sets the event, we will get out of the loop.
-      * We will catch it by the next iteration.
-      */
-   }
+  /* Handle the one with the highest priority. Zero is the event with the highest priority. */
+  EVNT_MemUnit pending, events;
+  EVNT_Handle event;
+  uint8_t unit;
+
+  for(;;) {
+    pending = EVNT_Pending;
+    if (pending==0) {
+      return; /* no event */
+    }
+    unit = EVNT_CountLeadingZeros(pending);
+    events = EVNT_Events[unit];
+    if (events!=0) {
+      break;
+    }
+    EVNT_UnitCleared(unit); /* all events of the unit have been cleared in the meantime */
+  }
+  event = (EVNT_Handle)(unit*EVNT_MEM_UNIT_NOF_BITS+EVNT_CountLeadingZeros(events));
+  if (clearEvent) {
+    (void)EVNT_Clear(event);
+  }
+  if (EVNT_Handlers[event]!=NULL) {
+    EVNT_Handlers[event](event);
+  } else if (callback!=NULL) {
+    callback(event);
+  }
+  /* Note: if the handler sets the event again, we will catch it by the next iteration. */
 }
 
 void EVNT_Init(void) {
@@ -107,6 +186,8 @@ void EVNT_Init(void) {
     EVNT_Events[i] = 0; /* initialize data structure */
     i++;
   } while(i<sizeof(EVNT_Events)/sizeof(EVNT_Events[0]));
+  EVNT_Pending = 0;
+  /* the handlers are kept, they are registered once by the application */
 }
 
 void EVNT_Deinit(void) {
@@ -5,7 +5,8 @@
  *
  * This module implements a generic event driver. We are using numbered events starting with zero.
  * EVNT_HandleEvent() can be used to process the pending events. Note that the event with the number zero
- * has the highest priority and will be handled first
+ * has the highest priority and will be handled first. A handler can be registered for each event,
+ * the callback of EVNT_HandleEvent() is only used for events without a handler.
  */
 
 #ifndef EVENT_H_
@@ -67,8 +68,18 @@ typedef enum EVNT_Handle {
   EVNT_NOF_EVENTS       /*!< Must be last one! */
 } EVNT_Handle;
 
+/*! \brief Handler for an event, the event handle is passed as argument. */
+typedef void (*EVNT_HandlerFct)(EVNT_Handle event);
+
+/*!
+ * \brief Registers the handler for an event.
+ * \param[in] event The handle of the event.
+ * \param[in] handler Handler to be called by EVNT_HandleEvent(), or NULL to use the callback.
+ */
+void EVNT_SetHandler(EVNT_Handle event, EVNT_HandlerFct handler);
+
 /*!
- * \brief Sets an event.
+ * \brief Sets an event. Can be called from interrupts.
  * \param[in] event The handle of the event to set.
  */
 void EVNT_SetEvent(EVNT_Handle event);
@@ -94,8 +105,8 @@ bool EVNT_EventIsSet(EVNT_Handle event);
 bool EVNT_EventIsSetAutoClear(EVNT_Handle event);
 
 /*!
- * \brief Routine to check if an event is pending. If an event is pending, the event is cleared and the provided callback is called.
- * \param[in] callback Callback routine to be called. The event handle is passed as argument to the callback.
+ * \brief Routine to check if an event is pending. If an event is pending, the event is cleared and its handler is called.
+ * \param[in] callback Callback routine to be called for events without a registered handler, or NULL. The event handle is passed as argument to the callback.
  * \param[in] clearEvent If TRUE, it will clear the event in the EVNT_HandleEvent(), otherwise not.
  */
 void EVNT_HandleEvent(void (*callback)(EVNT_Handle), bool clearEvent);
@@ -0,0 +1,229 @@
+/**
+ * \file
+ * \brief Implementation of the junction detection.
+ *
+ * For every reflectance frame the odometry distance, the mask of sensors seeing a line and the line kind are stored in a ring buffer.
+ * A side line is seen if the outer sensors and the sensors up to the middle see the line, which is wider than a line in a curve.
+ * Once the sensors have passed the side lines, the frames of the last few centimetres tell which branches there are,
+ * and the current frame tells if the line continues straight. As the sensors are in front of the wheel axle,
+ * this is known before the robot reaches the middle of the junction, so a turn can start without stopping to probe the junction.
+ */
+
+#include "Platform.h"
+#if PL_CONFIG_HAS_LINE_JUNCTION
+#include "Junction.h"
+#include "Odometry.h"
+#include "FRTOS1.h"
+#include "UTIL1.h"
+#if PL_CONFIG_HAS_SHELL
+  #include "CLS1.h"
+#endif
+
+#define JCT_HISTORY_SIZE     16   /* number of frames in the history, power of two */
+#define JCT_WINDOW_MM        60   /* frames within this distance are used for the classification */
+#define JCT_FINISH_MM        30   /* black area longer than this is not a side line */
+#define JCT_SENSOR_AXLE_MM   40   /* distance between sensors and wheel axle */
+#define JCT_MIN_STEP_UM      1000 /* frames closer than this are merged, e.g. while standing */
+
+#define JCT_ALL_SENSORS      ((1<<REF_NOF_SENSORS)-1)
+#define JCT_LEFT_ARM         ((1<<(REF_NOF_SENSORS/2+1))-1)                    /* left sensors up to the middle see the line */
+#define JCT_RIGHT_ARM        (JCT_ALL_SENSORS&~((1<<(REF_NOF_SENSORS/2-1))-1)) /* right sensors up to the middle see the line */
+
+typedef struct {
+  int32_t distUm; /* odometry distance of the frame */
+  uint8_t mask;   /* sensors seeing a line, bit 0 is the leftmost sensor */
+  uint8_t kind;   /* REF_LineKind of the frame */
+} JCT_Entry;
+
+static JCT_Entry JCT_history[JCT_HISTORY_SIZE];
+static uint8_t JCT_head = 0;       /* index of the newest entry */
+static uint8_t JCT_nofEntries = 0; /* number of valid entries */
+
+unsigned char *JCT_KindStr(JCT_Kind kind) {
+  switch(kind) {
+    case JCT_NONE:           return (unsigned char*)"NONE";
+    case JCT_PENDING:        return (unsigned char*)"PENDING";
+    case JCT_LEFT:           return (unsigned char*)"LEFT";
+    case JCT_RIGHT:          return (unsigned char*)"RIGHT";
+    case JCT_LEFT_STRAIGHT:  return (unsigned char*)"LEFT_STRAIGHT";
+    case JCT_RIGHT_STRAIGHT: return (unsigned char*)"RIGHT_STRAIGHT";
+    case JCT_T:              return (unsigned char*)"T";
+    case JCT_CROSS:          return (unsigned char*)"CROSS";
+    case JCT_END:            return (unsigned char*)"END";
+    case JCT_FINISH:         return (unsigned char*)"FINISH";
+    default:                 return (unsigned char*)"UNKNOWN";
+  }
+}
+
+void JCT_AddFrame(uint8_t mask, REF_LineKind kind) {
+  int32_t dist;
+
+  dist = ODO_GetDistanceUm();
+  FRTOS1_taskENTER_CRITICAL();
+  if (JCT_nofEntries>0 && dist<JCT_history[JCT_head].distUm) { /* odometry reset, or moving backward */
+    JCT_nofEntries = 0;
+  }
+  if (JCT_nofEntries>0 && dist-JCT_history[JCT_head].distUm<JCT_MIN_STEP_UM) { /* same position: merge */
+    JCT_history[JCT_head].mask |= mask;
+    JCT_history[JCT_head].kind = kind;
+  } else {
+    JCT_head = (JCT_head+1)&(JCT_HISTORY_SIZE-1);
+    JCT_history[JCT_head].distUm = dist;
+    JCT_history[JCT_head].mask = mask;
+    JCT_history[JCT_head].kind = kind;
+    if (JCT_nofEntries<JCT_HISTORY_SIZE) {
+      JCT_nofEntries++;
+    }
+  }
+  FRTOS1_taskEXIT_CRITICAL();
+}
+
+/* copies the history, newest entry first, and returns the number of entries */
+static uint8_t JCT_GetHistory(JCT_Entry hist[JCT_HISTORY_SIZE]) {
+  uint8_t i, n;
+
+  FRTOS1_taskENTER_CRITICAL();
+  n = JCT_nofEntries;
+  for(i=0;i<n;i++) {
+    hist[i] = JCT_history[(JCT_head-i)&(JCT_HISTORY_SIZE-1)];
+  }
+  FRTOS1_taskEXIT_CRITICAL();
+  return n;
+}
+
+static bool JCT_IsArm(uint8_t mask) {
+  return (mask&JCT_LEFT_ARM)==JCT_LEFT_ARM || (mask&JCT_RIGHT_ARM)==JCT_RIGHT_ARM;
+}
+
+JCT_Kind JCT_Classify(int32_t *distUm) {
+  JCT_Entry hist[JCT_HISTORY_SIZE];
+  uint8_t i, n;
+  int32_t newest, first, last;
+  bool left, right, found;
+  JCT_Kind kind;
+
+  if (distUm!=NULL) {
+    *distUm = 0;
+  }
+  n = JCT_GetHistory(hist);
+  if (n==0) {
+    return JCT_NONE;
+  }
+  newest = hist[0].distUm;
+  if (JCT_IsArm(hist[0].mask)) { /* sensors are over the side lines */
+    if (hist[0].mask==JCT_ALL_SENSORS) {
+      for(i=1;i<n && hist[i].mask==JCT_ALL_SENSORS;i++) {
+        /* find start of black area */
+      }
+      if (newest-hist[i-1].distUm>=JCT_FINISH_MM*1000) {
+        return JCT_FINISH;
+      }
+    }
+    return JCT_PENDING;
+  }
+  /* sensors have passed: look for side lines in the frames before */
+  left = right = found = FALSE;
+  first = last = newest;
+  for(i=1;i<n && newest-hist[i].distUm<=JCT_WINDOW_MM*1000;i++) {
+    if ((hist[i].mask&JCT_LEFT_ARM)==JCT_LEFT_ARM) {
+      left = TRUE;
+    }
+    if ((hist[i].mask&JCT_RIGHT_ARM)==JCT_RIGHT_ARM) {
+      right = TRUE;
+    }
+    if (JCT_IsArm(hist[i].mask)) {
+      if (!found) {
+        last = hist[i].distUm;
+        found = TRUE;
+      }
+      first = hist[i].distUm;
+    }
+  }
+  if (!found) { /* no side lines: plain line or end of line */
+    if (hist[0].mask!=0) {
+      return JCT_NONE;
+    }
+    for(i=1;i<n && hist[i].mask==0;i++) {
+      /* find last frame with a line */
+    }
+    if (i<n) {
+      first = last = hist[i].distUm;
+    }
+    kind = JCT_END;
+  } else if (hist[0].mask!=0) { /* line continues */
+    kind = (left&&right)?JCT_CROSS:(left?JCT_LEFT_STRAIGHT:JCT_RIGHT_STRAIGHT);
+  } else {
+    kind = (left&&right)?JCT_T:(left?JCT_LEFT:JCT_RIGHT);
+  }
+  if (distUm!=NULL) {
+    *distUm = (first+last)/2+JCT_SENSOR_AXLE_MM*1000-newest;
+  }
+  return kind;
+}
+
+void JCT_Clear(void) {
+  FRTOS1_taskENTER_CRITICAL();
+  JCT_nofEntries = 0;
+  FRTOS1_taskEXIT_CRITICAL();
+}
+
+#if PL_CONFIG_HAS_SHELL
+static void JCT_PrintHelp(const CLS1_StdIOType *io) {
+  CLS1_SendHelpStr((unsigned char*)"junction", (unsigned char*)"Group of junction detection commands\r\n", io->stdOut);
+  CLS1_SendHelpStr((unsigned char*)"  help|status", (unsigned char*)"Shows junction help or status\r\n", io->stdOut);
+  CLS1_SendHelpStr((unsigned char*)"  clear", (unsigned char*)"Clears the history\r\n", io->stdOut);
+}
+
+static void JCT_PrintStatus(const CLS1_StdIOType *io) {
+  JCT_Entry hist[JCT_HISTORY_SIZE];
+  unsigned char buf[32];
+  int32_t dist;
+  uint8_t i, j, n;
+
+  CLS1_SendStatusStr((unsigned char*)"junction", (unsigned char*)"\r\n", io->stdOut);
+  UTIL1_strcpy(buf, sizeof(buf), JCT_KindStr(JCT_Classify(&dist)));
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)", ");
+  UTIL1_strcatNum32s(buf, sizeof(buf), dist/1000);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" mm to axle\r\n");
+  CLS1_SendStatusStr((unsigned char*)"  kind", buf, io->stdOut);
+  n = JCT_GetHistory(hist);
+  for(i=0;i<n;i++) {
+    UTIL1_strcpy(buf, sizeof(buf), (unsigned char*)"  ");
+    UTIL1_strcatNum32s(buf, sizeof(buf), (hist[i].distUm-hist[0].distUm)/1000);
+    UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" mm");
+    CLS1_SendStatusStr(buf, (unsigned char*)"", io->stdOut);
+    for(j=0;j<REF_NOF_SENSORS;j++) {
+      CLS1_SendStr((hist[i].mask&(1<<j))?(unsigned char*)"X":(unsigned char*)"-", io->stdOut);
+    }
+    CLS1_SendStr((unsigned char*)" ", io->stdOut);
+    CLS1_SendStr(REF_LineKindStr((REF_LineKind)hist[i].kind), io->stdOut);
+    CLS1_SendStr((unsigned char*)"\r\n", io->stdOut);
+  }
+}
+
+uint8_t JCT_ParseCommand(const unsigned char *cmd, bool *handled, const CLS1_StdIOType *io) {
+  uint8_t res = ERR_OK;
+
+  if (UTIL1_strcmp((char*)cmd, (char*)CLS1_CMD_HELP)==0 || UTIL1_strcmp((char*)cmd, (char*)"junction help")==0) {
+    JCT_PrintHelp(io);
+    *handled = TRUE;
+  } else if (UTIL1_strcmp((char*)cmd, (char*)CLS1_CMD_STATUS)==0 || UTIL1_strcmp((char*)cmd, (char*)"junction status")==0) {
+    JCT_PrintStatus(io);
+    *handled = TRUE;
+  } else if (UTIL1_strcmp((char*)cmd, (char*)"junction clear")==0) {
+    JCT_Clear();
+    *handled = TRUE;
+  }
+  return res;
+}
+#endif /* PL_CONFIG_HAS_SHELL */
+
+void JCT_Deinit(void) {
+  /* nothing to do */
+}
+
+void JCT_Init(void) {
+  JCT_Clear();
+}
+
+#endif /* PL_CONFIG_HAS_LINE_JUNCTION */
@@ -0,0 +1,76 @@
+/**
+ * \file
+ * \brief Interface to the junction detection.
+ *
+ * The sensor frames of the last few centimetres are kept in a distance indexed history.
+ * Looking at the pattern of side lines in the history, the kind of an intersection is known
+ * as soon as the sensors have passed it, and before the wheel axle reaches the decision point.
+ */
+
+#ifndef JUNCTION_H_
+#define JUNCTION_H_
+
+#include "Platform.h"
+#if PL_CONFIG_HAS_LINE_JUNCTION
+#include "Reflectance.h"
+
+#if PL_CONFIG_HAS_SHELL
+#include "CLS1.h"
+/*!
+ * \brief Shell command line parser.
+ * \param[in] cmd Pointer to command string
+ * \param[out] handled If command is handled by the parser
+ * \param[in] io Std I/O handler of shell
+ */
+uint8_t JCT_ParseCommand(const unsigned char *cmd, bool *handled, const CLS1_StdIOType *io);
+#endif
+
+typedef enum {
+  JCT_NONE,           /* no junction, following a line */
+  JCT_PENDING,        /* sensors are over side lines, not known yet */
+  JCT_LEFT,           /* line turns left */
+  JCT_RIGHT,          /* line turns right */
+  JCT_LEFT_STRAIGHT,  /* branch to the left, line continues straight */
+  JCT_RIGHT_STRAIGHT, /* branch to the right, line continues straight */
+  JCT_T,              /* branches to both sides, no line straight */
+  JCT_CROSS,          /* branches to both sides, line continues straight */
+  JCT_END,            /* line ends without any branch */
+  JCT_FINISH,         /* wide black area */
+  JCT_NOF_KINDS       /* Sentinel */
+} JCT_Kind;
+
+/*!
+ * \brief Returns a string for a junction kind.
+ * \param kind Junction kind
+ * \return String with the name
+ */
+unsigned char *JCT_KindStr(JCT_Kind kind);
+
+/*!
+ * \brief Adds a sensor frame to the history. Called by the reflectance module for every measurement.
+ * \param mask Sensors seeing a line, bit 0 is the leftmost sensor
+ * \param kind Line kind of the frame
+ */
+void JCT_AddFrame(uint8_t mask, REF_LineKind kind);
+
+/*!
+ * \brief Classifies the junction from the history.
+ * \param[out] distUm If not NULL, distance (micro meters) the wheel axle still has to drive to reach the middle of the junction
+ * \return Kind of junction
+ */
+JCT_Kind JCT_Classify(int32_t *distUm);
+
+/*!
+ * \brief Clears the history, e.g. after turning on the spot.
+ */
+void JCT_Clear(void);
+
+/*! \brief Module de-initialization. */
+void JCT_Deinit(void);
+
+/*! \brief Module initialization. */
+void JCT_Init(void);
+
+#endif /* PL_CONFIG_HAS_LINE_JUNCTION */
+
+#endif /* JUNCTION_H_ */
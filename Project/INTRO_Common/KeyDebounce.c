@@ -202,7 +202,7 @@ static DBNC_FSMData KEYDBNC_FSMdata = {
   DBNC_KEY_IDLE, /* initial state machine state, here the state is stored */
   0, /* key scan value */
   0, /* long key count */
-  TRG_KEYPRESS, /* trigger to be used */
+  TRG_NO_TRIGGER, /* trigger to be used, allocated in KEYDBNC_Init() */
   (50/TRG_TICKS_MS), /* debounceTicks */
   (500/TRG_TICKS_MS), /* longKeyTicks for x ms */
 };
@@ -230,10 +230,15 @@ void KEYDBNC_Process(void) {
 
 void KEYDBNC_Init(void) {
   KEYDBNC_FSMdata.state = DBNC_KEY_IDLE;
+  KEYDBNC_FSMdata.trigger = TRG_AllocTrigger();
+  if (KEYDBNC_FSMdata.trigger==TRG_NO_TRIGGER) {
+    for(;;){} /* increase TRG_MAX_TRIGGERS */
+  }
 }
 
 void KEYDBNC_Deinit(void) {
-  /* nothing needed */
+  TRG_FreeTrigger(KEYDBNC_FSMdata.trigger);
+  KEYDBNC_FSMdata.trigger = TRG_NO_TRIGGER;
 }
 
 #endif /* PL_CONFIG_HAS_DEBOUNCE */
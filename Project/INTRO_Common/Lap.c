@@ -0,0 +1,384 @@
+/**
+ * \file
+ * \brief Implementation of the lap timing of the line following.
+ *
+ * The markers are recognized with the junction detection: a line crossing the track is the start/finish line,
+ * if the robot has driven at least the expected lap distance (measured with the odometry) since the start of the lap.
+ * A side line on one side only is a sector marker. Time stamps are taken from the RTOS tick count, refined with
+ * the counter of the tick timer to micro seconds. The speed is sampled from the tacho with every sensor frame.
+ */
+
+#include "Platform.h"
+#if PL_CONFIG_HAS_LINE_LAP
+#include "Lap.h"
+#include "Junction.h"
+#include "Tacho.h"
+#include "Odometry.h"
+#include "FRTOS1.h"
+#include "RTOS.h"
+#include "UTIL1.h"
+#if PL_CONFIG_HAS_SHELL
+  #include "CLS1.h"
+#endif
+#if PL_CONFIG_HAS_RADIO
+  #include "RApp.h"
+  #include "RNet_App.h"
+  #include "RNet_AppConfig.h"
+#endif
+
+#define LAP_MAX_LAPS        8   /* number of laps in the table, power of two */
+#define LAP_MAX_SECTORS     4   /* number of sector splits per lap */
+#define LAP_US_PER_TICK     (portTICK_PERIOD_MS*1000)
+#define LAP_MIN_DIST_MM     1000 /* default minimal lap distance, crossings before are not the finish line */
+#define LAP_EXPECTED_PERCENT 75  /* a lap needs to be at least this percentage of the previous lap distance */
+
+typedef enum {
+  LAP_MARKER_OFF,    /* no sectors */
+  LAP_MARKER_LEFT,   /* side lines on the left are sector markers */
+  LAP_MARKER_RIGHT,  /* side lines on the right are sector markers */
+  LAP_MARKER_BOTH    /* side lines on either side are sector markers */
+} LAP_Marker;
+
+typedef struct {
+  uint32_t lapUs;                      /* lap time */
+  uint32_t sectorUs[LAP_MAX_SECTORS];  /* split times, since start of the lap */
+  uint8_t nofSectors;                  /* number of valid entries in sectorUs[] */
+  uint16_t avgSpeed;                   /* average speed, steps/sec */
+  uint16_t peakSpeed;                  /* peak speed, steps/sec */
+  uint16_t nofOffLine;                 /* number of times the line has been lost */
+  uint32_t distMm;                     /* distance driven in the lap */
+} LAP_Entry;
+
+static LAP_Entry LAP_table[LAP_MAX_LAPS];
+static uint16_t LAP_nofLaps = 0;       /* completed laps, the newest is at (LAP_nofLaps-1)%LAP_MAX_LAPS */
+static uint16_t LAP_nofSent = 0;       /* laps sent over the radio by the shell task */
+static LAP_Marker LAP_marker = LAP_MARKER_BOTH;
+static uint16_t LAP_minDistMm = LAP_MIN_DIST_MM;
+
+static struct {
+  bool running;         /* a lap has been started at the start/finish line */
+  bool offLine;         /* line has been lost in the last frame */
+  JCT_Kind prevJct;     /* junction kind of the last frame */
+  uint32_t startUs;     /* time stamp of the lap start */
+  int32_t startUm;      /* odometry distance at the lap start */
+  uint16_t nofIgnored;  /* lines across the track before the expected lap distance */
+  uint32_t speedSum;    /* sum of the speed samples */
+  uint16_t nofSpeed;    /* number of speed samples */
+  LAP_Entry lap;        /* lap in progress */
+} LAP_run;
+
+uint32_t LAP_GetUs(void) {
+  uint32_t ticks, cnt, period;
+
+  FRTOS1_taskENTER_CRITICAL();
+  ticks = FRTOS1_xTaskGetTickCount();
+  cnt = RTOS_GetTickTimerCount();
+  period = RTOS_GetTickTimerPeriod();
+  if (RTOS_IsTickPending() && cnt<period/2) { /* counter has wrapped, but tick not counted yet */
+    ticks++;
+  }
+  FRTOS1_taskEXIT_CRITICAL();
+  return ticks*LAP_US_PER_TICK+(cnt*LAP_US_PER_TICK)/period;
+}
+
+static bool LAP_IsSectorMarker(JCT_Kind kind) {
+  switch(kind) {
+    case JCT_LEFT_STRAIGHT:  return LAP_marker==LAP_MARKER_LEFT || LAP_marker==LAP_MARKER_BOTH;
+    case JCT_RIGHT_STRAIGHT: return LAP_marker==LAP_MARKER_RIGHT || LAP_marker==LAP_MARKER_BOTH;
+    default:                 return FALSE;
+  }
+}
+
+#if PL_CONFIG_HAS_RADIO
+static void LAP_Put16(uint8_t *p, uint16_t val) {
+  p[0] = (uint8_t)val;
+  p[1] = (uint8_t)(val>>8);
+}
+
+static void LAP_Put32(uint8_t *p, uint32_t val) {
+  LAP_Put16(p, (uint16_t)val);
+  LAP_Put16(p+2, (uint16_t)(val>>16));
+}
+
+/* sends the lap result and the sector splits to the remote, little endian. Blocks until the radio has taken it */
+static void LAP_SendResult(const LAP_Entry *lap, uint16_t lapNo) {
+  uint8_t data[2+LAP_MAX_SECTORS*4];
+  uint8_t i;
+
+  data[0] = (uint8_t)lapNo;
+  data[1] = lap->nofSectors;
+  LAP_Put32(&data[2], lap->lapUs);
+  LAP_Put16(&data[6], lap->avgSpeed);
+  LAP_Put16(&data[8], lap->peakSpeed);
+  LAP_Put16(&data[10], lap->nofOffLine);
+  (void)RAPP_SendPayloadDataBlock(data, 12, RAPP_MSG_TYPE_LAP_RESULT, RNETA_GetDestAddr(), RPHY_PACKET_FLAGS_NONE);
+  if (lap->nofSectors>0) {
+    for(i=0;i<lap->nofSectors;i++) {
+      LAP_Put32(&data[2+i*4], lap->sectorUs[i]);
+    }
+    (void)RAPP_SendPayloadDataBlock(data, 2+lap->nofSectors*4, RAPP_MSG_TYPE_LAP_SECTORS, RNETA_GetDestAddr(), RPHY_PACKET_FLAGS_NONE);
+  }
+}
+#endif
+
+/* distance driven since the start of the lap */
+static uint32_t LAP_GetDistMm(void) {
+  int32_t um;
+
+  um = ODO_GetDistanceUm()-LAP_run.startUm;
+  return um>0?(uint32_t)um/1000:0;
+}
+
+/* a line across the track is the finish line if we have driven the expected lap distance */
+static bool LAP_IsFinishLine(void) {
+  uint32_t expected;
+
+  if (!LAP_run.running) {
+    return TRUE; /* any line across the track starts the first lap */
+  }
+  expected = LAP_minDistMm;
+  if (LAP_nofLaps>0 && LAP_table[(LAP_nofLaps-1)%LAP_MAX_LAPS].distMm*LAP_EXPECTED_PERCENT/100>expected) {
+    expected = LAP_table[(LAP_nofLaps-1)%LAP_MAX_LAPS].distMm*LAP_EXPECTED_PERCENT/100;
+  }
+  return LAP_GetDistMm()>=expected;
+}
+
+static void LAP_StartLap(uint32_t now) {
+  LAP_run.running = TRUE;
+  LAP_run.startUs = now;
+  LAP_run.startUm = ODO_GetDistanceUm();
+  LAP_run.speedSum = 0;
+  LAP_run.nofSpeed = 0;
+  LAP_run.lap.lapUs = 0;
+  LAP_run.lap.nofSectors = 0;
+  LAP_run.lap.avgSpeed = 0;
+  LAP_run.lap.peakSpeed = 0;
+  LAP_run.lap.nofOffLine = 0;
+  LAP_run.lap.distMm = 0;
+}
+
+static void LAP_EndLap(uint32_t now) {
+  LAP_Entry *lap = &LAP_run.lap;
+
+  lap->lapUs = now-LAP_run.startUs;
+  lap->distMm = LAP_GetDistMm();
+  if (LAP_run.nofSpeed>0) {
+    lap->avgSpeed = (uint16_t)(LAP_run.speedSum/LAP_run.nofSpeed);
+  }
+  FRTOS1_taskENTER_CRITICAL(); /* the shell task might copy the entry for sending */
+  LAP_table[LAP_nofLaps%LAP_MAX_LAPS] = *lap;
+  LAP_nofLaps++;
+  FRTOS1_taskEXIT_CRITICAL();
+}
+
+void LAP_FlushResults(void) {
+#if PL_CONFIG_HAS_RADIO
+  LAP_Entry lap;
+  uint16_t nofLaps;
+
+  nofLaps = LAP_nofLaps;
+  if ((uint16_t)(nofLaps-LAP_nofSent)>LAP_MAX_LAPS) { /* overwritten before sending, or table cleared */
+    LAP_nofSent = (nofLaps>LAP_MAX_LAPS)?nofLaps-LAP_MAX_LAPS:0;
+  }
+  while (LAP_nofSent!=nofLaps) {
+    FRTOS1_taskENTER_CRITICAL();
+    lap = LAP_table[LAP_nofSent%LAP_MAX_LAPS];
+    FRTOS1_taskEXIT_CRITICAL();
+    LAP_nofSent++;
+    LAP_SendResult(&lap, LAP_nofSent);
+  }
+#endif
+}
+
+void LAP_Update(REF_LineKind kind) {
+  uint32_t now;
+  int32_t speed;
+  JCT_Kind jct;
+
+  now = LAP_GetUs();
+  jct = JCT_Classify(NULL);
+  if (LAP_run.prevJct==JCT_PENDING && jct!=JCT_PENDING) { /* sensors have just passed side lines */
+    if (jct==JCT_CROSS && LAP_IsFinishLine()) { /* start/finish line */
+      if (LAP_run.running) {
+        LAP_EndLap(now);
+      }
+      LAP_StartLap(now);
+    } else if (jct==JCT_CROSS) {
+      LAP_run.nofIgnored++; /* crossing on the track */
+    } else if (LAP_run.running && LAP_IsSectorMarker(jct) && LAP_run.lap.nofSectors<LAP_MAX_SECTORS) {
+      LAP_run.lap.sectorUs[LAP_run.lap.nofSectors] = now-LAP_run.startUs;
+      LAP_run.lap.nofSectors++;
+    }
+  }
+  LAP_run.prevJct = jct;
+  if (LAP_run.running) {
+    if (kind==REF_LINE_NONE && !LAP_run.offLine) {
+      LAP_run.lap.nofOffLine++;
+    }
+    speed = (TACHO_GetSpeed(TRUE)+TACHO_GetSpeed(FALSE))/2;
+    if (speed<0) {
+      speed = -speed;
+    }
+    if (speed>0xffff) {
+      speed = 0xffff;
+    }
+    if (speed>LAP_run.lap.peakSpeed) {
+      LAP_run.lap.peakSpeed = (uint16_t)speed;
+    }
+    if (LAP_run.nofSpeed<0xffff) {
+      LAP_run.speedSum += (uint32_t)speed;
+      LAP_run.nofSpeed++;
+    }
+  }
+  LAP_run.offLine = kind==REF_LINE_NONE;
+}
+
+void LAP_Start(void) {
+  LAP_run.running = FALSE;
+  LAP_run.nofIgnored = 0;
+  LAP_run.offLine = FALSE;
+  LAP_run.prevJct = JCT_NONE;
+}
+
+void LAP_Stop(void) {
+  LAP_run.running = FALSE; /* lap not complete */
+}
+
+#if PL_CONFIG_HAS_SHELL
+static void LAP_StrCatUs(unsigned char *buf, size_t bufSize, uint32_t us) {
+  uint32_t div;
+
+  UTIL1_strcatNum32u(buf, bufSize, us/1000000);
+  UTIL1_chcat(buf, bufSize, '.');
+  for(div=100000;div>0;div/=10) { /* fraction with leading zeros */
+    UTIL1_chcat(buf, bufSize, (unsigned char)('0'+(us/div)%10));
+  }
+}
+
+static void LAP_PrintLaps(const CLS1_StdIOType *io) {
+  unsigned char buf[48];
+  uint16_t i, first;
+  uint8_t j;
+  LAP_Entry *lap;
+
+  if (LAP_nofLaps==0) {
+    CLS1_SendStr((unsigned char*)"no laps\r\n", io->stdOut);
+    return;
+  }
+  first = (LAP_nofLaps>LAP_MAX_LAPS)?LAP_nofLaps-LAP_MAX_LAPS:0;
+  for(i=first;i<LAP_nofLaps;i++) {
+    lap = &LAP_table[i%LAP_MAX_LAPS];
+    UTIL1_strcpy(buf, sizeof(buf), (unsigned char*)"lap ");
+    UTIL1_strcatNum16u(buf, sizeof(buf), i+1);
+    UTIL1_strcat(buf, sizeof(buf), (unsigned char*)": ");
+    LAP_StrCatUs(buf, sizeof(buf), lap->lapUs);
+    UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" s, ");
+    UTIL1_strcatNum32u(buf, sizeof(buf), lap->distMm);
+    UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" mm, off line ");
+    UTIL1_strcatNum16u(buf, sizeof(buf), lap->nofOffLine);
+    UTIL1_strcat(buf, sizeof(buf), (unsigned char*)"\r\n");
+    CLS1_SendStr(buf, io->stdOut);
+    UTIL1_strcpy(buf, sizeof(buf), (unsigned char*)"  speed avg ");
+    UTIL1_strcatNum16u(buf, sizeof(buf), lap->avgSpeed);
+    UTIL1_strcat(buf, sizeof(buf), (unsigned char*)", peak ");
+    UTIL1_strcatNum16u(buf, sizeof(buf), lap->peakSpeed);
+    UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" steps/s\r\n");
+    CLS1_SendStr(buf, io->stdOut);
+    for(j=0;j<lap->nofSectors;j++) {
+      UTIL1_strcpy(buf, sizeof(buf), (unsigned char*)"  sector ");
+      UTIL1_strcatNum8u(buf, sizeof(buf), j+1);
+      UTIL1_strcat(buf, sizeof(buf), (unsigned char*)": ");
+      LAP_StrCatUs(buf, sizeof(buf), lap->sectorUs[j]);
+      UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" s\r\n");
+      CLS1_SendStr(buf, io->stdOut);
+    }
+  }
+}
+
+static void LAP_PrintHelp(const CLS1_StdIOType *io) {
+  CLS1_SendHelpStr((unsigned char*)"line laps", (unsigned char*)"Group of lap timing commands, without argument prints the lap table\r\n", io->stdOut);
+  CLS1_SendHelpStr((unsigned char*)"  help|status", (unsigned char*)"Shows lap timing help or status\r\n", io->stdOut);
+  CLS1_SendHelpStr((unsigned char*)"  clear", (unsigned char*)"Clears the lap table\r\n", io->stdOut);
+  CLS1_SendHelpStr((unsigned char*)"  marker (off|left|right|both)", (unsigned char*)"Side lines used as sector markers\r\n", io->stdOut);
+  CLS1_SendHelpStr((unsigned char*)"  mindist <mm>", (unsigned char*)"Minimal lap distance, lines across the track before are ignored\r\n", io->stdOut);
+}
+
+static void LAP_PrintStatus(const CLS1_StdIOType *io) {
+  unsigned char buf[32];
+
+  CLS1_SendStatusStr((unsigned char*)"laps", (unsigned char*)"\r\n", io->stdOut);
+  UTIL1_Num16uToStr(buf, sizeof(buf), LAP_nofLaps);
+  UTIL1_strcat(buf, sizeof(buf), LAP_run.running?(unsigned char*)", lap running\r\n":(unsigned char*)"\r\n");
+  CLS1_SendStatusStr((unsigned char*)"  laps", buf, io->stdOut);
+  switch(LAP_marker) {
+    case LAP_MARKER_OFF:   UTIL1_strcpy(buf, sizeof(buf), (unsigned char*)"off\r\n"); break;
+    case LAP_MARKER_LEFT:  UTIL1_strcpy(buf, sizeof(buf), (unsigned char*)"left\r\n"); break;
+    case LAP_MARKER_RIGHT: UTIL1_strcpy(buf, sizeof(buf), (unsigned char*)"right\r\n"); break;
+    case LAP_MARKER_BOTH:  UTIL1_strcpy(buf, sizeof(buf), (unsigned char*)"both\r\n"); break;
+    default:               UTIL1_strcpy(buf, sizeof(buf), (unsigned char*)"UNKNOWN\r\n"); break;
+  }
+  CLS1_SendStatusStr((unsigned char*)"  marker", buf, io->stdOut);
+  UTIL1_Num16uToStr(buf, sizeof(buf), LAP_minDistMm);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" mm, ");
+  UTIL1_strcatNum16u(buf, sizeof(buf), LAP_run.nofIgnored);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" crossings ignored\r\n");
+  CLS1_SendStatusStr((unsigned char*)"  min dist", buf, io->stdOut);
+}
+
+uint8_t LAP_ParseCommand(const unsigned char *cmd, bool *handled, const CLS1_StdIOType *io) {
+  uint8_t res = ERR_OK;
+  const unsigned char *p;
+  uint16_t val16u;
+
+  if (UTIL1_strcmp((char*)cmd, (char*)CLS1_CMD_HELP)==0 || UTIL1_strcmp((char*)cmd, (char*)"line laps help")==0) {
+    LAP_PrintHelp(io);
+    *handled = TRUE;
+  } else if (UTIL1_strcmp((char*)cmd, (char*)CLS1_CMD_STATUS)==0 || UTIL1_strcmp((char*)cmd, (char*)"line laps status")==0) {
+    LAP_PrintStatus(io);
+    *handled = TRUE;
+  } else if (UTIL1_strcmp((char*)cmd, (char*)"line laps")==0) {
+    LAP_PrintLaps(io);
+    *handled = TRUE;
+  } else if (UTIL1_strcmp((char*)cmd, (char*)"line laps clear")==0) {
+    LAP_nofLaps = 0;
+    LAP_nofSent = 0;
+    *handled = TRUE;
+  } else if (UTIL1_strcmp((char*)cmd, (char*)"line laps marker off")==0) {
+    LAP_marker = LAP_MARKER_OFF;
+    *handled = TRUE;
+  } else if (UTIL1_strcmp((char*)cmd, (char*)"line laps marker left")==0) {
+    LAP_marker = LAP_MARKER_LEFT;
+    *handled = TRUE;
+  } else if (UTIL1_strcmp((char*)cmd, (char*)"line laps marker right")==0) {
+    LAP_marker = LAP_MARKER_RIGHT;
+    *handled = TRUE;
+  } else if (UTIL1_strcmp((char*)cmd, (char*)"line laps marker both")==0) {
+    LAP_marker = LAP_MARKER_BOTH;
+    *handled = TRUE;
+  } else if (UTIL1_strncmp((char*)cmd, (char*)"line laps mindist ", sizeof("line laps mindist ")-1)==0) {
+    p = cmd+sizeof("line laps mindist");
+    if (UTIL1_ScanDecimal16uNumber(&p, &val16u)==ERR_OK) {
+      LAP_minDistMm = val16u;
+      *handled = TRUE;
+    } else {
+      CLS1_SendStr((unsigned char*)"Wrong argument\r\n", io->stdErr);
+      res = ERR_FAILED;
+    }
+  }
+  return res;
+}
+#endif /* PL_CONFIG_HAS_SHELL */
+
+void LAP_Deinit(void) {
+  /* nothing to do */
+}
+
+void LAP_Init(void) {
+  LAP_nofLaps = 0;
+  LAP_nofSent = 0;
+  LAP_marker = LAP_MARKER_BOTH;
+  LAP_minDistMm = LAP_MIN_DIST_MM;
+  LAP_Start();
+}
+
+#endif /* PL_CONFIG_HAS_LINE_LAP */
@@ -0,0 +1,65 @@
+/**
+ * \file
+ * \brief Interface to the lap timing of the line following.
+ *
+ * Crossing the start/finish line (a full line across the track) starts and ends a lap,
+ * side markers on the track give the sector splits. A line across the track only ends a lap after the
+ * expected lap distance, so other crossings on the track are ignored. For every lap the times, the speed and the
+ * number of times the line has been lost are stored in a table, and sent over the radio by the shell task.
+ */
+
+#ifndef LAP_H_
+#define LAP_H_
+
+#include "Platform.h"
+#if PL_CONFIG_HAS_LINE_LAP
+#include "Reflectance.h"
+
+#if PL_CONFIG_HAS_SHELL
+#include "CLS1.h"
+/*!
+ * \brief Shell command line parser.
+ * \param[in] cmd Pointer to command string
+ * \param[out] handled If command is handled by the parser
+ * \param[in] io Std I/O handler of shell
+ */
+uint8_t LAP_ParseCommand(const unsigned char *cmd, bool *handled, const CLS1_StdIOType *io);
+#endif
+
+/*!
+ * \brief Returns a time stamp with micro second resolution.
+ * \return Micro seconds since the scheduler has been started, wraps around after about 71 minutes
+ */
+uint32_t LAP_GetUs(void);
+
+/*!
+ * \brief Called by the line following when it starts. The first lap starts at the next start/finish line.
+ */
+void LAP_Start(void);
+
+/*!
+ * \brief Called by the line following when it stops. A lap in progress is dropped.
+ */
+void LAP_Stop(void);
+
+/*!
+ * \brief Checks for markers and collects the lap statistics. Called by the line following for every sensor frame.
+ * \param kind Current line kind
+ */
+void LAP_Update(REF_LineKind kind);
+
+/*!
+ * \brief Sends the laps completed since the last call over the radio.
+ * Called by the shell task, so the line task does not wait for the radio.
+ */
+void LAP_FlushResults(void);
+
+/*! \brief Module de-initialization. */
+void LAP_Deinit(void);
+
+/*! \brief Module initialization. */
+void LAP_Init(void);
+
+#endif /* PL_CONFIG_HAS_LINE_LAP */
+
+#endif /* LAP_H_ */
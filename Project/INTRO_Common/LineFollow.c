@@ -31,189 +31,411 @@
 #if PL_CONFIG_HAS_LINE_MAZE
   #include "Maze.h"
 #endif
+#if PL_CONFIG_HAS_ODOMETRY
+  #include "Odometry.h"
+#endif
+#if PL_CONFIG_HAS_LINE_TRACK
+  #include "Track.h"
+#endif
+#if PL_CONFIG_HAS_LINE_JUNCTION
+  #include "Junction.h"
+#endif
+#if PL_CONFIG_HAS_LINE_LAP
+  #include "Lap.h"
+#endif
+#if PL_CONFIG_HAS_BUS
+  #include "Bus.h"
+#endif
+#include "UTIL1.h"
+#include "Util.h"
+#include "Application.h"
 
+/* Line following is a hierarchical state machine, driven by events in a queue.
+ * The states and transitions are described in tables: an event is handled by the first matching transition of the
+ * current state, or of its parent states. The transitions of a state are checked in table order: the first one with
+ * an action returning TRUE (or without action) is taken. Entry and exit actions are run for all states left or entered.
+ * Transitions are stored with a time stamp in a trace buffer, which is printed by the shell task (LF_FlushLog()).
+ * The trace is for diagnostics only and may be overrun. The contest signals are posted as pending flags,
+ * which the shell task sends from LF_FlushLog() too. */
 typedef enum {
-  STATE_IDLE,              /* idle, not doing anything */
-  STATE_FOLLOW_SEGMENT,    /* line following segment, going forward */
-  STATE_TURN,              /* reached an intersection, turning around */
-  STATE_FINISHED,          /* reached finish area */
-  STATE_STOP,				/* stop the engines */
-  STATE_STOP_CALM,
-} StateType;
-
-typedef enum{
-	STOP,
-	START,
-	BREAK,
-	FORWARD,
-	TURN,
-	BACK,
-	END
-}SwitchState;
-
-
-/* task notification bits */
-#define LF_START_FOLLOWING (1<<0)  /* start line following */
-#define LF_STOP_FOLLOWING  (1<<1)  /* stop line following */
-
-static void StateMachine2(void);
-static bool FollowSegment(void);
-static volatile StateType LF_currState = STATE_IDLE;
-static volatile SwitchState FSM_state = STOP; //added by Kusi
-static SwitchState FSM_state_save = START;  //store the current state
-uint16_t lostcounter = 0;
-bool writeflag = false;
-static xTaskHandle LFTaskHandle;
+  LF_STATE_ROOT,     /* top level state */
+  LF_STATE_IDLE,     /* idle, not doing anything */
+  LF_STATE_ACTIVE,   /* parent of all states while following */
+  LF_STATE_FORWARD,  /* following the line, going forward */
+  LF_STATE_TURN,     /* reached the end of the line, turning around */
+  LF_STATE_BACK,     /* following the line back */
+  LF_STATE_FINISH,   /* reached the start again, moving into the start area */
+  LF_STATE_PAUSED,   /* stopped by the user, can be resumed */
+  LF_STATE_BRIDGE,   /* line lost, keep the heading to bridge a gap */
+  LF_STATE_SEARCH,   /* line still lost, search it around */
+  LF_STATE_MAZE,     /* at a maze junction, turning as the maze rule tells */
+  LF_NOF_STATES,
+  LF_STATE_NONE = LF_NOF_STATES, /* no transition, only the action */
+  LF_STATE_HISTORY,  /* return to the state before the pause */
+  LF_STATE_FOLLOW,   /* return to line following, forward or back */
+  LF_STATE_LINE_END  /* end of the line: turn if going forward, finish if going back, or a maze junction */
+} LF_State;
+
+typedef enum {
+  LF_EVT_NONE,
+  LF_EVT_START,       /* start line following */
+  LF_EVT_STOP,        /* stop line following */
+  LF_EVT_START_STOP,  /* toggle line following */
+  LF_EVT_FRAME,       /* new reflectance sensor values available */
+  LF_EVT_TURN_DONE,   /* turn has been finished */
+  LF_EVT_TIMEOUT,     /* timeout of the current state */
+  LF_NOF_EVENTS
+} LF_Event;
+
+typedef struct {
+  const char *name;         /* name for status and trace */
+  LF_State parent;          /* parent state, LF_STATE_NONE for the root */
+  void (*entry)(void);      /* entry action or NULL */
+  void (*exit)(void);       /* exit action or NULL */
+  uint16_t timeoutMs;       /* period of the LF_EVT_TIMEOUT event, 0 for none */
+  char signal;              /* contest signal sent when entering the state, or '\0' */
+} LF_StateDesc;
+
+typedef struct {
+  LF_State state;           /* state handling the event */
+  LF_Event event;           /* event */
+  bool (*action)(void);     /* action, returns TRUE if the transition shall be taken. NULL to take it always */
+  LF_State target;          /* next state, or LF_STATE_NONE */
+} LF_Transition;
+
+typedef struct {
+  uint32_t ticks;           /* time stamp */
+  uint8_t from, to, event;  /* LF_State, LF_State and LF_Event */
+} LF_TraceEntry;
+
+#define LF_EVENT_QUEUE_LENGTH  8   /* number of events in queue */
+#define LF_TRACE_SIZE          16  /* number of transitions in the trace buffer, power of two */
+#define LF_SIGNAL_REPEAT       5   /* contest signals are sent multiple times, as radio messages can get lost */
+#define LF_TASK_STACK_SIZE     (configMINIMAL_STACK_SIZE+100) /* the line task runs the maze start and the lap timing */
+#define LF_TURN_QUEUE_LENGTH   2   /* number of turn jobs in queue */
+#define LF_TURN_TASK_STACK_SIZE (configMINIMAL_STACK_SIZE+100) /* the turn task runs the turns and the maze */
+
+static xQueueHandle LF_EventQueue;
+static volatile LF_State LF_state = LF_STATE_IDLE;
+static LF_State LF_resumeState = LF_STATE_FORWARD; /* state to resume after a pause */
+static uint32_t LF_timeoutTicks;                   /* tick count of next timeout */
+static volatile bool LF_framePending = FALSE;      /* a sensor frame event is in the queue */
+static LF_State LF_followState = LF_STATE_FORWARD; /* line following state, forward or back */
+static REF_LineKind LF_lineKind = REF_LINE_NONE;   /* line kind of the last frame */
+static int32_t LF_lineOffset = 0;                  /* filtered line position relative to the middle, while on the line */
+static LF_TraceEntry LF_trace[LF_TRACE_SIZE];
+static volatile uint32_t LF_traceWriteIdx = 0;     /* number of transitions, written by the line task */
+static uint32_t LF_traceReadIdx = 0;               /* number of transitions printed by the shell task */
+static const char LF_SignalChars[] = {'B', 'C'};   /* contest signals, in the order they are sent */
+static volatile uint8_t LF_signalsPending = 0;     /* bit i set: LF_SignalChars[i] needs to be sent */
 #if PL_CONFIG_HAS_LINE_MAZE
-static uint8_t LF_solvedIdx = 0; /*  index to iterate through the solution, zero is the solution start index */
+static bool LF_mazeMode = FALSE;                   /* if the end of a line segment is a maze junction */
+static bool LF_mazeFinished = FALSE;               /* the maze turn has reached the finish area */
+static bool LF_mazeFailed = FALSE;                 /* the maze turn has failed */
+static bool LF_mazeJunction = FALSE;               /* the segment ends at a maze intersection, even if the line continues */
+#endif
+
+static const char *const LF_EventNames[LF_NOF_EVENTS] = {
+  "NONE", "START", "STOP", "START_STOP", "FRAME", "TURN_DONE", "TIMEOUT"
+};
+
+static bool FollowSegment(void);
+
+#if PL_CONFIG_HAS_ODOMETRY
+/* Recovery if the line gets lost: first drive straight with the last heading to bridge a gap in the line,
+ * then turn to both sides to search it, starting with the side where it has been seen last.
+ * Only if the line is not found, it is treated as the end of the line. */
+#define LF_RECOVER_MIN_SPEED      300  /* minimum wheel speed (steps/sec) while bridging a gap */
+#define LF_RECOVER_SEARCH_SPEED   400  /* wheel speed (steps/sec) while turning to search the line */
+#define LF_RECOVER_HEADING_GAIN   8    /* heading error (binary angle) divided by this is the wheel speed correction */
+
+static struct {
+  uint16_t gapMm;         /* maximum gap length, 0 disables the recovery */
+  uint8_t searchDeg;      /* search angle to each side */
+  int32_t startDistUm;    /* distance where the line got lost */
+  ODO_Angle heading;      /* heading where the line got lost */
+  int32_t speed;          /* wheel speed while bridging */
+  int8_t side;            /* side where the line has been seen last: 1 is left, -1 is right */
+  uint8_t phase;          /* search phase */
+  uint16_t nofLost;       /* number of times the line got lost */
+  uint16_t nofFound;      /* number of times it has been found again */
+} LF_Recover;
 #endif
 
+static void LF_PostEvent(LF_Event event) {
+  uint8_t evt = (uint8_t)event;
+
+  (void)FRTOS1_xQueueSendToBack(LF_EventQueue, &evt, 0); /* do not block, if the queue is full the event is lost */
+}
+
+#if PL_CONFIG_HAS_TURN
+/* Turns take up to a few seconds, so they run in the turn task and the line task keeps dispatching events.
+ * The entry action of a turning state starts a turn job, and the turn task posts LF_EVT_TURN_DONE at its end.
+ * The exit action cancels the job: its stop callback returns TRUE, and no event is posted for it. */
+typedef enum {
+  LF_TURN_U,      /* U-turn at the end of the line */
+  LF_TURN_MAZE    /* turn at a maze junction */
+} LF_TurnJob;
+
+typedef struct {
+  uint8_t job;              /* LF_TurnJob */
+  uint8_t id;               /* job id, see LF_turnId */
+} LF_TurnRequest;
+
+static xQueueHandle LF_TurnQueue;
+static volatile uint8_t LF_turnId = 0;             /* id of the current turn job, changed by the line task to cancel it */
+static uint8_t LF_turnRunId = 0;                   /* id of the job run by the turn task */
+
+static void LF_StartTurn(LF_TurnJob job) {
+  LF_TurnRequest req;
+
+  LF_turnId++;
+  req.job = (uint8_t)job;
+  req.id = LF_turnId;
+  (void)FRTOS1_xQueueSendToBack(LF_TurnQueue, &req, 0);
+}
+
+static void LF_CancelTurn(void) {
+  LF_turnId++;
+}
+
+static bool LF_TurnCancelled(void) {
+  return LF_turnRunId!=LF_turnId;
+}
+#endif /* PL_CONFIG_HAS_TURN */
+
 void LF_StartFollowing(void) {
-  (void)xTaskNotify(LFTaskHandle, LF_START_FOLLOWING, eSetBits);
+  LF_PostEvent(LF_EVT_START);
 }
 
 void LF_StopFollowing(void) {
-  (void)xTaskNotify(LFTaskHandle, LF_STOP_FOLLOWING, eSetBits);
-}
-
-void LF_StartStopFollowing(void){
-
-	if((FSM_state==FORWARD)||(FSM_state==BACK)||(FSM_state==START)){
-			(void)xTaskNotify(LFTaskHandle, LF_STOP_FOLLOWING, eSetBits);
-	}
-
-	if((FSM_state==STOP)||(FSM_state==END)||(FSM_state==BREAK)){
-		 (void)xTaskNotify(LFTaskHandle, LF_START_FOLLOWING, eSetBits);
-	}
-}
-
-//void LF_StartStopFollowing(void) {
-// if((FSM_state==START)||(FSM_state==BREAK)){  //changed by Kusi
-//	//if (LF_IsFollowing()) {
-//    (void)xTaskNotify(LFTaskHandle, LF_STOP_FOLLOWING, eSetBits);
-//  } else {
-//    (void)xTaskNotify(LFTaskHandle, LF_START_FOLLOWING, eSetBits);
-//  }
-//}
-
-void setBreak(void){
-	FSM_state = BREAK;
-}
-
-static int counter;
-static void StateMachine2(void){
-	//case check stop
-
-	switch(FSM_state){
-
-	case STOP:
-		LF_currState = STATE_IDLE;
-		break;
-
-	//case START:
-		//FSM_state = FSM_state_save;  //go to saved state
-	//	break;
-
-	case BREAK:
-		if(writeflag==FALSE){
-			SHELL_SendString("BREAK!\r\n");
-			writeflag=TRUE;
-			LF_currState = STATE_STOP;
-		}
-
-		break;
-
-	case START:
-		//DRV_SetMode(DRV_MODE_SPEED);
-		FSM_state = FORWARD;
-		LF_currState = STATE_FOLLOW_SEGMENT;
-		FSM_state_save = START;  //save current state
-		counter = 0;
-		break;
-
-	case FORWARD:
-		if(writeflag==FALSE){
-			SHELL_SendString("FORWARD!\r\n");
-			writeflag = TRUE;
-
-		}
-		if(counter <= 5) {
-			ContestSendSignal('B');
-		}
-		counter++;
-		if(LF_currState == STATE_IDLE)
-		{
-			FSM_state = TURN;
-			writeflag = FALSE;
-			counter = 0;
-
-		}
-
-
-		break;
-
-	case TURN:
-		if(writeflag==FALSE){
-			SHELL_SendString("TURN!\r\n");
-			writeflag = TRUE;
-			LF_currState = STATE_TURN;
-		}
-		FSM_state_save = FSM_state;  //save current state
-
-		if(LF_currState == STATE_IDLE)
-		{
-			FSM_state = BACK;
-			writeflag = FALSE;
-		}
-		break;
-
-	case BACK:
-		if(writeflag==FALSE){
-			SHELL_SendString("BACK!\r\n");
-			writeflag = TRUE;
-			//DRV_SetMode(DRV_MODE_SPEED);
-			LF_currState = STATE_FOLLOW_SEGMENT;
-		}
-
-		FSM_state_save = FSM_state;  //save current state
-
-		if(LF_currState == STATE_IDLE)
-		{
-			FSM_state = END;
-			writeflag = FALSE;
-			DRV_Reset();
-			DRV_SetMode(DRV_MODE_POS);
-			DRV_SetPos(300, 300);
-
-
-		}
-		break;
-
-	case END:
-		if(writeflag == FALSE){
-		SHELL_SendString("END!\r\n");
-		writeflag = TRUE;
-		}
-		if(counter < 5) {
-			ContestSendSignal('C');
-		}
-		counter++;
-//		if(DRV_IsStopped())
-		if(TACHO_GetSpeed(false) <= 30 && TACHO_GetSpeed(true) <= 30)
-		{
-			FSM_state = STOP;
-			DRV_SetSpeed(0,0);			// changed by Kevin
-			DRV_SetMode(DRV_MODE_STOP);
-			counter = 0;
-		}
-		//(playtune!?)
-		break;
-
-	}/*end of switch*/
-}/*end of function*/
-
-
-//static void StateMachine(void);
+  LF_PostEvent(LF_EVT_STOP);
+}
+
+void LF_StartStopFollowing(void) {
+  LF_PostEvent(LF_EVT_START_STOP);
+}
+
+void LF_SensorFrameReady(void) {
+  if (!LF_framePending) { /* only one frame in the queue, the line task reads the latest values anyway */
+    LF_framePending = TRUE;
+    LF_PostEvent(LF_EVT_FRAME);
+  }
+}
+
+/* returns line position and kind of the latest sensor frame */
+static void LF_GetLine(uint16_t *value, REF_LineKind *kind) {
+#if PL_CONFIG_HAS_BUS
+  BUS_Sample sample;
+
+  if (BUS_Get(BUS_TOPIC_LINE, &sample)) { /* both values are from the same frame */
+    *value = sample.u.line.value;
+    *kind = (REF_LineKind)sample.u.line.kind;
+    return;
+  }
+#endif
+  *value = REF_GetLineValue();
+  *kind = REF_GetLineKind();
+}
+
+/* returns the wheel speeds of the latest control cycle */
+static void LF_GetWheelSpeeds(int32_t *left, int32_t *right) {
+#if PL_CONFIG_HAS_BUS
+  BUS_Sample sample;
+
+  if (BUS_Get(BUS_TOPIC_WHEELS, &sample)) {
+    *left = sample.u.wheels.speedLeft;
+    *right = sample.u.wheels.speedRight;
+    return;
+  }
+#endif
+  *left = TACHO_GetSpeed(TRUE);
+  *right = TACHO_GetSpeed(FALSE);
+}
+
+/* Speed governor: adapts the speed limit of the line following to how well the line is tracked.
+ * The running variance of the line position and the rate of saturated PID outputs are filtered over the last frames:
+ * while both are low the limit is raised slowly, if one of them grows the limit is lowered quickly. */
+#define LF_GOV_FILTER             8     /* filter constant of the running values, in frames */
+#define LF_GOV_RAISE_Q8           64    /* raise the limit by a quarter percent per frame */
+#define LF_GOV_BACKOFF            4     /* lower the limit by this fraction of the range above the minimum per frame */
+#define LF_GOV_MAX_TIGHT_ERR      2500  /* upper limit for the tight tracking error, keeps the variance in 32bit */
+
+static struct {
+  bool enabled;           /* if the governor is used */
+  uint8_t minPercent;     /* lower bound of the speed limit */
+  uint8_t maxPercent;     /* upper bound of the speed limit */
+  uint16_t tightErr;      /* standard deviation of the line position for tight tracking, 1000 is one sensor pitch */
+  uint16_t satPermille;   /* rate of saturated PID outputs still accepted as tight tracking */
+  int32_t mean;           /* running mean of the line position error */
+  int32_t var;            /* running variance of the line position error */
+  int32_t sat;            /* running rate of saturated PID outputs, per mille */
+  uint16_t percentQ8;     /* current speed limit in percent, with 8 bit fraction */
+} LF_Gov;
+
+static void LF_GovReset(void) {
+  uint8_t percent;
+
+  LF_Gov.mean = 0;
+  LF_Gov.var = 0;
+  LF_Gov.sat = 0;
+  percent = PID_GetLineMaxSpeedPercent(); /* start with the configured speed */
+  if (percent<LF_Gov.minPercent) {
+    percent = LF_Gov.minPercent;
+  } else if (percent>LF_Gov.maxPercent) {
+    percent = LF_Gov.maxPercent;
+  }
+  LF_Gov.percentQ8 = (uint16_t)percent<<8;
+}
+
+/* returns the speed limit for the line following, from the governor or as configured */
+static uint8_t LF_GovPercent(void) {
+  if (LF_Gov.enabled) {
+    return (uint8_t)(LF_Gov.percentQ8>>8);
+  }
+  return PID_GetLineMaxSpeedPercent();
+}
+
+/*!
+ * \brief Updates the speed governor, called for every sensor frame while following the line.
+ * \param currLine Current line position
+ */
+static void LF_GovUpdate(uint16_t currLine) {
+  int32_t diff, tight, percent, minQ8, maxQ8;
+
+  if (!LF_Gov.enabled) {
+    return;
+  }
+  diff = (int32_t)currLine-REF_MIDDLE_LINE_VALUE-LF_Gov.mean;
+  LF_Gov.mean += diff/LF_GOV_FILTER;
+  LF_Gov.var += (diff*diff-LF_Gov.var)/LF_GOV_FILTER;
+  LF_Gov.sat += ((PID_LineIsSaturated()?1000:0)-LF_Gov.sat)/LF_GOV_FILTER;
+  tight = (int32_t)LF_Gov.tightErr*LF_Gov.tightErr;
+  minQ8 = (int32_t)LF_Gov.minPercent<<8;
+  maxQ8 = (int32_t)LF_Gov.maxPercent<<8;
+  percent = LF_Gov.percentQ8;
+  if (LF_Gov.var>4*tight || LF_Gov.sat>LF_Gov.satPermille) { /* twice the tight error, or saturating: back off */
+    percent -= (percent-minQ8)/LF_GOV_BACKOFF+(1<<8);
+  } else if (LF_Gov.var<tight && LF_Gov.sat<=LF_Gov.satPermille/2) { /* tight tracking: speed up */
+    percent += LF_GOV_RAISE_Q8;
+  }
+  if (percent<minQ8) {
+    percent = minQ8;
+  } else if (percent>maxQ8) {
+    percent = maxQ8;
+  }
+  LF_Gov.percentQ8 = (uint16_t)percent;
+}
+
+/* Speed planner: estimates the curvature of the path and limits the speed so the lateral acceleration stays below a limit.
+ * The curvature is taken from the wheel speeds (where we are) and from the line offset at the sensors (what is ahead):
+ * on an arc with curvature k, the line is offset by k*d^2/2 at the look-ahead distance d of the sensors. */
+#define LF_PLAN_HISTORY           8     /* number of line positions to average */
+#define LF_PLAN_SENSOR_PITCH_MM   8     /* distance between two reflectance sensors */
+#define LF_PLAN_LOOKAHEAD_MM      40    /* distance between sensors and wheel axle */
+#define LF_PLAN_WHEEL_BASE_MM     85    /* distance between the wheels, if there is no odometry calibration */
+#define LF_PLAN_MIN_SPEED         200   /* below this speed (steps/sec) the wheel speeds do not tell the curvature */
+#define LF_PLAN_STRAIGHT_CURV     1000  /* below this curvature (1/km, 1m radius) it is a straight */
+#define LF_PLAN_STRAIGHT_MS       300   /* time on a straight before we raise the speed limit */
+#define LF_PLAN_MIN_PERCENT       15    /* never go slower than this */
+#define LF_PLAN_MAX_LAT_ACCEL     4000  /* upper limit for the lateral acceleration, keeps the speed calculation in 32bit */
+
+static struct {
+  bool enabled;           /* if the planner is used */
+  int32_t latAccel;       /* lateral acceleration limit, mm/s^2 */
+  int32_t fullSpeed;      /* speed at 100% PWM, mm/s */
+  uint8_t boostPercent;   /* speed limit on sustained straights */
+  uint16_t lineErr[LF_PLAN_HISTORY]; /* absolute line offsets from the middle */
+  uint8_t lineIdx;        /* next index in lineErr[] */
+  int32_t curvWheels;     /* filtered curvature from the wheel speeds, 1/km */
+  int32_t curv;           /* estimated curvature, 1/km */
+  uint16_t straightMs;    /* how long we are on a straight */
+  uint8_t percent;        /* current speed limit */
+} LF_Plan;
+
+static void LF_PlanReset(void) {
+  int i;
+
+  for(i=0;i<LF_PLAN_HISTORY;i++) {
+    LF_Plan.lineErr[i] = 0;
+  }
+  LF_Plan.lineIdx = 0;
+  LF_Plan.curvWheels = 0;
+  LF_Plan.curv = 0;
+  LF_Plan.straightMs = 0;
+  LF_Plan.percent = LF_GovPercent();
+}
+
+/*!
+ * \brief Calculates the speed limit for the line following, called for every sensor frame.
+ * \param currLine Current line position
+ * \return Speed limit in percent
+ */
+static uint8_t LF_PlanSpeed(uint16_t currLine) {
+  int32_t speedL, speedR, avg, curv, errSum, offsetUm, wheelBase;
+  uint32_t speed, percent, basePercent;
+  int i;
+
+  /* curvature from the line offset, averaged over the last positions */
+  errSum = (int32_t)currLine-REF_MIDDLE_LINE_VALUE;
+  LF_Plan.lineErr[LF_Plan.lineIdx] = (uint16_t)(errSum<0?-errSum:errSum);
+  LF_Plan.lineIdx = (LF_Plan.lineIdx+1)%LF_PLAN_HISTORY;
+  errSum = 0;
+  for(i=0;i<LF_PLAN_HISTORY;i++) {
+    errSum += LF_Plan.lineErr[i];
+  }
+  offsetUm = (errSum/LF_PLAN_HISTORY)*LF_PLAN_SENSOR_PITCH_MM; /* 1000 units of line value is one sensor pitch */
+  curv = (2*offsetUm*1000)/(LF_PLAN_LOOKAHEAD_MM*LF_PLAN_LOOKAHEAD_MM); /* 2*offset/d^2, 1/km */
+  /* curvature from the wheels: (vR-vL)/(v*wheelBase) */
+  LF_GetWheelSpeeds(&speedL, &speedR);
+  avg = (speedL+speedR)/2;
+  if (avg>LF_PLAN_MIN_SPEED) {
+#if PL_CONFIG_HAS_ODOMETRY
+    wheelBase = ODO_GetWheelBaseMm();
+#else
+    wheelBase = LF_PLAN_WHEEL_BASE_MM;
+#endif
+    avg = (((speedR-speedL)*1000)/avg)*1000/wheelBase;
+    if (avg<0) {
+      avg = -avg;
+    }
+    LF_Plan.curvWheels = (3*LF_Plan.curvWheels+avg)/4; /* low pass, the speed values are noisy */
+  }
+  if (LF_Plan.curvWheels>curv) {
+    curv = LF_Plan.curvWheels;
+  }
+  LF_Plan.curv = curv;
+  /* speed limit on straights and in curves */
+  basePercent = LF_GovPercent();
+  if (curv<LF_PLAN_STRAIGHT_CURV) {
+    if (LF_Plan.straightMs<LF_PLAN_STRAIGHT_MS) {
+      LF_Plan.straightMs += REF_MEASURE_PERIOD_MS; /* called for every sensor frame */
+    } else if (LF_Plan.boostPercent>basePercent) {
+      basePercent = LF_Plan.boostPercent; /* sustained straight */
+    }
+  } else {
+    LF_Plan.straightMs = 0;
+  }
+  percent = basePercent;
+  if (curv>0) {
+    speed = UTIL_ISqrt((((uint32_t)LF_Plan.latAccel*1000)/(uint32_t)curv)*1000); /* v=sqrt(a/k), mm/s */
+    speed = (speed*100)/(uint32_t)LF_Plan.fullSpeed;
+    if (speed<percent) {
+      percent = speed;
+    }
+  }
+  if (percent<LF_PLAN_MIN_PERCENT) {
+    percent = LF_PLAN_MIN_PERCENT;
+  }
+  /* brake immediately, but speed up gently */
+  if (percent<LF_Plan.percent) {
+    LF_Plan.percent = (uint8_t)percent;
+  } else if (percent>LF_Plan.percent) {
+    LF_Plan.percent++;
+  }
+  return LF_Plan.percent;
+}
+
 
 /*!
  * \brief follows a line segment.
@@ -222,92 +444,600 @@ static void StateMachine2(void){
 static bool FollowSegment(void){
   uint16_t currLine;
   REF_LineKind currLineKind;
+#if PL_CONFIG_HAS_LINE_TRACK
+  int32_t speed, curv;
+  uint8_t percent;
+#endif
+#if PL_CONFIG_HAS_LINE_MAZE && PL_CONFIG_HAS_LINE_JUNCTION
+  uint32_t runPercent;
+#endif
 
-  currLine = REF_GetLineValue();
-  currLineKind = REF_GetLineKind();
+  LF_GetLine(&currLine, &currLineKind);
+  LF_lineKind = currLineKind;
+#if PL_CONFIG_HAS_LINE_TRACK
+  TRACK_Update(currLineKind);
+#endif
+#if PL_CONFIG_HAS_LINE_LAP
+  LAP_Update(currLineKind);
+#endif
+#if PL_CONFIG_HAS_LINE_MAZE
+  LF_mazeJunction = FALSE;
+#if PL_CONFIG_HAS_LINE_JUNCTION
+  if (LF_mazeMode && MAZE_IsRunning()) {
+    if (MAZE_RunAtTurn()) { /* known route: turn where the map tells, without probing the intersection */
+      LF_mazeJunction = TRUE;
+      return FALSE;
+    }
+  } else if (LF_mazeMode && currLineKind==REF_LINE_STRAIGHT) {
+    switch(JCT_Classify(NULL)) {
+      case JCT_LEFT_STRAIGHT:
+      case JCT_RIGHT_STRAIGHT:
+      case JCT_CROSS:
+        LF_mazeJunction = TRUE;
+        return FALSE; /* branch beside the line: the maze rule decides */
+      default:
+        break;
+    }
+  }
+#endif
+#endif
   if (currLineKind==REF_LINE_STRAIGHT) {
-    PID_Line(currLine, REF_MIDDLE_LINE_VALUE); /* move along the line */
+    LF_lineOffset = (3*LF_lineOffset+((int32_t)currLine-REF_MIDDLE_LINE_VALUE))/4; /* to know where to search if we lose it */
+    LF_GovUpdate(currLine);
+#if PL_CONFIG_HAS_LINE_TRACK
+    if (TRACK_GetFeedForward(&speed, &curv)) { /* known track: use planned speed and steer into the curve */
+      speed = (speed*100)/LF_Plan.fullSpeed;
+      if (speed>100) {
+        speed = 100;
+      } else if (speed<LF_PLAN_MIN_PERCENT) {
+        speed = LF_PLAN_MIN_PERCENT;
+      }
+      percent = (uint8_t)speed;
+      /* difference of the wheel speeds for the curvature: v*k*wheelBase, with v as PWM value */
+      curv = ((((int32_t)percent*(0xffff/100))*(curv/10))/1000)*ODO_GetWheelBaseMm()/100;
+      PID_LineFeedForward(currLine, REF_MIDDLE_LINE_VALUE, percent, curv);
+      return TRUE;
+    }
+#endif
+#if PL_CONFIG_HAS_LINE_MAZE && PL_CONFIG_HAS_LINE_JUNCTION
+    if (LF_mazeMode && MAZE_IsRunning()) { /* speed profile of the speed run */
+      runPercent = ((uint32_t)MAZE_RunSpeed()*100)/LF_Plan.fullSpeed;
+      if (runPercent>100) {
+        runPercent = 100;
+      } else if (runPercent<LF_PLAN_MIN_PERCENT) {
+        runPercent = LF_PLAN_MIN_PERCENT;
+      }
+      PID_LineSpeed(currLine, REF_MIDDLE_LINE_VALUE, (uint8_t)runPercent);
+      return TRUE;
+    }
+#endif
+    if (LF_Plan.enabled) {
+      PID_LineSpeed(currLine, REF_MIDDLE_LINE_VALUE, LF_PlanSpeed(currLine)); /* move along the line, with planned speed */
+    } else if (LF_Gov.enabled) {
+      PID_LineSpeed(currLine, REF_MIDDLE_LINE_VALUE, LF_GovPercent()); /* move along the line, with adapted speed */
+    } else {
+      PID_Line(currLine, REF_MIDDLE_LINE_VALUE); /* move along the line */
+    }
     return TRUE;
+#if PL_CONFIG_HAS_LINE_JUNCTION
+  } else if (currLineKind!=REF_LINE_NONE && JCT_Classify(NULL)==JCT_PENDING) {
+    return TRUE; /* crossing side lines: keep the motors as they are until the junction is known */
+#endif
   } else {
     return FALSE; /* intersection/change of direction or not on line any more */
   }
 }
 
-static void StateMachine(void) {
-  switch (LF_currState) {
-    case STATE_IDLE:
-      break;
-    case STATE_FOLLOW_SEGMENT:
-      if (!FollowSegment()) {
-    #if PL_CONFIG_HAS_LINE_MAZE
-        LF_currState = STATE_TURN; /* make turn */
-        SHELL_SendString((unsigned char*)"no line, turn..\r\n");
-    #else
-        LF_currState = STATE_STOP; /* stop if we do not have a line any more */
-        SHELL_SendString((unsigned char*)"No line, stopped!\r\n");
-    #endif
-      }
-      break;
 
-    case STATE_TURN:
-      #if PL_CONFIG_HAS_LINE_MAZE
-      /*! \todo Handle maze turning */
-		#else
-    	TURN_TurnAngle(180, NULL);    //changed by Kusi
-    	TURN_Turn(TURN_STOP, NULL);	//changed by Kusi
-    	//FSM_state = BACK;  //changed by Kusi
-    	DRV_SetMode(DRV_MODE_NONE);			// changed by Kevin
-    	LF_currState = STATE_IDLE;
-
-		#endif /* PL_CONFIG_HAS_LINE_MAZE */
-      break;
+/* ---------------------------- actions ---------------------------- */
+static void LF_EnterFollow(void) {
+  LF_followState = LF_state;
+  DRV_SetMode(DRV_MODE_NONE); /* disable any drive mode, the line PID drives the motors */
+  PID_Start();
+  LF_PlanReset();
+#if PL_CONFIG_HAS_LINE_JUNCTION
+  JCT_Clear(); /* side lines seen before a turn do not belong to the new segment */
+#endif
+}
 
-    case STATE_FINISHED:
-      #if PL_CONFIG_HAS_LINE_MAZE
-      /*! \todo Handle maze finished */
-      #endif /* PL_CONFIG_HAS_LINE_MAZE */
-      break;
-    case STATE_STOP:
-    	DRV_Stop(10);
-    	DRV_SetMode(DRV_MODE_STOP);
-      SHELL_SendString("Stopped!\r\n");
-
-//#if PL_CONFIG_HAS_TURN
-    //  TURN_Turn(TURN_STOP, NULL);  //commented by Kusi
-//#endif
-      LF_currState = STATE_IDLE;
-      break;
-  } /* switch */
+static void LF_EnterTurn(void) {
+#if PL_CONFIG_HAS_TURN
+  LF_StartTurn(LF_TURN_U);
+#else
+  LF_PostEvent(LF_EVT_TURN_DONE);
+#endif
+}
+
+static void LF_EnterFinish(void) {
+  DRV_Reset();
+  DRV_SetMode(DRV_MODE_POS);
+  DRV_SetPos(300, 300); /* move into the start area */
+}
+
+static void LF_EnterPaused(void) {
+  DRV_Stop(10);
+  DRV_SetMode(DRV_MODE_STOP);
+#if PL_CONFIG_HAS_LINE_TRACK
+  TRACK_EndLap(FALSE); /* lap is not complete */
+#endif
+#if PL_CONFIG_HAS_LINE_LAP
+  LAP_Stop();
+#endif
+}
+
+static void LF_EnterIdle(void) {
+  DRV_SetSpeed(0, 0);
+  DRV_SetMode(DRV_MODE_STOP);
+#if PL_CONFIG_HAS_LINE_MAZE && PL_CONFIG_HAS_LINE_JUNCTION
+  MAZE_StopRun();
+#endif
+#if PL_CONFIG_HAS_LINE_LAP
+  LAP_Stop();
+#endif
+}
+
+static bool LF_StartLap(void) {
+  LF_GovReset();
+#if PL_CONFIG_HAS_LINE_MAZE
+  if (LF_mazeMode) {
+#if PL_CONFIG_HAS_LINE_JUNCTION
+    if (!MAZE_StartRun()) { /* speed run if the maze has been solved */
+      MAZE_Start(); /* otherwise explore it */
+    }
+#else
+    MAZE_Start(); /* explore the maze */
+#endif
+  }
+#endif
+#if PL_CONFIG_HAS_LINE_LAP
+  LAP_Start();
+#endif
+#if PL_CONFIG_HAS_LINE_TRACK
+  TRACK_StartLap();
+#endif
+  return TRUE;
+}
+
+/* follows the line, returns TRUE if the line has been lost and we try to recover */
+static bool LF_LineLost(void) {
+  LF_framePending = FALSE;
+  if (FollowSegment()) {
+    return FALSE;
+  }
+#if PL_CONFIG_HAS_ODOMETRY
+  return LF_lineKind==REF_LINE_NONE && LF_Recover.gapMm!=0
+#if PL_CONFIG_HAS_LINE_MAZE
+      && !LF_mazeMode /* no gaps in a maze: it is a dead end */
+#endif
+#if PL_CONFIG_HAS_LINE_JUNCTION
+      && JCT_Classify(NULL)==JCT_END /* side lines before: it is a junction and not a gap */
+#endif
+      ;
+#else
+  return FALSE;
+#endif
+}
+
+/* returns TRUE if the line segment has ended, checked after LF_LineLost() */
+static bool LF_LineEnded(void) {
+#if PL_CONFIG_HAS_LINE_MAZE
+  if (LF_mazeJunction) {
+    return TRUE;
+  }
+#endif
+  return LF_lineKind!=REF_LINE_STRAIGHT;
+}
+
+#if PL_CONFIG_HAS_ODOMETRY
+static void LF_EnterBridge(void) {
+  ODO_Pose pose;
+  int32_t speed, speedL, speedR;
+
+  ODO_GetPose(&pose);
+  LF_Recover.heading = pose.heading;
+  LF_Recover.startDistUm = ODO_GetDistanceUm();
+  LF_Recover.side = (LF_lineOffset<0)?1:-1; /* line value below the middle: line is on the left side */
+  LF_Recover.nofLost++;
+  LF_GetWheelSpeeds(&speedL, &speedR);
+  speed = (speedL+speedR)/2;
+  if (speed<LF_RECOVER_MIN_SPEED) {
+    speed = LF_RECOVER_MIN_SPEED;
+  }
+  LF_Recover.speed = speed;
+  DRV_SetMode(DRV_MODE_SPEED);
+  DRV_SetSpeed(speed, speed);
+}
+
+/* returns TRUE if the line is seen again */
+static bool LF_LineFound(void) {
+  uint16_t line;
+  REF_LineKind kind;
+
+  LF_framePending = FALSE;
+  LF_GetLine(&line, &kind);
+  if (kind!=REF_LINE_NONE) {
+    LF_Recover.nofFound++;
+    return TRUE;
+  }
+  return FALSE;
+}
+
+/* keeps the heading, returns TRUE if the maximum gap length has been driven */
+static bool LF_BridgeEnded(void) {
+  ODO_Pose pose;
+  int32_t corr;
+
+  if (ODO_GetDistanceUm()-LF_Recover.startDistUm>=(int32_t)LF_Recover.gapMm*1000) {
+    return TRUE;
+  }
+  ODO_GetPose(&pose);
+  corr = (int16_t)(LF_Recover.heading-pose.heading)/LF_RECOVER_HEADING_GAIN; /* positive: turn left */
+  if (corr>LF_Recover.speed/2) {
+    corr = LF_Recover.speed/2;
+  } else if (corr<-LF_Recover.speed/2) {
+    corr = -LF_Recover.speed/2;
+  }
+  DRV_SetSpeed(LF_Recover.speed-corr, LF_Recover.speed+corr);
+  return FALSE;
+}
+
+/* turns through the search pattern, returns TRUE if the pattern is finished */
+static bool LF_SearchDone(void) {
+  ODO_Pose pose;
+  int32_t angle, target;
+  int8_t dir;
+
+  ODO_GetPose(&pose);
+  angle = ((int32_t)(int16_t)(pose.heading-LF_Recover.heading)*360)/0x10000; /* degree, relative to where the line got lost */
+  for(;;) {
+    switch(LF_Recover.phase) {
+      case 0:  target = LF_Recover.side*LF_Recover.searchDeg; dir = LF_Recover.side; break;  /* side where the line has been seen last */
+      case 1:  target = -LF_Recover.side*LF_Recover.searchDeg; dir = -LF_Recover.side; break; /* other side */
+      case 2:  target = 0; dir = LF_Recover.side; break; /* back to the middle */
+      default:
+        DRV_SetSpeed(0, 0);
+        return TRUE;
+    }
+    if ((angle-target)*dir<0) { /* not reached yet */
+      DRV_SetSpeed(-dir*LF_RECOVER_SEARCH_SPEED, dir*LF_RECOVER_SEARCH_SPEED);
+      return FALSE;
+    }
+    LF_Recover.phase++;
+  }
+}
+
+static void LF_EnterSearch(void) {
+  LF_Recover.phase = 0;
+  (void)LF_SearchDone(); /* start turning */
+}
+#endif /* PL_CONFIG_HAS_ODOMETRY */
+
+#if PL_CONFIG_HAS_LINE_MAZE
+static void LF_EnterMaze(void) {
+  LF_StartTurn(LF_TURN_MAZE);
+}
+
+static bool LF_MazeFinished(void) {
+  return LF_mazeFinished;
+}
+
+static bool LF_MazeFailed(void) {
+  return LF_mazeFailed;
+}
+#endif /* PL_CONFIG_HAS_LINE_MAZE */
+
+static bool LF_IgnoreFrame(void) {
+  LF_framePending = FALSE;
+  return FALSE;
+}
+
+static bool LF_IsStopped(void) {
+  int32_t speedL, speedR;
+
+  LF_GetWheelSpeeds(&speedL, &speedR);
+  if (speedR<=30 && speedL<=30) {
+#if PL_CONFIG_HAS_LINE_TRACK
+    TRACK_EndLap(TRUE);
+#endif
+    return TRUE;
+  }
+  return FALSE;
+}
+
+/* ---------------------------- tables ---------------------------- */
+static const LF_StateDesc LF_States[LF_NOF_STATES] = {
+  /* name       parent            entry           exit           timeout signal */
+  {"ROOT",      LF_STATE_NONE,    NULL,           NULL,          0,  '\0'},
+  {"IDLE",      LF_STATE_ROOT,    LF_EnterIdle,   NULL,          0,  '\0'},
+  {"ACTIVE",    LF_STATE_ROOT,    NULL,           NULL,          0,  '\0'},
+  {"FORWARD",   LF_STATE_ACTIVE,  LF_EnterFollow, NULL,          0,  'B'},
+#if PL_CONFIG_HAS_TURN
+  {"TURN",      LF_STATE_ACTIVE,  LF_EnterTurn,   LF_CancelTurn, 0,  '\0'},
+#else
+  {"TURN",      LF_STATE_ACTIVE,  LF_EnterTurn,   NULL,          0,  '\0'},
+#endif
+  {"BACK",      LF_STATE_ACTIVE,  LF_EnterFollow, NULL,          0,  '\0'},
+  {"FINISH",    LF_STATE_ACTIVE,  LF_EnterFinish, NULL,          10, 'C'},
+  {"PAUSED",    LF_STATE_ROOT,    LF_EnterPaused, NULL,          0,  '\0'},
+#if PL_CONFIG_HAS_ODOMETRY
+  {"BRIDGE",    LF_STATE_ACTIVE,  LF_EnterBridge, NULL,          0,  '\0'},
+  {"SEARCH",    LF_STATE_ACTIVE,  LF_EnterSearch, NULL,          0,  '\0'},
+#else
+  {"BRIDGE",    LF_STATE_ACTIVE,  NULL,           NULL,          0,  '\0'},
+  {"SEARCH",    LF_STATE_ACTIVE,  NULL,           NULL,          0,  '\0'},
+#endif
+#if PL_CONFIG_HAS_LINE_MAZE
+  {"MAZE",      LF_STATE_ACTIVE,  LF_EnterMaze,   LF_CancelTurn, 0,  '\0'},
+#else
+  {"MAZE",      LF_STATE_ACTIVE,  NULL,           NULL,          0,  '\0'},
+#endif
+};
+
+static const LF_Transition LF_Transitions[] = {
+  /* state             event               action          target */
+  {LF_STATE_IDLE,     LF_EVT_START,       LF_StartLap,    LF_STATE_FORWARD},
+  {LF_STATE_IDLE,     LF_EVT_START_STOP,  LF_StartLap,    LF_STATE_FORWARD},
+  {LF_STATE_FORWARD,  LF_EVT_FRAME,       LF_LineLost,    LF_STATE_BRIDGE},
+  {LF_STATE_FORWARD,  LF_EVT_FRAME,       LF_LineEnded,   LF_STATE_LINE_END},
+  {LF_STATE_TURN,     LF_EVT_TURN_DONE,   NULL,           LF_STATE_BACK},
+  {LF_STATE_BACK,     LF_EVT_FRAME,       LF_LineLost,    LF_STATE_BRIDGE},
+  {LF_STATE_BACK,     LF_EVT_FRAME,       LF_LineEnded,   LF_STATE_LINE_END},
+#if PL_CONFIG_HAS_ODOMETRY
+  {LF_STATE_BRIDGE,   LF_EVT_FRAME,       LF_LineFound,   LF_STATE_FOLLOW},
+  {LF_STATE_BRIDGE,   LF_EVT_FRAME,       LF_BridgeEnded, LF_STATE_SEARCH},
+  {LF_STATE_SEARCH,   LF_EVT_FRAME,       LF_LineFound,   LF_STATE_FOLLOW},
+  {LF_STATE_SEARCH,   LF_EVT_FRAME,       LF_SearchDone,  LF_STATE_LINE_END},
+#endif
+#if PL_CONFIG_HAS_LINE_MAZE
+  {LF_STATE_MAZE,     LF_EVT_TURN_DONE,   LF_MazeFinished, LF_STATE_FINISH},
+  {LF_STATE_MAZE,     LF_EVT_TURN_DONE,   LF_MazeFailed,  LF_STATE_IDLE},
+  {LF_STATE_MAZE,     LF_EVT_TURN_DONE,   NULL,           LF_STATE_FOLLOW},
+  {LF_STATE_MAZE,     LF_EVT_STOP,        NULL,           LF_STATE_IDLE},    /* a maze turn cannot be resumed: stop the run */
+  {LF_STATE_MAZE,     LF_EVT_START_STOP,  NULL,           LF_STATE_IDLE},
+#endif
+  {LF_STATE_FINISH,   LF_EVT_TIMEOUT,     LF_IsStopped,   LF_STATE_IDLE},
+  {LF_STATE_FINISH,   LF_EVT_START_STOP,  LF_StartLap,    LF_STATE_FORWARD}, /* start the next lap */
+  {LF_STATE_ACTIVE,   LF_EVT_STOP,        NULL,           LF_STATE_PAUSED},
+  {LF_STATE_ACTIVE,   LF_EVT_START_STOP,  NULL,           LF_STATE_PAUSED},
+  {LF_STATE_PAUSED,   LF_EVT_START,       NULL,           LF_STATE_HISTORY},
+  {LF_STATE_PAUSED,   LF_EVT_START_STOP,  NULL,           LF_STATE_HISTORY},
+  {LF_STATE_ROOT,     LF_EVT_FRAME,       LF_IgnoreFrame, LF_STATE_NONE},
+};
+
+/* ---------------------------- engine ---------------------------- */
+static bool LF_IsInState(LF_State state, LF_State parent) {
+  while (state!=LF_STATE_NONE) {
+    if (state==parent) {
+      return TRUE;
+    }
+    state = LF_States[state].parent;
+  }
+  return FALSE;
+}
+
+static void LF_Trace(LF_State from, LF_State to, LF_Event event) {
+  LF_TraceEntry *p;
+
+  p = &LF_trace[LF_traceWriteIdx&(LF_TRACE_SIZE-1)];
+  p->ticks = FRTOS1_xTaskGetTickCount();
+  p->from = (uint8_t)from;
+  p->to = (uint8_t)to;
+  p->event = (uint8_t)event;
+  LF_traceWriteIdx++;
+}
+
+/* marks a contest signal to be sent by the shell task */
+static void LF_PostSignal(char signal) {
+  unsigned int i;
+
+  for(i=0;i<sizeof(LF_SignalChars);i++) {
+    if (LF_SignalChars[i]==signal) {
+      FRTOS1_taskENTER_CRITICAL();
+      LF_signalsPending |= (uint8_t)(1<<i);
+      FRTOS1_taskEXIT_CRITICAL();
+      return;
+    }
+  }
+}
+
+static void LF_Transit(LF_State target, LF_Event event) {
+  LF_State from = LF_state, s;
+  bool isReturn;
+
+  isReturn = (target==LF_STATE_FOLLOW || target==LF_STATE_HISTORY); /* back after a recovery or a pause, not a new start */
+  if (target==LF_STATE_HISTORY) {
+    target = LF_resumeState;
+  } else if (target==LF_STATE_FOLLOW) {
+    target = LF_followState;
+  } else if (target==LF_STATE_LINE_END) {
+    target = (LF_followState==LF_STATE_FORWARD)?LF_STATE_TURN:LF_STATE_FINISH;
+#if PL_CONFIG_HAS_LINE_MAZE
+    if (LF_mazeMode && LF_followState==LF_STATE_FORWARD) {
+      target = LF_STATE_MAZE;
+    }
+#endif
+  }
+  if (LF_IsInState(target, LF_STATE_ACTIVE)) {
+    LF_resumeState = target;
+  }
+  /* exit up to the common parent. A transition to the same state exits and enters it again */
+  s = from;
+  while (s!=LF_STATE_NONE && (s==target || !LF_IsInState(target, s))) {
+    if (LF_States[s].exit!=NULL) {
+      LF_States[s].exit();
+    }
+    s = LF_States[s].parent;
+  }
+  LF_state = target;
+  LF_Trace(from, target, event);
+  if (!isReturn && LF_States[target].signal!='\0') {
+    LF_PostSignal(LF_States[target].signal);
+  }
+  LF_timeoutTicks = FRTOS1_xTaskGetTickCount()+LF_States[target].timeoutMs/portTICK_PERIOD_MS;
+  /* enter from below the common parent down to the target */
+  while (s!=target) {
+    LF_State t = target;
+
+    while (LF_States[t].parent!=s) {
+      t = LF_States[t].parent;
+    }
+    if (LF_States[t].entry!=NULL) {
+      LF_States[t].entry();
+    }
+    s = t;
+  }
+}
+
+static void LF_Dispatch(LF_Event event) {
+  LF_State s;
+  unsigned int i;
+  bool handled;
+
+  for(s=LF_state; s!=LF_STATE_NONE; s=LF_States[s].parent) { /* from the current state up to the root */
+    handled = FALSE;
+    for(i=0;i<sizeof(LF_Transitions)/sizeof(LF_Transitions[0]);i++) {
+      if (LF_Transitions[i].state==s && LF_Transitions[i].event==event) {
+        handled = TRUE;
+        if (LF_Transitions[i].action==NULL || LF_Transitions[i].action()) {
+          if (LF_Transitions[i].target!=LF_STATE_NONE) {
+            LF_Transit(LF_Transitions[i].target, event);
+          }
+          return;
+        }
+      }
+    }
+    if (handled) {
+      return; /* event consumed by this state, without transition */
+    }
+  }
+  /* event not handled */
 }
 
 bool LF_IsFollowing(void) {
-  return LF_currState!=STATE_IDLE;
+  return LF_IsInState(LF_state, LF_STATE_ACTIVE);
 }
 
 static void LineTask (void *pvParameters) {
-  uint32_t notifcationValue;
+  uint8_t evt;
+  uint32_t now;
+  portTickType wait;
+
+  (void)pvParameters; /* not used */
+  for(;;) {
+    wait = portMAX_DELAY;
+    if (LF_States[LF_state].timeoutMs!=0) {
+      now = FRTOS1_xTaskGetTickCount();
+      wait = ((int32_t)(LF_timeoutTicks-now)>0)?(portTickType)(LF_timeoutTicks-now):0;
+    }
+    if (FRTOS1_xQueueReceive(LF_EventQueue, &evt, wait)==pdPASS) {
+      LF_Dispatch((LF_Event)evt);
+    } else { /* timeout: restart it and notify the state */
+      LF_timeoutTicks = FRTOS1_xTaskGetTickCount()+LF_States[LF_state].timeoutMs/portTICK_PERIOD_MS;
+      LF_Dispatch(LF_EVT_TIMEOUT);
+    }
+  }
+}
+
+#if PL_CONFIG_HAS_TURN
+static void LF_RunTurn(LF_TurnJob job) {
+  switch(job) {
+    case LF_TURN_U:
+      (void)TURN_TurnOntoLine(TURN_RIGHT180, LF_TurnCancelled); /* back onto the line we came from */
+      break;
+#if PL_CONFIG_HAS_LINE_MAZE
+    case LF_TURN_MAZE:
+#if PL_CONFIG_HAS_LINE_JUNCTION
+      if (MAZE_IsRunning()) {
+        LF_mazeFailed = MAZE_RunTurn(&LF_mazeFinished, LF_TurnCancelled)!=ERR_OK;
+        break;
+      }
+#endif
+      LF_mazeFailed = MAZE_EvaluteTurn(&LF_mazeFinished, LF_TurnCancelled)!=ERR_OK;
+      break;
+#endif
+    default:
+      break;
+  }
+}
+
+static void TurnTask(void *pvParameters) {
+  LF_TurnRequest req;
+  bool done;
 
   (void)pvParameters; /* not used */
   for(;;) {
-    (void)xTaskNotifyWait(0UL, LF_START_FOLLOWING|LF_STOP_FOLLOWING, &notifcationValue, 0); /* check flags */
-    if (notifcationValue&LF_START_FOLLOWING) {
-      DRV_SetMode(DRV_MODE_NONE); /* disable any drive mode */
-      PID_Start();
-      if((FSM_state==BREAK)){
-    	  FSM_state = FSM_state_save;
-      }else{
-    	  FSM_state = START;  //start
+    if (FRTOS1_xQueueReceive(LF_TurnQueue, &req, portMAX_DELAY)==pdPASS) {
+      LF_turnRunId = req.id;
+      if (!LF_TurnCancelled()) {
+        LF_RunTurn((LF_TurnJob)req.job);
+      }
+      FRTOS1_taskENTER_CRITICAL(); /* the line task must not cancel it between the check and the event */
+      done = !LF_TurnCancelled();
+      if (done) {
+        LF_PostEvent(LF_EVT_TURN_DONE); /* the next state sets the drive mode */
+      }
+      FRTOS1_taskEXIT_CRITICAL();
+      if (!done) { /* do not leave the motors with the last set point of the turn */
+        DRV_SetSpeed(0, 0);
+        DRV_SetMode(DRV_MODE_STOP);
       }
-      writeflag = FALSE;//continue, were you were stopped
-     // LF_currState = STATE_FOLLOW_SEGMENT;  //changed by Kusi
     }
-    if (notifcationValue&LF_STOP_FOLLOWING) {
-    	FSM_state = BREAK;
-     // LF_currState = STATE_STOP;  //changed by Kusi
+  }
+}
+#endif /* PL_CONFIG_HAS_TURN */
+
+static void LF_PrintTraceEntry(const LF_TraceEntry *p, const CLS1_StdIOType *io) {
+  unsigned char buf[64];
+
+  UTIL1_strcpy(buf, sizeof(buf), (unsigned char*)"line: ");
+  UTIL1_strcatNum32u(buf, sizeof(buf), p->ticks*portTICK_PERIOD_MS);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" ms ");
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)LF_States[p->from].name);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" -> ");
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)LF_States[p->to].name);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" (");
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)LF_EventNames[p->event]);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)")\r\n");
+  CLS1_SendStr(buf, io->stdOut);
+}
+
+void LF_FlushLog(const CLS1_StdIOType *io) {
+  LF_TraceEntry entry;
+  uint8_t pending;
+  unsigned int i, j;
+
+#if PL_CONFIG_HAS_LINE_LAP
+  LAP_FlushResults(); /* radio messages are sent from here, not from the line task */
+#endif
+  FRTOS1_taskENTER_CRITICAL();
+  pending = LF_signalsPending;
+  LF_signalsPending = 0;
+  FRTOS1_taskEXIT_CRITICAL();
+  for(i=0;i<sizeof(LF_SignalChars);i++) {
+    if (pending&(1<<i)) {
+      for(j=0;j<LF_SIGNAL_REPEAT;j++) {
+        ContestSendSignal(LF_SignalChars[i]);
+      }
     }
-    StateMachine2();
-    StateMachine();
-    FRTOS1_vTaskDelay(5/portTICK_PERIOD_MS);
+  }
+  while (LF_traceReadIdx!=LF_traceWriteIdx) {
+    if (LF_traceWriteIdx-LF_traceReadIdx>LF_TRACE_SIZE) { /* overrun, skip the lost entries */
+      LF_traceReadIdx = LF_traceWriteIdx-LF_TRACE_SIZE;
+    }
+    entry = LF_trace[LF_traceReadIdx&(LF_TRACE_SIZE-1)];
+    LF_traceReadIdx++;
+    LF_PrintTraceEntry(&entry, io);
+  }
+}
+
+static void LF_PrintTrace(const CLS1_StdIOType *io) {
+  uint32_t idx, end;
+
+  end = LF_traceWriteIdx;
+  idx = (end>LF_TRACE_SIZE)?end-LF_TRACE_SIZE:0;
+  while (idx!=end) {
+    LF_PrintTraceEntry(&LF_trace[idx&(LF_TRACE_SIZE-1)], io);
+    idx++;
   }
 }
 
@@ -315,34 +1045,96 @@ static void LF_PrintHelp(const CLS1_StdIOType *io) {
   CLS1_SendHelpStr((unsigned char*)"line", (unsigned char*)"Group of line following commands\r\n", io->stdOut);
   CLS1_SendHelpStr((unsigned char*)"  help|status", (unsigned char*)"Shows line help or status\r\n", io->stdOut);
   CLS1_SendHelpStr((unsigned char*)"  start|stop", (unsigned char*)"Starts or stops line following\r\n", io->stdOut);
+  CLS1_SendHelpStr((unsigned char*)"  trace", (unsigned char*)"Prints the last state transitions\r\n", io->stdOut);
+  CLS1_SendHelpStr((unsigned char*)"  plan (on|off)", (unsigned char*)"Enables or disables the curvature speed planner\r\n", io->stdOut);
+  CLS1_SendHelpStr((unsigned char*)"  plan alat <mm/s^2>", (unsigned char*)"Lateral acceleration limit\r\n", io->stdOut);
+  CLS1_SendHelpStr((unsigned char*)"  plan fullspeed <mm/s>", (unsigned char*)"Speed at 100% PWM\r\n", io->stdOut);
+  CLS1_SendHelpStr((unsigned char*)"  plan boost <%>", (unsigned char*)"Speed limit on straights\r\n", io->stdOut);
+  CLS1_SendHelpStr((unsigned char*)"  gov (on|off)", (unsigned char*)"Enables or disables the speed governor\r\n", io->stdOut);
+  CLS1_SendHelpStr((unsigned char*)"  gov (min|max) <%>", (unsigned char*)"Bounds of the governed speed limit\r\n", io->stdOut);
+  CLS1_SendHelpStr((unsigned char*)"  gov tight <err>", (unsigned char*)"Line error deviation for tight tracking, 1000 is one sensor\r\n", io->stdOut);
+  CLS1_SendHelpStr((unsigned char*)"  gov sat <permille>", (unsigned char*)"Accepted rate of saturated PID outputs\r\n", io->stdOut);
+#if PL_CONFIG_HAS_LINE_MAZE
+  CLS1_SendHelpStr((unsigned char*)"  maze (on|off)", (unsigned char*)"Explores a line maze, junctions are handled by the maze rule\r\n", io->stdOut);
+#endif
+#if PL_CONFIG_HAS_ODOMETRY
+  CLS1_SendHelpStr((unsigned char*)"  gap <mm>", (unsigned char*)"Maximum line gap to bridge, 0 disables the lost line recovery\r\n", io->stdOut);
+  CLS1_SendHelpStr((unsigned char*)"  search <deg>", (unsigned char*)"Angle to each side to search a lost line\r\n", io->stdOut);
+#endif
 }
 
 static void LF_PrintStatus(const CLS1_StdIOType *io) {
+  unsigned char buf[32];
+
   CLS1_SendStatusStr((unsigned char*)"line follow", (unsigned char*)"\r\n", io->stdOut);
-  switch (LF_currState) {
-    case STATE_IDLE: 
-      CLS1_SendStatusStr((unsigned char*)"  state", (unsigned char*)"IDLE\r\n", io->stdOut);
-      break;
-    case STATE_FOLLOW_SEGMENT: 
-      CLS1_SendStatusStr((unsigned char*)"  state", (unsigned char*)"FOLLOW_SEGMENT\r\n", io->stdOut);
-      break;
-    case STATE_STOP: 
-      CLS1_SendStatusStr((unsigned char*)"  state", (unsigned char*)"STOP\r\n", io->stdOut);
-      break;
-    case STATE_TURN: 
-      CLS1_SendStatusStr((unsigned char*)"  state", (unsigned char*)"TURN\r\n", io->stdOut);
-      break;
-    case STATE_FINISHED: 
-      CLS1_SendStatusStr((unsigned char*)"  state", (unsigned char*)"FINISHED\r\n", io->stdOut);
-      break;
-    default: 
-      CLS1_SendStatusStr((unsigned char*)"  state", (unsigned char*)"UNKNOWN\r\n", io->stdOut);
-      break;
-  } /* switch */
+  UTIL1_strcpy(buf, sizeof(buf), (unsigned char*)LF_States[LF_state].name);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)"\r\n");
+  CLS1_SendStatusStr((unsigned char*)"  state", buf, io->stdOut);
+
+  CLS1_SendStatusStr((unsigned char*)"  plan", LF_Plan.enabled?(unsigned char*)"on\r\n":(unsigned char*)"off\r\n", io->stdOut);
+
+  UTIL1_Num32sToStr(buf, sizeof(buf), LF_Plan.latAccel);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" mm/s^2\r\n");
+  CLS1_SendStatusStr((unsigned char*)"  alat", buf, io->stdOut);
+
+  UTIL1_Num32sToStr(buf, sizeof(buf), LF_Plan.fullSpeed);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" mm/s at 100%\r\n");
+  CLS1_SendStatusStr((unsigned char*)"  fullspeed", buf, io->stdOut);
+
+  UTIL1_Num8uToStr(buf, sizeof(buf), LF_Plan.boostPercent);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)"%\r\n");
+  CLS1_SendStatusStr((unsigned char*)"  boost", buf, io->stdOut);
+
+  UTIL1_Num32sToStr(buf, sizeof(buf), LF_Plan.curv);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" 1/km, limit ");
+  UTIL1_strcatNum8u(buf, sizeof(buf), LF_Plan.percent);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)"%\r\n");
+  CLS1_SendStatusStr((unsigned char*)"  curvature", buf, io->stdOut);
+
+  UTIL1_strcpy(buf, sizeof(buf), LF_Gov.enabled?(unsigned char*)"on, ":(unsigned char*)"off, ");
+  UTIL1_strcatNum8u(buf, sizeof(buf), LF_Gov.minPercent);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)"..");
+  UTIL1_strcatNum8u(buf, sizeof(buf), LF_Gov.maxPercent);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)"%, limit ");
+  UTIL1_strcatNum8u(buf, sizeof(buf), LF_GovPercent());
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)"%\r\n");
+  CLS1_SendStatusStr((unsigned char*)"  gov", buf, io->stdOut);
+
+  UTIL1_Num32uToStr(buf, sizeof(buf), UTIL_ISqrt((uint32_t)LF_Gov.var));
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" (tight ");
+  UTIL1_strcatNum16u(buf, sizeof(buf), LF_Gov.tightErr);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)")\r\n");
+  CLS1_SendStatusStr((unsigned char*)"  gov error", buf, io->stdOut);
+
+  UTIL1_Num32sToStr(buf, sizeof(buf), LF_Gov.sat);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" permille (max ");
+  UTIL1_strcatNum16u(buf, sizeof(buf), LF_Gov.satPermille);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)")\r\n");
+  CLS1_SendStatusStr((unsigned char*)"  gov sat", buf, io->stdOut);
+
+#if PL_CONFIG_HAS_ODOMETRY
+  UTIL1_Num16uToStr(buf, sizeof(buf), LF_Recover.gapMm);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" mm, search ");
+  UTIL1_strcatNum8u(buf, sizeof(buf), LF_Recover.searchDeg);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" deg\r\n");
+  CLS1_SendStatusStr((unsigned char*)"  gap", buf, io->stdOut);
+
+  UTIL1_Num16uToStr(buf, sizeof(buf), LF_Recover.nofLost);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" lost, ");
+  UTIL1_strcatNum16u(buf, sizeof(buf), LF_Recover.nofFound);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" found\r\n");
+  CLS1_SendStatusStr((unsigned char*)"  recovery", buf, io->stdOut);
+#endif
+#if PL_CONFIG_HAS_LINE_MAZE
+  CLS1_SendStatusStr((unsigned char*)"  maze", LF_mazeMode?(unsigned char*)"on\r\n":(unsigned char*)"off\r\n", io->stdOut);
+#endif
 }
 
 uint8_t LF_ParseCommand(const unsigned char *cmd, bool *handled, const CLS1_StdIOType *io) {
   uint8_t res = ERR_OK;
+  const unsigned char *p;
+  uint16_t val16u;
+  uint8_t val8u;
 
   if (UTIL1_strcmp((char*)cmd, (char*)CLS1_CMD_HELP)==0 || UTIL1_strcmp((char*)cmd, (char*)"line help")==0) {
     LF_PrintHelp(io);
@@ -356,6 +1148,114 @@ uint8_t LF_ParseCommand(const unsigned char *cmd, bool *handled, const CLS1_StdI
   } else if (UTIL1_strcmp((char*)cmd, (char*)"line stop")==0) {
     LF_StopFollowing();
     *handled = TRUE;
+  } else if (UTIL1_strcmp((char*)cmd, (char*)"line trace")==0) {
+    LF_PrintTrace(io);
+    *handled = TRUE;
+#if PL_CONFIG_HAS_LINE_MAZE
+  } else if (UTIL1_strcmp((char*)cmd, (char*)"line maze on")==0) {
+    LF_mazeMode = TRUE;
+    *handled = TRUE;
+  } else if (UTIL1_strcmp((char*)cmd, (char*)"line maze off")==0) {
+    LF_mazeMode = FALSE;
+    *handled = TRUE;
+#endif
+  } else if (UTIL1_strcmp((char*)cmd, (char*)"line plan on")==0) {
+    LF_PlanReset();
+    LF_Plan.enabled = TRUE;
+    *handled = TRUE;
+  } else if (UTIL1_strcmp((char*)cmd, (char*)"line plan off")==0) {
+    LF_Plan.enabled = FALSE;
+    *handled = TRUE;
+  } else if (UTIL1_strncmp((char*)cmd, (char*)"line plan alat ", sizeof("line plan alat ")-1)==0) {
+    p = cmd+sizeof("line plan alat");
+    if (UTIL1_ScanDecimal16uNumber(&p, &val16u)==ERR_OK && val16u>0 && val16u<=LF_PLAN_MAX_LAT_ACCEL) {
+      LF_Plan.latAccel = val16u;
+      *handled = TRUE;
+    } else {
+      CLS1_SendStr((unsigned char*)"Wrong argument\r\n", io->stdErr);
+      res = ERR_FAILED;
+    }
+  } else if (UTIL1_strncmp((char*)cmd, (char*)"line plan fullspeed ", sizeof("line plan fullspeed ")-1)==0) {
+    p = cmd+sizeof("line plan fullspeed");
+    if (UTIL1_ScanDecimal16uNumber(&p, &val16u)==ERR_OK && val16u>0) {
+      LF_Plan.fullSpeed = val16u;
+      *handled = TRUE;
+    } else {
+      CLS1_SendStr((unsigned char*)"Wrong argument\r\n", io->stdErr);
+      res = ERR_FAILED;
+    }
+#if PL_CONFIG_HAS_ODOMETRY
+  } else if (UTIL1_strncmp((char*)cmd, (char*)"line gap ", sizeof("line gap ")-1)==0) {
+    p = cmd+sizeof("line gap");
+    if (UTIL1_ScanDecimal16uNumber(&p, &val16u)==ERR_OK) {
+      LF_Recover.gapMm = val16u;
+      *handled = TRUE;
+    } else {
+      CLS1_SendStr((unsigned char*)"Wrong argument\r\n", io->stdErr);
+      res = ERR_FAILED;
+    }
+  } else if (UTIL1_strncmp((char*)cmd, (char*)"line search ", sizeof("line search ")-1)==0) {
+    p = cmd+sizeof("line search");
+    if (UTIL1_ScanDecimal8uNumber(&p, &val8u)==ERR_OK && val8u<=90) {
+      LF_Recover.searchDeg = val8u;
+      *handled = TRUE;
+    } else {
+      CLS1_SendStr((unsigned char*)"Wrong argument\r\n", io->stdErr);
+      res = ERR_FAILED;
+    }
+#endif
+  } else if (UTIL1_strncmp((char*)cmd, (char*)"line plan boost ", sizeof("line plan boost ")-1)==0) {
+    p = cmd+sizeof("line plan boost");
+    if (UTIL1_ScanDecimal8uNumber(&p, &val8u)==ERR_OK && val8u<=100) {
+      LF_Plan.boostPercent = val8u;
+      *handled = TRUE;
+    } else {
+      CLS1_SendStr((unsigned char*)"Wrong argument\r\n", io->stdErr);
+      res = ERR_FAILED;
+    }
+  } else if (UTIL1_strcmp((char*)cmd, (char*)"line gov on")==0) {
+    LF_GovReset();
+    LF_Gov.enabled = TRUE;
+    *handled = TRUE;
+  } else if (UTIL1_strcmp((char*)cmd, (char*)"line gov off")==0) {
+    LF_Gov.enabled = FALSE;
+    *handled = TRUE;
+  } else if (UTIL1_strncmp((char*)cmd, (char*)"line gov min ", sizeof("line gov min ")-1)==0) {
+    p = cmd+sizeof("line gov min");
+    if (UTIL1_ScanDecimal8uNumber(&p, &val8u)==ERR_OK && val8u>0 && val8u<=LF_Gov.maxPercent) {
+      LF_Gov.minPercent = val8u;
+      *handled = TRUE;
+    } else {
+      CLS1_SendStr((unsigned char*)"Wrong argument\r\n", io->stdErr);
+      res = ERR_FAILED;
+    }
+  } else if (UTIL1_strncmp((char*)cmd, (char*)"line gov max ", sizeof("line gov max ")-1)==0) {
+    p = cmd+sizeof("line gov max");
+    if (UTIL1_ScanDecimal8uNumber(&p, &val8u)==ERR_OK && val8u>=LF_Gov.minPercent && val8u<=100) {
+      LF_Gov.maxPercent = val8u;
+      *handled = TRUE;
+    } else {
+      CLS1_SendStr((unsigned char*)"Wrong argument\r\n", io->stdErr);
+      res = ERR_FAILED;
+    }
+  } else if (UTIL1_strncmp((char*)cmd, (char*)"line gov tight ", sizeof("line gov tight ")-1)==0) {
+    p = cmd+sizeof("line gov tight");
+    if (UTIL1_ScanDecimal16uNumber(&p, &val16u)==ERR_OK && val16u>0 && val16u<=LF_GOV_MAX_TIGHT_ERR) {
+      LF_Gov.tightErr = val16u;
+      *handled = TRUE;
+    } else {
+      CLS1_SendStr((unsigned char*)"Wrong argument\r\n", io->stdErr);
+      res = ERR_FAILED;
+    }
+  } else if (UTIL1_strncmp((char*)cmd, (char*)"line gov sat ", sizeof("line gov sat ")-1)==0) {
+    p = cmd+sizeof("line gov sat");
+    if (UTIL1_ScanDecimal16uNumber(&p, &val16u)==ERR_OK && val16u<=1000) {
+      LF_Gov.satPermille = val16u;
+      *handled = TRUE;
+    } else {
+      CLS1_SendStr((unsigned char*)"Wrong argument\r\n", io->stdErr);
+      res = ERR_FAILED;
+    }
   }
   return res;
 }
@@ -365,11 +1265,49 @@ void LF_Deinit(void) {
 }
 
 void LF_Init(void) {
-  FSM_state = STOP;
-	//LF_currState = STATE_IDLE; changed by Kusi
-
-  if (xTaskCreate(LineTask, "Line", configMINIMAL_STACK_SIZE, NULL, tskIDLE_PRIORITY, &LFTaskHandle) != pdPASS) {
+  LF_state = LF_STATE_IDLE;
+  LF_resumeState = LF_STATE_FORWARD;
+  LF_Plan.enabled = FALSE;
+  LF_Plan.latAccel = 3000;  /* about 0.3 g */
+  LF_Plan.fullSpeed = 1000;
+  LF_Plan.boostPercent = 60;
+  LF_Gov.enabled = FALSE;
+  LF_Gov.minPercent = 30;
+  LF_Gov.maxPercent = 80;
+  LF_Gov.tightErr = 300;
+  LF_Gov.satPermille = 100;
+  LF_GovReset();
+  LF_PlanReset();
+#if PL_CONFIG_HAS_ODOMETRY
+  LF_Recover.gapMm = 60;
+  LF_Recover.searchDeg = 30;
+  LF_Recover.nofLost = 0;
+  LF_Recover.nofFound = 0;
+#endif
+  LF_EventQueue = FRTOS1_xQueueCreate(LF_EVENT_QUEUE_LENGTH, sizeof(uint8_t));
+  if (LF_EventQueue==NULL) {
+    for(;;){} /* out of memory? */
+  }
+  FRTOS1_vQueueAddToRegistry(LF_EventQueue, "Line");
+#if PL_CONFIG_HAS_TURN
+  LF_TurnQueue = FRTOS1_xQueueCreate(LF_TURN_QUEUE_LENGTH, sizeof(LF_TurnRequest));
+  if (LF_TurnQueue==NULL) {
+    for(;;){} /* out of memory? */
+  }
+  FRTOS1_vQueueAddToRegistry(LF_TurnQueue, "Turn");
+#endif
+#if PL_CONFIG_HAS_BUS
+  if (BUS_Subscribe(BUS_TOPIC_LINE, LF_SensorFrameReady)==NULL) { /* every new frame posts a frame event */
+    for(;;){} /* error */
+  }
+#endif
+  if (xTaskCreate(LineTask, "Line", LF_TASK_STACK_SIZE, NULL, tskIDLE_PRIORITY, NULL) != pdPASS) {
     for(;;){} /* error */
   }
+#if PL_CONFIG_HAS_TURN
+  if (xTaskCreate(TurnTask, "Turn", LF_TURN_TASK_STACK_SIZE, NULL, tskIDLE_PRIORITY, NULL) != pdPASS) {
+    for(;;){} /* error */
+  }
+#endif
 }
 #endif /* PL_CONFIG_HAS_LINE_FOLLOW */
@@ -16,6 +16,13 @@
 #include "CLS1.h"
 
 uint8_t LF_ParseCommand(const unsigned char *cmd, bool *handled, const CLS1_StdIOType *io);
+
+/*!
+ * \brief Prints the state transitions since the last call and sends the contest signals.
+ * Called by the shell task, so this does not delay the line following.
+ * \param io Std I/O handler of shell
+ */
+void LF_FlushLog(const CLS1_StdIOType *io);
 #endif
 
 void LF_StartFollowing(void);
@@ -23,6 +30,12 @@ void LF_StopFollowing(void);
 void LF_StartStopFollowing(void);
 bool LF_IsFollowing(void);
 
+/*!
+ * \brief Notifies the line following that new reflectance sensor values are available.
+ * Called by the reflectance task after each measurement.
+ */
+void LF_SensorFrameReady(void);
+
 void LF_Init(void);
 void LF_Deinit(void);
 
@@ -0,0 +1,148 @@
+/**
+ * \file
+ * \brief Implementation of the low power mode of the idle task.
+ *
+ * The idle hook waits for the next interrupt with WFI. The interrupts are masked around it,
+ * so the tick timer can be read before the interrupt which has woken up the CPU gets served.
+ * The SysTick gives the time slept in timer counts, and the ratio to the elapsed time is the sleep ratio reported in the shell.
+ * With tickless idle of the RTOS, the port puts the CPU to sleep itself, and the hook does nothing.
+ */
+
+#include "Platform.h"
+#if PL_CONFIG_HAS_LOW_POWER
+#include "LowPower.h"
+#include "FRTOS1.h"
+#include "RTOS.h"
+#if PL_CONFIG_HAS_SHELL
+  #include "CLS1.h"
+  #include "UTIL1.h"
+#endif
+
+#define LP_WINDOW_MS  1000 /* period over which the sleep ratio is measured */
+
+static LP_Mode LP_mode = LP_MODE_WAIT;
+
+/*! \brief Sleep statistics */
+static struct {
+  portTickType windowStart;  /*!< tick count at the start of the current window */
+  uint32_t sleepCounts;      /*!< tick timer counts slept in the current window */
+  uint16_t permille;         /*!< sleep ratio of the last complete window */
+  uint32_t nofWakeups;       /*!< number of times the CPU has been woken up */
+} LP_Stats;
+
+uint8_t LP_SetMode(LP_Mode mode) {
+  LP_mode = mode;
+  return ERR_OK;
+}
+
+/* closes the measurement window after LP_WINDOW_MS */
+static void LP_UpdateRatio(void) {
+  portTickType now, ticks;
+  uint32_t window, permille;
+
+  now = FRTOS1_xTaskGetTickCount();
+  ticks = now-LP_Stats.windowStart;
+  if (ticks<LP_WINDOW_MS/portTICK_PERIOD_MS) {
+    return;
+  }
+  window = (uint32_t)ticks*RTOS_GetTickTimerPeriod(); /* tick timer counts of the window */
+  if (window>=1000) {
+    permille = LP_Stats.sleepCounts/(window/1000);
+  } else {
+    permille = (LP_Stats.sleepCounts*1000)/window;
+  }
+  LP_Stats.permille = (uint16_t)(permille>1000?1000:permille);
+  LP_Stats.sleepCounts = 0;
+  LP_Stats.windowStart = now;
+}
+
+void LP_EnterLowPower(void) {
+  uint32_t start, end;
+
+  if (LP_mode==LP_MODE_RUN || configUSE_TICKLESS_IDLE) {
+    return; /* with tickless idle, the RTOS port sleeps */
+  }
+  LP_UpdateRatio();
+  __asm volatile ("cpsid i"); /* a pending interrupt still ends WFI, but is only served after the measurement */
+  if (RTOS_IsTickPending()) {
+    __asm volatile ("cpsie i"); /* tick is due, no time to sleep */
+    return;
+  }
+  start = RTOS_GetTickTimerCount();
+  __asm volatile ("dsb");
+  __asm volatile ("wfi");
+  end = RTOS_GetTickTimerCount();
+  if (RTOS_IsTickPending() && end<start) { /* counter has restarted while sleeping */
+    LP_Stats.sleepCounts += RTOS_GetTickTimerPeriod()-start+end;
+  } else {
+    LP_Stats.sleepCounts += end-start;
+  }
+  LP_Stats.nofWakeups++;
+  __asm volatile ("cpsie i");
+}
+
+#if PL_CONFIG_HAS_SHELL
+static const char *LP_ModeStr(LP_Mode mode) {
+  switch(mode) {
+    case LP_MODE_RUN:   return "off";
+    case LP_MODE_WAIT:  return "wait";
+    default:            return "unknown";
+  }
+}
+
+static void LP_PrintHelp(const CLS1_StdIOType *io) {
+  CLS1_SendHelpStr((unsigned char*)"lowpower", (unsigned char*)"Group of low power commands\r\n", io->stdOut);
+  CLS1_SendHelpStr((unsigned char*)"  help|status", (unsigned char*)"Shows low power help or status\r\n", io->stdOut);
+  CLS1_SendHelpStr((unsigned char*)"  mode off|wait", (unsigned char*)"Sets the mode of the idle task\r\n", io->stdOut);
+}
+
+static void LP_PrintStatus(const CLS1_StdIOType *io) {
+  unsigned char buf[32];
+
+  CLS1_SendStatusStr((unsigned char*)"lowpower", (unsigned char*)"\r\n", io->stdOut);
+  UTIL1_strcpy(buf, sizeof(buf), configUSE_TICKLESS_IDLE?(unsigned char*)"tickless idle":(unsigned char*)LP_ModeStr(LP_mode));
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)"\r\n");
+  CLS1_SendStatusStr((unsigned char*)"  mode", buf, io->stdOut);
+  UTIL1_Num16uToStr(buf, sizeof(buf), LP_Stats.permille/10);
+  UTIL1_chcat(buf, sizeof(buf), '.');
+  UTIL1_strcatNum16u(buf, sizeof(buf), LP_Stats.permille%10);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)"% of the last second\r\n");
+  CLS1_SendStatusStr((unsigned char*)"  sleeping", buf, io->stdOut);
+  UTIL1_Num32uToStr(buf, sizeof(buf), LP_Stats.nofWakeups);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)"\r\n");
+  CLS1_SendStatusStr((unsigned char*)"  wake ups", buf, io->stdOut);
+}
+
+uint8_t LP_ParseCommand(const unsigned char *cmd, bool *handled, const CLS1_StdIOType *io) {
+  uint8_t res = ERR_OK;
+
+  if (UTIL1_strcmp((char*)cmd, (char*)CLS1_CMD_HELP)==0 || UTIL1_strcmp((char*)cmd, (char*)"lowpower help")==0) {
+    LP_PrintHelp(io);
+    *handled = TRUE;
+  } else if (UTIL1_strcmp((char*)cmd, (char*)CLS1_CMD_STATUS)==0 || UTIL1_strcmp((char*)cmd, (char*)"lowpower status")==0) {
+    LP_PrintStatus(io);
+    *handled = TRUE;
+  } else if (UTIL1_strcmp((char*)cmd, (char*)"lowpower mode off")==0) {
+    res = LP_SetMode(LP_MODE_RUN);
+    *handled = TRUE;
+  } else if (UTIL1_strcmp((char*)cmd, (char*)"lowpower mode wait")==0) {
+    res = LP_SetMode(LP_MODE_WAIT);
+    *handled = TRUE;
+  }
+  return res;
+}
+#endif /* PL_CONFIG_HAS_SHELL */
+
+void LP_Deinit(void) {
+  LP_mode = LP_MODE_RUN;
+}
+
+void LP_Init(void) {
+  LP_mode = LP_MODE_WAIT;
+  LP_Stats.windowStart = FRTOS1_xTaskGetTickCount();
+  LP_Stats.sleepCounts = 0;
+  LP_Stats.permille = 0;
+  LP_Stats.nofWakeups = 0;
+}
+
+#endif /* PL_CONFIG_HAS_LOW_POWER */
@@ -0,0 +1,51 @@
+/**
+ * \file
+ * \brief Interface to the low power mode of the idle task.
+ *
+ * When no task is ready to run, the RTOS idle hook puts the CPU to sleep in WAIT mode until the next interrupt.
+ * The module measures how much of the time the CPU is sleeping.
+ */
+
+#ifndef LOWPOWER_H_
+#define LOWPOWER_H_
+
+#include "Platform.h"
+#if PL_CONFIG_HAS_LOW_POWER
+
+typedef enum {
+  LP_MODE_RUN,   /* no sleeping, the idle task keeps running */
+  LP_MODE_WAIT   /* CPU clock stopped, peripherals keep running */
+} LP_Mode;
+
+#if PL_CONFIG_HAS_SHELL
+#include "CLS1.h"
+/*!
+ * \brief Shell command line parser.
+ * \param[in] cmd Pointer to command string
+ * \param[out] handled If command is handled by the parser
+ * \param[in] io Std I/O handler of shell
+ */
+uint8_t LP_ParseCommand(const unsigned char *cmd, bool *handled, const CLS1_StdIOType *io);
+#endif
+
+/*!
+ * \brief Sets the mode used by LP_EnterLowPower().
+ * \param mode Low power mode
+ * \return ERR_OK, or ERR_FAILED if the mode is not supported
+ */
+uint8_t LP_SetMode(LP_Mode mode);
+
+/*!
+ * \brief Sleeps until the next interrupt. Called from the RTOS idle hook.
+ */
+void LP_EnterLowPower(void);
+
+/*! \brief Module de-initialization. */
+void LP_Deinit(void);
+
+/*! \brief Module initialization. */
+void LP_Init(void);
+
+#endif /* PL_CONFIG_HAS_LOW_POWER */
+
+#endif /* LOWPOWER_H_ */
@@ -14,9 +14,27 @@
 #include "LineFollow.h"
 #include "Event.h"
 #include "UTIL1.h"
+#include "Util.h"
 #include "Shell.h"
 #include "Reflectance.h"
+#if PL_CONFIG_HAS_CONFIG_NVM
+  #include "NVM_Config.h"
+#endif
+#if PL_CONFIG_HAS_LINE_JUNCTION
+  #include "Junction.h"
+  #include "Odometry.h"
+  #include "Q4CLeft.h"
+  #include "Q4CRight.h"
+  #include "FRTOS1.h"
+#endif
+
+#define MAZE_HAS_GRAPH   PL_CONFIG_HAS_LINE_JUNCTION /* the map needs the junction position from the odometry */
+
+#if MAZE_HAS_GRAPH
+static uint8_t MAZE_CalcRoute(void);
+#endif
 
+#if !PL_CONFIG_HAS_LINE_JUNCTION /* otherwise the junction detection keeps the history */
 #define MAZE_MIN_LINE_VAL      0x40   /* minimum value indicating a line */ /* \todo adapt to your needs */
 static uint16_t SensorHistory[REF_NOF_SENSORS]; /* value of history while moving forward */
 
@@ -74,19 +92,34 @@ void MAZE_ClearSensorHistory(void) {
     SensorHistory[i] = 0;
   }
 }
+#endif
 
 
-#define MAZE_MAX_PATH        8 /* \todo maximum number of turns in path */
+#define MAZE_MAX_PATH        128 /* maximum number of turns in path, enough for a contest maze */
+
+typedef enum {
+  MAZE_RULE_LEFT,  /* left hand on the wall: left before straight before right */
+  MAZE_RULE_RIGHT  /* right hand on the wall: right before straight before left */
+} MAZE_Rule;
 
 static TURN_Kind path[MAZE_MAX_PATH]; /* recorded maze */
 static uint8_t pathLength; /* number of entries in path[] */
 static bool isSolved = FALSE; /* if we have solved the maze */
+static MAZE_Rule MAZE_rule = MAZE_RULE_LEFT; /* rule used to explore the maze */
 
 static TURN_Kind RevertTurn(TURN_Kind turn) {
   if (turn==TURN_LEFT90) {
     turn = TURN_RIGHT90;
   } else if (turn==TURN_RIGHT90) {
     turn = TURN_LEFT90;
+  } else if (turn==TURN_LEFT90_ARC) {
+    turn = TURN_RIGHT90_ARC;
+  } else if (turn==TURN_RIGHT90_ARC) {
+    turn = TURN_LEFT90_ARC;
+  } else if (turn==TURN_LEFT45_ARC) {
+    turn = TURN_RIGHT45_ARC;
+  } else if (turn==TURN_RIGHT45_ARC) {
+    turn = TURN_LEFT45_ARC;
   }
   return turn;
 }
@@ -111,19 +144,65 @@ static void MAZE_RevertPath(void) {
   }
 }
 
+/* returns the heading change of a turn in degree, counterclockwise, or -1 if it is not a turn on the maze grid */
+static int16_t MAZE_TurnAngle(TURN_Kind turn) {
+  switch(turn) {
+    case TURN_STRAIGHT:    return 0;
+    case TURN_LEFT90:
+    case TURN_LEFT90_ARC:  return 90;
+    case TURN_LEFT180:
+    case TURN_RIGHT180:    return 180;
+    case TURN_RIGHT90:
+    case TURN_RIGHT90_ARC: return 270;
+    default:               return -1;
+  }
+}
+
+static bool MAZE_IsUTurn(TURN_Kind turn) {
+  return turn==TURN_LEFT180 || turn==TURN_RIGHT180;
+}
+
+/* the U turn used at dead ends, turning away from the wall we follow */
+static TURN_Kind MAZE_UTurn(void) {
+  return (MAZE_rule==MAZE_RULE_LEFT)?TURN_RIGHT180:TURN_LEFT180;
+}
+
 TURN_Kind MAZE_SelectTurn(REF_LineKind prev, REF_LineKind curr) {
-  if (prev==REF_LINE_NONE && curr==REF_LINE_NONE) { /* dead end */
-    return TURN_RIGHT180; /* make U turn */
+  bool left, right, straight;
+
+  if (prev==REF_LINE_FULL && curr==REF_LINE_FULL) { /* wide black area */
+    return TURN_FINISHED;
+  }
+  left = prev==REF_LINE_LEFT || prev==REF_LINE_FULL;
+  right = prev==REF_LINE_RIGHT || prev==REF_LINE_FULL;
+  straight = curr!=REF_LINE_NONE;
+  if (!left && !right && !straight) { /* dead end */
+    return MAZE_UTurn(); /* make U turn */
+  }
+  if (MAZE_rule==MAZE_RULE_LEFT) {
+    if (left) {
+      return TURN_LEFT90;
+    } else if (straight) {
+      return TURN_STRAIGHT;
+    }
+    return TURN_RIGHT90;
+  } else {
+    if (right) {
+      return TURN_RIGHT90;
+    } else if (straight) {
+      return TURN_STRAIGHT;
+    }
+    return TURN_LEFT90;
   }
-  /*! \todo Implement all cases for turning */
-  return TURN_STOP; /* error case */
 }
 
 void MAZE_SetSolved(void) {
   isSolved = TRUE;
-  /*! \todo here the path could be reverted */
-  MAZE_RevertPath();
+  MAZE_RevertPath(); /* path from the finish back to the start */
   MAZE_AddPath(TURN_STOP); /* add an action to stop */
+#if MAZE_HAS_GRAPH
+  (void)MAZE_CalcRoute(); /* fastest route on the map, which can be shorter than the explored path if there are loops */
+#endif
 }
 
 bool MAZE_IsSolved(void) {
@@ -134,32 +213,510 @@ void MAZE_AddPath(TURN_Kind kind) {
   if (pathLength<MAZE_MAX_PATH) {
     path[pathLength] = kind;
     pathLength++;
+    if (!isSolved) {
+      MAZE_SimplifyPath(); /* keep the path short while exploring, so it is ready when the finish is found */
+    }
   } else {
     /* error! */
   }
 }
 
 /*!
- * \brief Performs path simplification.
+ * \brief Performs path simplification on the last turns of the path.
  * The idea is that whenever we encounter x-TURN_RIGHT180-x or x-TURN_LEFT180-x, we simplify it by cutting the dead end.
- * For example if we have TURN_LEFT90-TURN_RIGHT180-TURN_LEFT90, this can be simplified with TURN_STRAIGHT.
+ * The three turns are replaced by the turn with the same heading change, e.g. TURN_LEFT90-TURN_RIGHT180-TURN_LEFT90 by TURN_STRAIGHT.
+ * As this is done for every turn added, there is at most one dead end at the end of the path.
  */
 void MAZE_SimplifyPath(void) {
-  /*! \todo */
+  int16_t a, b, c, angle;
+  TURN_Kind turn;
+
+  if (pathLength<3 || !MAZE_IsUTurn(path[pathLength-2])) {
+    return;
+  }
+  a = MAZE_TurnAngle(path[pathLength-3]);
+  b = MAZE_TurnAngle(path[pathLength-2]);
+  c = MAZE_TurnAngle(path[pathLength-1]);
+  if (a<0 || b<0 || c<0) {
+    return; /* not on the grid, keep it */
+  }
+  angle = (a+b+c)%360;
+  switch(angle) {
+    case 0:   turn = TURN_STRAIGHT; break;
+    case 90:  turn = TURN_LEFT90; break;
+    case 180: turn = MAZE_UTurn(); break;
+    default:  turn = TURN_RIGHT90; break;
+  }
+  pathLength -= 2;
+  path[pathLength-1] = turn;
+}
+
+#if MAZE_HAS_GRAPH
+/* The explored maze as a graph: the nodes are the intersections (and dead ends), at their odometry position.
+ * The edges are the line segments between them, with the length and the time measured while exploring.
+ * Directions are absolute: 0 is the odometry x axis, counting counter-clockwise in steps of 90 degree.
+ * For the shortest path the search is on (node, heading) states, so the cost of the turn at a node is taken into account. */
+#define MAZE_MAX_NODES       32   /* maximum number of intersections */
+#define MAZE_MAX_EDGES       48   /* maximum number of segments */
+#define MAZE_NO_IDX          0xff /* no node/edge */
+#define MAZE_NODE_DIST_MM    80   /* positions closer than this are the same node */
+#define MAZE_NOF_STATES      (MAZE_MAX_NODES*4)
+
+typedef struct {
+  int16_t xMm, yMm;   /* odometry position */
+  uint8_t edge[4];    /* edge leaving in each direction, or MAZE_NO_IDX */
+  uint8_t exits;      /* bit set for every direction with a line */
+} MAZE_Node;
+
+typedef struct {
+  uint8_t node[2];    /* nodes at both ends */
+  uint8_t dir[2];     /* direction leaving node[0], and direction leaving node[1] */
+  uint16_t lengthMm;  /* length of the segment */
+  uint16_t timeMs;    /* time to drive the segment */
+} MAZE_Edge;
+
+static MAZE_Node MAZE_nodes[MAZE_MAX_NODES];
+static MAZE_Edge MAZE_edges[MAZE_MAX_EDGES];
+static uint8_t MAZE_nofNodes, MAZE_nofEdges;
+static uint8_t MAZE_startNode, MAZE_finishNode;
+static uint8_t MAZE_startDir;                 /* heading at the start */
+static uint8_t MAZE_lastNode, MAZE_lastDir;   /* node and direction of the segment we are on */
+static int32_t MAZE_lastDistUm;               /* odometry distance when leaving the last node */
+static portTickType MAZE_lastTicks;           /* time when leaving the last node */
+static uint16_t MAZE_turnCostMs[4] = {0, 400, 800, 400}; /* measured time to turn: straight, left, U turn, right */
+static MAZE_Segment MAZE_route[MAZE_MAX_NODES+1]; /* shortest route from the start to the finish */
+static uint8_t MAZE_routeLength;
+
+/* work buffers of MAZE_CalcRoute(), not on the stack of the calling task (line task or shell) */
+static struct {
+  uint32_t cost[MAZE_NOF_STATES];   /* time to reach the state */
+  uint8_t prev[MAZE_NOF_STATES];    /* previous state */
+  uint8_t leave[MAZE_NOF_STATES];   /* direction leaving the previous state */
+  bool done[MAZE_NOF_STATES];       /* cost of the state is final */
+  uint8_t states[MAZE_NOF_STATES];  /* states of the route, from the finish back to the start */
+} MAZE_Calc;
+static xSemaphoreHandle MAZE_CalcMutex = NULL; /* protects MAZE_Calc and MAZE_route */
+
+#define MAZE_RUN_MAX_SPEED     1500 /* mm/s, on long straights */
+#define MAZE_RUN_ENTRY_SPEED   400  /* mm/s, entering a rolling turn */
+#define MAZE_RUN_ACCEL         1500 /* mm/s^2 */
+#define MAZE_RUN_RADIUS_MM     100  /* radius of a rolling turn */
+
+static struct {
+  bool running;         /* speed run in progress */
+  uint8_t idx;          /* current step of the route, the segment we are on */
+  int32_t segStartUm;   /* odometry distance at the (virtual) start of the segment */
+  int32_t accelStartUm; /* odometry distance at the end of the last turn */
+  portTickType startTicks; /* time at the start of the run */
+  uint16_t maxSpeed, entrySpeed, accel, radiusMm; /* configuration */
+} MAZE_Run;
+static portTickType MAZE_exploreStartTicks; /* time at the start of the exploration */
+static uint32_t MAZE_exploreMs, MAZE_runMs; /* time needed to explore, and for the last speed run */
+
+/* returns the absolute direction of the robot heading */
+static uint8_t MAZE_GetDir(void) {
+  ODO_Pose pose;
+
+  ODO_GetPose(&pose);
+  return (uint8_t)(((uint16_t)(pose.heading+0x2000))>>14);
+}
+
+static TURN_Kind MAZE_DirTurn(uint8_t rel) {
+  switch(rel&3) {
+    case 0:  return TURN_STRAIGHT;
+    case 1:  return TURN_LEFT90;
+    case 2:  return TURN_LEFT180;
+    default: return TURN_RIGHT90;
+  }
+}
+
+/* returns the node at the current position, creating it if it is new */
+static uint8_t MAZE_GetNode(void) {
+  ODO_Pose pose;
+  int32_t dx, dy;
+  uint8_t i;
+
+  ODO_GetPose(&pose);
+  for(i=0;i<MAZE_nofNodes;i++) {
+    dx = pose.xUm/1000-MAZE_nodes[i].xMm;
+    dy = pose.yUm/1000-MAZE_nodes[i].yMm;
+    if (dx*dx+dy*dy<MAZE_NODE_DIST_MM*MAZE_NODE_DIST_MM) {
+      return i; /* been here before */
+    }
+  }
+  if (MAZE_nofNodes>=MAZE_MAX_NODES) {
+    return MAZE_NO_IDX;
+  }
+  MAZE_nodes[i].xMm = (int16_t)(pose.xUm/1000);
+  MAZE_nodes[i].yMm = (int16_t)(pose.yUm/1000);
+  MAZE_nodes[i].edge[0] = MAZE_nodes[i].edge[1] = MAZE_nodes[i].edge[2] = MAZE_nodes[i].edge[3] = MAZE_NO_IDX;
+  MAZE_nodes[i].exits = 0;
+  MAZE_nofNodes++;
+  return i;
+}
+
+/* leaves a node in the current heading */
+static void MAZE_LeaveNode(uint8_t node) {
+  MAZE_lastNode = node;
+  MAZE_lastDir = MAZE_GetDir();
+  MAZE_lastDistUm = ODO_GetDistanceUm();
+  MAZE_lastTicks = FRTOS1_xTaskGetTickCount();
+  if (node!=MAZE_NO_IDX) {
+    MAZE_nodes[node].exits |= 1<<MAZE_lastDir;
+  }
+}
+
+/* reached a node: adds the segment from the last node, and the exits seen at the node */
+static uint8_t MAZE_ReachNode(bool left, bool straight, bool right) {
+  uint8_t node, dir, e;
+  uint32_t lengthMm, timeMs;
+
+  node = MAZE_GetNode();
+  if (node==MAZE_NO_IDX) {
+    return MAZE_NO_IDX; /* graph is full */
+  }
+  dir = MAZE_GetDir();
+  MAZE_nodes[node].exits |= (1<<((dir+2)&3)) /* where we came from */
+    | (left?(1<<((dir+1)&3)):0) | (straight?(1<<dir):0) | (right?(1<<((dir+3)&3)):0);
+  if (MAZE_lastNode==MAZE_NO_IDX) {
+    return node; /* not on a known segment */
+  }
+  lengthMm = (uint32_t)(ODO_GetDistanceUm()-MAZE_lastDistUm)/1000;
+  if (MAZE_lastNode==node && lengthMm<MAZE_NODE_DIST_MM) {
+    return node; /* not moved */
+  }
+  timeMs = (FRTOS1_xTaskGetTickCount()-MAZE_lastTicks)*portTICK_PERIOD_MS;
+  if (lengthMm>0xffff) {
+    lengthMm = 0xffff;
+  }
+  if (timeMs>0xffff) {
+    timeMs = 0xffff;
+  }
+  e = MAZE_nodes[MAZE_lastNode].edge[MAZE_lastDir];
+  if (e!=MAZE_NO_IDX) { /* driven before: average the measurements */
+    MAZE_edges[e].lengthMm = (uint16_t)((MAZE_edges[e].lengthMm+lengthMm)/2);
+    MAZE_edges[e].timeMs = (uint16_t)((MAZE_edges[e].timeMs+timeMs)/2);
+  } else if (MAZE_nofEdges<MAZE_MAX_EDGES) {
+    e = MAZE_nofEdges++;
+    MAZE_edges[e].node[0] = MAZE_lastNode;
+    MAZE_edges[e].dir[0] = MAZE_lastDir;
+    MAZE_edges[e].node[1] = node;
+    MAZE_edges[e].dir[1] = (dir+2)&3;
+    MAZE_edges[e].lengthMm = (uint16_t)lengthMm;
+    MAZE_edges[e].timeMs = (uint16_t)timeMs;
+    MAZE_nodes[MAZE_lastNode].edge[MAZE_lastDir] = e;
+    MAZE_nodes[node].edge[(dir+2)&3] = e;
+  }
+  return node;
+}
+
+/* updates the measured cost of a turn */
+static void MAZE_TurnCost(uint8_t rel, portTickType ticks) {
+  if (rel!=0) {
+    MAZE_turnCostMs[rel] = (uint16_t)((3*MAZE_turnCostMs[rel]+ticks*portTICK_PERIOD_MS)/4);
+  }
+}
+
+static void MAZE_ClearGraph(void) {
+  MAZE_Run.running = FALSE;
+  MAZE_nofNodes = MAZE_nofEdges = 0;
+  MAZE_startNode = MAZE_finishNode = MAZE_lastNode = MAZE_NO_IDX;
+  MAZE_routeLength = 0;
+}
+
+static uint8_t MAZE_FindRoute(void) {
+  uint32_t *cost = MAZE_Calc.cost, c;
+  uint8_t *prev = MAZE_Calc.prev, *leave = MAZE_Calc.leave, *states = MAZE_Calc.states;
+  uint8_t s, t, best, node, d, e, i, n;
+
+  MAZE_routeLength = 0;
+  if (MAZE_startNode==MAZE_NO_IDX || MAZE_finishNode==MAZE_NO_IDX) {
+    return ERR_FAILED;
+  }
+  for(s=0;s<MAZE_nofNodes*4;s++) {
+    cost[s] = 0xffffffff;
+    prev[s] = leave[s] = MAZE_NO_IDX;
+    MAZE_Calc.done[s] = FALSE;
+  }
+  cost[MAZE_startNode*4+MAZE_startDir] = 0;
+  for(;;) {
+    best = MAZE_NO_IDX;
+    for(s=0;s<MAZE_nofNodes*4;s++) {
+      if (!MAZE_Calc.done[s] && cost[s]!=0xffffffff && (best==MAZE_NO_IDX || cost[s]<cost[best])) {
+        best = s;
+      }
+    }
+    if (best==MAZE_NO_IDX || best/4==MAZE_finishNode) {
+      break; /* no more states, or reached the finish */
+    }
+    MAZE_Calc.done[best] = TRUE;
+    node = best/4;
+    for(d=0;d<4;d++) {
+      e = MAZE_nodes[node].edge[d];
+      if (e==MAZE_NO_IDX) {
+        continue;
+      }
+      i = (MAZE_edges[e].node[0]==node && MAZE_edges[e].dir[0]==d)?1:0; /* other end of the segment */
+      t = MAZE_edges[e].node[i]*4+((MAZE_edges[e].dir[i]+2)&3); /* heading when arriving there */
+      c = cost[best]+MAZE_turnCostMs[(d-(best&3))&3]+MAZE_edges[e].timeMs;
+      if (c<cost[t]) {
+        cost[t] = c;
+        prev[t] = best;
+        leave[t] = d;
+      }
+    }
+  }
+  if (best==MAZE_NO_IDX) {
+    return ERR_FAILED; /* finish not reachable */
+  }
+  /* collect the states from the finish back to the start. Every state is on it at most once,
+   * but a node can be passed several times with different headings. */
+  n = 0;
+  for(s=best; s!=MAZE_NO_IDX; s=prev[s]) {
+    if (n==MAZE_NOF_STATES) {
+      return ERR_FAILED; /* loop in prev[], cannot happen */
+    }
+    states[n++] = s;
+  }
+  if (n>sizeof(MAZE_route)/sizeof(MAZE_route[0])) {
+    return ERR_OVERFLOW; /* one step per state but the start, plus the stop at the finish */
+  }
+  /* states[n-1] is the start: each step is the turn at a node, then the segment to the next one */
+  for(i=n-1; i>0; i--) {
+    s = states[i];
+    d = leave[states[i-1]];
+    e = MAZE_nodes[s/4].edge[d];
+    MAZE_route[MAZE_routeLength].turn = MAZE_DirTurn(d-(s&3));
+    MAZE_route[MAZE_routeLength].lengthMm = MAZE_edges[e].lengthMm;
+    MAZE_route[MAZE_routeLength].timeMs = MAZE_edges[e].timeMs;
+    MAZE_routeLength++;
+  }
+  MAZE_route[MAZE_routeLength].turn = TURN_STOP; /* stop at the finish */
+  MAZE_route[MAZE_routeLength].lengthMm = 0;
+  MAZE_route[MAZE_routeLength].timeMs = 0;
+  MAZE_routeLength++;
+  return ERR_OK;
+}
+
+/*!
+ * \brief Calculates the fastest route from the start to the finish (Dijkstra), on the (node, heading) states.
+ * \return ERR_OK if a route has been found, ERR_OVERFLOW if it does not fit into the route buffer
+ */
+static uint8_t MAZE_CalcRoute(void) {
+  uint8_t res;
+
+  (void)FRTOS1_xSemaphoreTake(MAZE_CalcMutex, portMAX_DELAY);
+  res = MAZE_FindRoute();
+  (void)FRTOS1_xSemaphoreGive(MAZE_CalcMutex);
+  return res;
+}
+#endif /* MAZE_HAS_GRAPH */
+
+#if MAZE_HAS_GRAPH
+/* Speed run: the route is known, so the intersections are anticipated by the driven distance instead of probing them.
+ * The speed follows a profile: accelerate after a turn, brake in time to reach the entry speed of the next turn.
+ * Straight steps through intersections are passed without slowing down, and 90 degree turns are rolling turns on an arc. */
+static bool MAZE_IsArcTurn(TURN_Kind turn) {
+  return turn==TURN_LEFT90 || turn==TURN_RIGHT90;
+}
+
+/* distance to the point where the next turn starts (mm), and the speed to enter it (mm/s) */
+static int32_t MAZE_RunRemaining(uint16_t *entrySpeed) {
+  int32_t remaining;
+  uint8_t i;
+
+  remaining = -(ODO_GetDistanceUm()-MAZE_Run.segStartUm)/1000;
+  for(i=MAZE_Run.idx; i+1<MAZE_routeLength; i++) {
+    remaining += MAZE_route[i].lengthMm;
+    if (MAZE_route[i+1].turn!=TURN_STRAIGHT) {
+      break; /* straight steps are passed with speed, look at the one after */
+    }
+  }
+  if (i+1<MAZE_routeLength && MAZE_IsArcTurn(MAZE_route[i+1].turn)) {
+    *entrySpeed = MAZE_Run.entrySpeed;
+    remaining -= MAZE_Run.radiusMm; /* the arc starts before the intersection */
+  } else {
+    *entrySpeed = 0; /* stop at the finish, or for a turn on the spot */
+  }
+  return remaining;
+}
+
+bool MAZE_IsRunning(void) {
+  return MAZE_Run.running;
+}
+
+bool MAZE_StartRun(void) {
+  if (!isSolved || MAZE_routeLength==0) {
+    return FALSE; /* nothing to run */
+  }
+  if (MAZE_route[0].turn!=TURN_STRAIGHT && MAZE_route[0].turn!=TURN_STOP) { /* leaving the start in another direction */
+    (void)TURN_TurnOntoLine(MAZE_route[0].turn, NULL);
+  }
+  MAZE_Run.idx = 0;
+  MAZE_Run.segStartUm = ODO_GetDistanceUm();
+  MAZE_Run.accelStartUm = MAZE_Run.segStartUm;
+  MAZE_Run.startTicks = FRTOS1_xTaskGetTickCount();
+  MAZE_Run.running = TRUE;
+  return TRUE;
+}
+
+void MAZE_StopRun(void) {
+  MAZE_Run.running = FALSE;
+}
+
+uint16_t MAZE_RunSpeed(void) {
+  uint32_t driven, speed, brake;
+  int32_t remaining;
+  uint16_t entry;
+
+  /* pass the intersections where the route goes straight */
+  while (MAZE_Run.idx+1<MAZE_routeLength && MAZE_route[MAZE_Run.idx+1].turn==TURN_STRAIGHT
+      && ODO_GetDistanceUm()-MAZE_Run.segStartUm>=(int32_t)MAZE_route[MAZE_Run.idx].lengthMm*1000)
+  {
+    MAZE_Run.segStartUm += (int32_t)MAZE_route[MAZE_Run.idx].lengthMm*1000;
+    MAZE_Run.idx++;
+  }
+  remaining = MAZE_RunRemaining(&entry);
+  if (remaining<0) {
+    remaining = 0;
+  }
+  driven = (uint32_t)(ODO_GetDistanceUm()-MAZE_Run.accelStartUm)/1000;
+  /* v=sqrt(v0^2+2*a*s): accelerating from the last turn, and braking for the next one */
+  speed = UTIL_ISqrt((uint32_t)MAZE_Run.entrySpeed*MAZE_Run.entrySpeed+2*(uint32_t)MAZE_Run.accel*driven);
+  brake = UTIL_ISqrt((uint32_t)entry*entry+2*(uint32_t)MAZE_Run.accel*(uint32_t)remaining);
+  if (brake<speed) {
+    speed = brake;
+  }
+  if (speed>MAZE_Run.maxSpeed) {
+    speed = MAZE_Run.maxSpeed;
+  }
+  return (uint16_t)speed;
+}
+
+bool MAZE_RunAtTurn(void) {
+  uint16_t entry;
+
+  return MAZE_Run.running && MAZE_RunRemaining(&entry)<=0;
+}
+
+uint8_t MAZE_RunTurn(bool *finished, TURN_StopFct stopIt) {
+  TURN_Kind turn;
+  int32_t dist;
+  uint8_t res;
+
+  *finished = FALSE;
+  if (!MAZE_Run.running) {
+    return ERR_FAILED;
+  }
+  while (MAZE_Run.idx+1<MAZE_routeLength && MAZE_route[MAZE_Run.idx+1].turn==TURN_STRAIGHT) {
+    MAZE_Run.segStartUm += (int32_t)MAZE_route[MAZE_Run.idx].lengthMm*1000; /* intersections passed on the way */
+    MAZE_Run.idx++;
+  }
+  MAZE_Run.idx++;
+  turn = (MAZE_Run.idx<MAZE_routeLength)?MAZE_route[MAZE_Run.idx].turn:TURN_STOP;
+  if (turn==TURN_STOP) { /* reached the finish */
+    *finished = TRUE;
+    MAZE_Run.running = FALSE;
+    MAZE_runMs = (FRTOS1_xTaskGetTickCount()-MAZE_Run.startTicks)*portTICK_PERIOD_MS;
+    SHELL_SendString((unsigned char*)"MAZE: speed run finished!\r\n");
+    return ERR_OK;
+  }
+  if (MAZE_IsArcTurn(turn)) {
+    TURN_TurnArc(turn==TURN_LEFT90?-90:90, MAZE_Run.radiusMm, stopIt);
+    dist = MAZE_Run.radiusMm; /* the arc ends that far after the intersection */
+  } else { /* turn on the spot in the middle of the intersection */
+    res = TURN_TurnOntoLine(turn, stopIt);
+    if (res!=ERR_OK) {
+      MAZE_Run.running = FALSE;
+      return res; /* stopped, or not on the route any more */
+    }
+    dist = 0;
+  }
+  if (stopIt!=NULL && stopIt()) {
+    MAZE_Run.running = FALSE;
+    return ERR_BUSY;
+  }
+  MAZE_Run.accelStartUm = ODO_GetDistanceUm();
+  MAZE_Run.segStartUm = MAZE_Run.accelStartUm-dist*1000;
+  return ERR_OK;
+}
+#endif /* MAZE_HAS_GRAPH */
+
+void MAZE_Start(void) {
+  MAZE_ClearSolution(); /* a new exploration */
+#if MAZE_HAS_GRAPH
+  MAZE_exploreStartTicks = FRTOS1_xTaskGetTickCount();
+  MAZE_startNode = MAZE_GetNode();
+  MAZE_startDir = MAZE_GetDir();
+  MAZE_LeaveNode(MAZE_startNode);
+#endif
+}
+
+bool MAZE_GetRouteSegment(uint8_t idx, MAZE_Segment *seg) {
+#if MAZE_HAS_GRAPH
+  if (idx<MAZE_routeLength) {
+    *seg = MAZE_route[idx];
+    return TRUE;
+  }
+#endif
+  return FALSE;
 }
 
 /*!
  * \brief Performs a turn.
  * \return Returns TRUE while turn is still in progress.
  */
-uint8_t MAZE_EvaluteTurn(bool *finished) {
+uint8_t MAZE_EvaluteTurn(bool *finished, TURN_StopFct stopIt) {
   REF_LineKind historyLineKind, currLineKind;
   TURN_Kind turn;
+  uint8_t res;
+#if PL_CONFIG_HAS_LINE_JUNCTION
+  int32_t distUm, steps;
+#endif
+#if MAZE_HAS_GRAPH
+  uint8_t node, dir;
+  portTickType ticks;
+#endif
 
   *finished = FALSE;
+#if PL_CONFIG_HAS_LINE_JUNCTION
+  /* the junction is known from the sensor history: no need to step over it with sampling */
+  switch(JCT_Classify(&distUm)) {
+    case JCT_LEFT:           historyLineKind = REF_LINE_LEFT;  currLineKind = REF_LINE_NONE; break;
+    case JCT_RIGHT:          historyLineKind = REF_LINE_RIGHT; currLineKind = REF_LINE_NONE; break;
+    case JCT_LEFT_STRAIGHT:  historyLineKind = REF_LINE_LEFT;  currLineKind = REF_LINE_STRAIGHT; break;
+    case JCT_RIGHT_STRAIGHT: historyLineKind = REF_LINE_RIGHT; currLineKind = REF_LINE_STRAIGHT; break;
+    case JCT_T:              historyLineKind = REF_LINE_FULL;  currLineKind = REF_LINE_NONE; break;
+    case JCT_CROSS:          historyLineKind = REF_LINE_FULL;  currLineKind = REF_LINE_STRAIGHT; break;
+    case JCT_FINISH:         historyLineKind = REF_LINE_FULL;  currLineKind = REF_LINE_FULL; break;
+    case JCT_NONE:
+    case JCT_PENDING:        historyLineKind = REF_LINE_NONE;  currLineKind = REF_LINE_STRAIGHT; break;
+    case JCT_END:
+    default:                 historyLineKind = REF_LINE_NONE;  currLineKind = REF_LINE_NONE; break;
+  }
+  if (distUm>0) { /* move the wheel axle into the middle of the junction, without stopping */
+    steps = ODO_MmToSteps(distUm/1000);
+    TURN_MoveToPos(Q4CLeft_GetPos()+steps, Q4CRight_GetPos()+steps, TRUE, stopIt, 1000);
+    if (stopIt!=NULL && stopIt()) {
+      return ERR_BUSY; /* stopped before the junction has been recorded */
+    }
+  }
+  turn = MAZE_SelectTurn(historyLineKind, currLineKind);
+#if MAZE_HAS_GRAPH
+  if (turn==TURN_FINISHED) {
+    node = MAZE_ReachNode(FALSE, FALSE, FALSE);
+    MAZE_finishNode = node;
+    MAZE_exploreMs = (FRTOS1_xTaskGetTickCount()-MAZE_exploreStartTicks)*portTICK_PERIOD_MS;
+  } else {
+    node = MAZE_ReachNode(historyLineKind==REF_LINE_LEFT || historyLineKind==REF_LINE_FULL,
+        currLineKind!=REF_LINE_NONE,
+        historyLineKind==REF_LINE_RIGHT || historyLineKind==REF_LINE_FULL);
+  }
+#endif
+#else
   currLineKind = REF_GetLineKind();
   if (currLineKind==REF_LINE_NONE) { /* nothing, must be dead end */
-    turn = TURN_LEFT180;
+    turn = MAZE_UTurn();
   } else {
     MAZE_ClearSensorHistory(); /* clear history values */
     MAZE_SampleSensorHistory(); /* store current values */
@@ -168,37 +725,302 @@ uint8_t MAZE_EvaluteTurn(bool *finished) {
     currLineKind = REF_GetLineKind();
     turn = MAZE_SelectTurn(historyLineKind, currLineKind);
   }
+#endif
   if (turn==TURN_FINISHED) {
     *finished = TRUE;
-    LF_StopFollowing();
+    MAZE_SetSolved();
     SHELL_SendString((unsigned char*)"MAZE: finished!\r\n");
     return ERR_OK;
-  } else if (turn==TURN_STRAIGHT) {
-    /*! \todo Extend if necessary */
-    SHELL_SendString((unsigned char*)"going straight\r\n");
-    return ERR_OK;
   } else if (turn==TURN_STOP) { /* should not happen here? */
-    LF_StopFollowing();
     SHELL_SendString((unsigned char*)"Failure, stopped!!!\r\n");
     return ERR_FAILED; /* error case */
-  } else { /* turn or do something */
-    /*! \todo Extend if necessary */
-   return ERR_OK; /* turn finished */
   }
+  MAZE_AddPath(turn);
+#if MAZE_HAS_GRAPH
+  dir = MAZE_GetDir();
+  ticks = FRTOS1_xTaskGetTickCount();
+#endif
+  if (turn!=TURN_STRAIGHT) {
+    res = TURN_TurnOntoLine(turn, stopIt);
+    if (res!=ERR_OK) {
+      if (res!=ERR_BUSY) {
+        SHELL_SendString((unsigned char*)"MAZE: no line after turn!\r\n");
+      }
+      return res;
+    }
+  }
+#if MAZE_HAS_GRAPH
+  MAZE_TurnCost((MAZE_GetDir()-dir)&3, FRTOS1_xTaskGetTickCount()-ticks);
+  MAZE_LeaveNode(node);
+#endif
+  return ERR_OK;
+}
+
+#if PL_CONFIG_HAS_CONFIG_NVM
+/* A solved maze is stored in NVM, so the robot can do the speed run after a power cycle.
+ * The version changes with the layout of the record, and the maze identifier tells which maze it is. */
+#define MAZE_NVM_MAGIC    0x4D5A /* 'MZ', marks a valid record in NVM */
+#define MAZE_NVM_VERSION  2      /* layout of MAZE_NvmData and numbering of TURN_Kind */
+
+typedef struct {
+  uint16_t magic;      /* MAZE_NVM_MAGIC */
+  uint8_t version;     /* MAZE_NVM_VERSION */
+  uint8_t mazeId;      /* identifier of the maze */
+  uint8_t rule;        /* MAZE_Rule used to explore */
+  uint8_t pathLength;  /* number of entries in path[] */
+  uint8_t nofNodes, nofEdges;
+  uint8_t startNode, finishNode, startDir;
+  uint8_t reserved;
+  uint16_t turnCostMs[4];
+  uint32_t exploreMs;
+  uint8_t path[MAZE_MAX_PATH]; /* TURN_Kind */
+#if MAZE_HAS_GRAPH
+  MAZE_Node nodes[MAZE_MAX_NODES];
+  MAZE_Edge edges[MAZE_MAX_EDGES];
+#endif
+} MAZE_NvmData;
+
+static MAZE_NvmData MAZE_nvmData; /* image of the record to be flashed */
+static uint8_t MAZE_mazeId = 0;   /* identifier of the current maze */
+
+static uint8_t MAZE_Save(void) {
+  MAZE_NvmData *p = &MAZE_nvmData;
+  uint8_t i;
+
+  if (!isSolved) {
+    return ERR_FAILED; /* nothing to save */
+  }
+  p->magic = MAZE_NVM_MAGIC;
+  p->version = MAZE_NVM_VERSION;
+  p->mazeId = MAZE_mazeId;
+  p->rule = (uint8_t)MAZE_rule;
+  p->pathLength = pathLength;
+  for(i=0;i<pathLength;i++) {
+    p->path[i] = (uint8_t)path[i];
+  }
+  p->reserved = 0;
+#if MAZE_HAS_GRAPH
+  p->nofNodes = MAZE_nofNodes;
+  p->nofEdges = MAZE_nofEdges;
+  p->startNode = MAZE_startNode;
+  p->finishNode = MAZE_finishNode;
+  p->startDir = MAZE_startDir;
+  for(i=0;i<4;i++) {
+    p->turnCostMs[i] = MAZE_turnCostMs[i];
+  }
+  p->exploreMs = MAZE_exploreMs;
+  for(i=0;i<MAZE_nofNodes;i++) {
+    p->nodes[i] = MAZE_nodes[i];
+  }
+  for(i=0;i<MAZE_nofEdges;i++) {
+    p->edges[i] = MAZE_edges[i];
+  }
+#else
+  p->nofNodes = p->nofEdges = 0;
+#endif
+  return NVMC_SaveMazeData(p, sizeof(MAZE_NvmData));
+}
+
+/* checks the values read from flash which are used as index or enumeration, before we use them */
+static bool MAZE_IsValidNvm(const MAZE_NvmData *p) {
+  uint8_t i, j;
+
+  if (p->rule>MAZE_RULE_RIGHT) {
+    return FALSE;
+  }
+  for(i=0;i<p->pathLength;i++) {
+    if (p->path[i]>TURN_RIGHT90_ARC) {
+      return FALSE;
+    }
+  }
+#if MAZE_HAS_GRAPH
+  if ((p->startNode!=MAZE_NO_IDX && (p->startNode>=p->nofNodes || p->startDir>3))
+      || (p->finishNode!=MAZE_NO_IDX && p->finishNode>=p->nofNodes))
+  {
+    return FALSE;
+  }
+  for(i=0;i<p->nofNodes;i++) {
+    for(j=0;j<4;j++) {
+      if (p->nodes[i].edge[j]!=MAZE_NO_IDX && p->nodes[i].edge[j]>=p->nofEdges) {
+        return FALSE;
+      }
+    }
+  }
+  for(i=0;i<p->nofEdges;i++) {
+    for(j=0;j<2;j++) {
+      if (p->edges[i].node[j]>=p->nofNodes || p->edges[i].dir[j]>3) {
+        return FALSE;
+      }
+    }
+  }
+#endif
+  return TRUE;
+}
+
+/* returns the record in NVM, or NULL if there is no valid one */
+static const MAZE_NvmData *MAZE_GetNvm(void) {
+  const MAZE_NvmData *p;
+
+  p = (const MAZE_NvmData*)NVMC_GetMazeData();
+  if (p==NULL || p->magic!=MAZE_NVM_MAGIC || p->version!=MAZE_NVM_VERSION
+      || p->pathLength==0 || p->pathLength>MAZE_MAX_PATH
+      || p->nofNodes>MAZE_MAX_NODES || p->nofEdges>MAZE_MAX_EDGES)
+  {
+    return NULL; /* erased, invalidated or from another version */
+  }
+  if (!MAZE_IsValidNvm(p)) {
+    return NULL; /* corrupted */
+  }
+  return p;
+}
+
+static bool MAZE_Load(void) {
+  const MAZE_NvmData *p;
+  uint8_t i;
+
+  p = MAZE_GetNvm();
+  if (p==NULL) {
+    return FALSE; /* no valid data */
+  }
+  MAZE_ClearSolution();
+  MAZE_mazeId = p->mazeId;
+  MAZE_rule = (MAZE_Rule)p->rule;
+  pathLength = p->pathLength;
+  for(i=0;i<pathLength;i++) {
+    path[i] = (TURN_Kind)p->path[i];
+  }
+#if MAZE_HAS_GRAPH
+  MAZE_nofNodes = p->nofNodes;
+  MAZE_nofEdges = p->nofEdges;
+  MAZE_startNode = p->startNode;
+  MAZE_finishNode = p->finishNode;
+  MAZE_startDir = p->startDir;
+  for(i=0;i<4;i++) {
+    MAZE_turnCostMs[i] = p->turnCostMs[i];
+  }
+  MAZE_exploreMs = p->exploreMs;
+  for(i=0;i<MAZE_nofNodes;i++) {
+    MAZE_nodes[i] = p->nodes[i];
+  }
+  for(i=0;i<MAZE_nofEdges;i++) {
+    MAZE_edges[i] = p->edges[i];
+  }
+  (void)MAZE_CalcRoute();
+#endif
+  isSolved = TRUE;
+  return TRUE;
 }
 
+static uint8_t MAZE_ClearNvm(void) {
+  if (MAZE_GetNvm()==NULL) {
+    return ERR_OK; /* nothing stored */
+  }
+  MAZE_nvmData.magic = NVMC_FLASH_ERASED_UINT16; /* invalidates the record */
+  return NVMC_SaveMazeData(&MAZE_nvmData.magic, sizeof(MAZE_nvmData.magic));
+}
+#endif /* PL_CONFIG_HAS_CONFIG_NVM */
+
 static void MAZE_PrintHelp(const CLS1_StdIOType *io) {
   CLS1_SendHelpStr((unsigned char*)"maze", (unsigned char*)"Group of maze following commands\r\n", io->stdOut);
   CLS1_SendHelpStr((unsigned char*)"  help|status", (unsigned char*)"Shows maze help or status\r\n", io->stdOut);
+#if PL_CONFIG_HAS_CONFIG_NVM
+  CLS1_SendHelpStr((unsigned char*)"  clear", (unsigned char*)"Clear the maze solution, also in NVM\r\n", io->stdOut);
+  CLS1_SendHelpStr((unsigned char*)"  save|load", (unsigned char*)"Store or load the solved maze in NVM\r\n", io->stdOut);
+  CLS1_SendHelpStr((unsigned char*)"  id <number>", (unsigned char*)"Identifier of the maze, stored with the solution\r\n", io->stdOut);
+#else
   CLS1_SendHelpStr((unsigned char*)"  clear", (unsigned char*)"Clear the maze solution\r\n", io->stdOut);
+#endif
+  CLS1_SendHelpStr((unsigned char*)"  rule (left|right)", (unsigned char*)"Wall following rule to explore the maze\r\n", io->stdOut);
+#if MAZE_HAS_GRAPH
+  CLS1_SendHelpStr((unsigned char*)"  run (max|entry) <mm/s>", (unsigned char*)"Speed run: speed on straights, speed entering a rolling turn\r\n", io->stdOut);
+  CLS1_SendHelpStr((unsigned char*)"  run accel <mm/s^2>", (unsigned char*)"Speed run: acceleration and braking\r\n", io->stdOut);
+  CLS1_SendHelpStr((unsigned char*)"  run radius <mm>", (unsigned char*)"Speed run: radius of the rolling turns\r\n", io->stdOut);
+#endif
 }
 
 #if PL_CONFIG_HAS_SHELL
+#if MAZE_HAS_GRAPH
+static void MAZE_PrintGraph(const CLS1_StdIOType *io) {
+  unsigned char buf[64];
+  uint8_t i;
+
+  UTIL1_Num8uToStr(buf, sizeof(buf), MAZE_nofNodes);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" nodes, ");
+  UTIL1_strcatNum8u(buf, sizeof(buf), MAZE_nofEdges);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" segments\r\n");
+  CLS1_SendStatusStr((unsigned char*)"  map", buf, io->stdOut);
+  for(i=0;i<MAZE_nofEdges;i++) {
+    UTIL1_strcpy(buf, sizeof(buf), (unsigned char*)"  ");
+    UTIL1_strcatNum8u(buf, sizeof(buf), MAZE_edges[i].node[0]);
+    UTIL1_strcat(buf, sizeof(buf), (unsigned char*)"-");
+    UTIL1_strcatNum8u(buf, sizeof(buf), MAZE_edges[i].node[1]);
+    CLS1_SendStatusStr(buf, (unsigned char*)"", io->stdOut);
+    UTIL1_Num16uToStr(buf, sizeof(buf), MAZE_edges[i].lengthMm);
+    UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" mm, ");
+    UTIL1_strcatNum16u(buf, sizeof(buf), MAZE_edges[i].timeMs);
+    UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" ms\r\n");
+    CLS1_SendStr(buf, io->stdOut);
+  }
+  UTIL1_Num16uToStr(buf, sizeof(buf), MAZE_turnCostMs[1]);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" ms left, ");
+  UTIL1_strcatNum16u(buf, sizeof(buf), MAZE_turnCostMs[3]);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" ms right, ");
+  UTIL1_strcatNum16u(buf, sizeof(buf), MAZE_turnCostMs[2]);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" ms U\r\n");
+  CLS1_SendStatusStr((unsigned char*)"  turn cost", buf, io->stdOut);
+  UTIL1_Num16uToStr(buf, sizeof(buf), MAZE_Run.maxSpeed);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" mm/s, entry ");
+  UTIL1_strcatNum16u(buf, sizeof(buf), MAZE_Run.entrySpeed);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" mm/s, ");
+  UTIL1_strcatNum16u(buf, sizeof(buf), MAZE_Run.accel);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" mm/s^2\r\n");
+  CLS1_SendStatusStr((unsigned char*)"  run speed", buf, io->stdOut);
+  UTIL1_Num16uToStr(buf, sizeof(buf), MAZE_Run.radiusMm);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" mm\r\n");
+  CLS1_SendStatusStr((unsigned char*)"  run radius", buf, io->stdOut);
+  UTIL1_Num32uToStr(buf, sizeof(buf), MAZE_exploreMs);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" ms explore, ");
+  UTIL1_strcatNum32u(buf, sizeof(buf), MAZE_runMs);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" ms speed run");
+  if (MAZE_Run.running) {
+    UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" (running)");
+  }
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)"\r\n");
+  CLS1_SendStatusStr((unsigned char*)"  time", buf, io->stdOut);
+  CLS1_SendStatusStr((unsigned char*)"  route", (unsigned char*)"", io->stdOut);
+  if (MAZE_routeLength==0) {
+    CLS1_SendStr((unsigned char*)"none", io->stdOut);
+  }
+  for(i=0;i<MAZE_routeLength;i++) {
+    CLS1_SendStr(TURN_TurnKindStr(MAZE_route[i].turn), io->stdOut);
+    if (MAZE_route[i].lengthMm!=0) {
+      UTIL1_strcpy(buf, sizeof(buf), (unsigned char*)" ");
+      UTIL1_strcatNum16u(buf, sizeof(buf), MAZE_route[i].lengthMm);
+      UTIL1_strcat(buf, sizeof(buf), (unsigned char*)"mm ");
+      CLS1_SendStr(buf, io->stdOut);
+    }
+  }
+  CLS1_SendStr((unsigned char*)"\r\n", io->stdOut);
+}
+#endif /* MAZE_HAS_GRAPH */
+
 static void MAZE_PrintStatus(const CLS1_StdIOType *io) {
   int i;
   
   CLS1_SendStatusStr((unsigned char*)"maze", (unsigned char*)"\r\n", io->stdOut);
   CLS1_SendStatusStr((unsigned char*)"  solved", MAZE_IsSolved()?(unsigned char*)"yes\r\n":(unsigned char*)"no\r\n", io->stdOut);
+  CLS1_SendStatusStr((unsigned char*)"  rule", MAZE_rule==MAZE_RULE_LEFT?(unsigned char*)"left hand\r\n":(unsigned char*)"right hand\r\n", io->stdOut);
+#if PL_CONFIG_HAS_CONFIG_NVM
+  CLS1_SendStatusStr((unsigned char*)"  id", (unsigned char*)"", io->stdOut);
+  CLS1_SendNum8u(MAZE_mazeId, io->stdOut);
+  if (MAZE_GetNvm()!=NULL) {
+    CLS1_SendStr((unsigned char*)", stored maze ", io->stdOut);
+    CLS1_SendNum8u(MAZE_GetNvm()->mazeId, io->stdOut);
+    CLS1_SendStr((unsigned char*)"\r\n", io->stdOut);
+  } else {
+    CLS1_SendStr((unsigned char*)", nothing stored\r\n", io->stdOut);
+  }
+#endif
   CLS1_SendStatusStr((unsigned char*)"  path", (unsigned char*)"(", io->stdOut);
   CLS1_SendNum8u(pathLength, io->stdOut);
   CLS1_SendStr((unsigned char*)") ", io->stdOut);
@@ -207,10 +1029,22 @@ static void MAZE_PrintStatus(const CLS1_StdIOType *io) {
     CLS1_SendStr((unsigned char*)" ", io->stdOut);
   }
   CLS1_SendStr((unsigned char*)"\r\n", io->stdOut);
+#if MAZE_HAS_GRAPH
+  MAZE_PrintGraph(io);
+#endif
 }
 
 uint8_t MAZE_ParseCommand(const unsigned char *cmd, bool *handled, const CLS1_StdIOType *io) {
   uint8_t res = ERR_OK;
+#if MAZE_HAS_GRAPH || PL_CONFIG_HAS_CONFIG_NVM
+  const unsigned char *p;
+#endif
+#if MAZE_HAS_GRAPH
+  uint16_t val16u;
+#endif
+#if PL_CONFIG_HAS_CONFIG_NVM
+  uint8_t val8u;
+#endif
 
   if (UTIL1_strcmp((char*)cmd, (char*)CLS1_CMD_HELP)==0 || UTIL1_strcmp((char*)cmd, (char*)"maze help")==0) {
     MAZE_PrintHelp(io);
@@ -220,7 +1054,83 @@ uint8_t MAZE_ParseCommand(const unsigned char *cmd, bool *handled, const CLS1_St
     *handled = TRUE;
   } else if (UTIL1_strcmp((char*)cmd, (char*)"maze clear")==0) {
     MAZE_ClearSolution();
+#if PL_CONFIG_HAS_CONFIG_NVM
+    if (MAZE_ClearNvm()!=ERR_OK) {
+      CLS1_SendStr((unsigned char*)"Clearing maze data FAILED!\r\n", io->stdErr);
+      res = ERR_FAILED;
+    }
+#endif
+    *handled = TRUE;
+#if PL_CONFIG_HAS_CONFIG_NVM
+  } else if (UTIL1_strcmp((char*)cmd, (char*)"maze save")==0) {
+    if (!MAZE_IsSolved()) {
+      CLS1_SendStr((unsigned char*)"Maze not solved\r\n", io->stdErr);
+      res = ERR_FAILED;
+    } else if (MAZE_Save()!=ERR_OK) {
+      CLS1_SendStr((unsigned char*)"Flashing maze data FAILED!\r\n", io->stdErr);
+      res = ERR_FAILED;
+    }
     *handled = TRUE;
+  } else if (UTIL1_strcmp((char*)cmd, (char*)"maze load")==0) {
+    if (!MAZE_Load()) {
+      CLS1_SendStr((unsigned char*)"No maze in NVM\r\n", io->stdErr);
+      res = ERR_FAILED;
+    }
+    *handled = TRUE;
+  } else if (UTIL1_strncmp((char*)cmd, (char*)"maze id ", sizeof("maze id ")-1)==0) {
+    p = cmd+sizeof("maze id");
+    if (UTIL1_ScanDecimal8uNumber(&p, &val8u)==ERR_OK) {
+      MAZE_mazeId = val8u;
+      *handled = TRUE;
+    } else {
+      CLS1_SendStr((unsigned char*)"Wrong argument\r\n", io->stdErr);
+      res = ERR_FAILED;
+    }
+#endif
+  } else if (UTIL1_strcmp((char*)cmd, (char*)"maze rule left")==0) {
+    MAZE_rule = MAZE_RULE_LEFT;
+    *handled = TRUE;
+  } else if (UTIL1_strcmp((char*)cmd, (char*)"maze rule right")==0) {
+    MAZE_rule = MAZE_RULE_RIGHT;
+    *handled = TRUE;
+#if MAZE_HAS_GRAPH
+  } else if (UTIL1_strncmp((char*)cmd, (char*)"maze run max ", sizeof("maze run max ")-1)==0) {
+    p = cmd+sizeof("maze run max");
+    if (UTIL1_ScanDecimal16uNumber(&p, &val16u)==ERR_OK && val16u>0) {
+      MAZE_Run.maxSpeed = val16u;
+      *handled = TRUE;
+    } else {
+      CLS1_SendStr((unsigned char*)"Wrong argument\r\n", io->stdErr);
+      res = ERR_FAILED;
+    }
+  } else if (UTIL1_strncmp((char*)cmd, (char*)"maze run entry ", sizeof("maze run entry ")-1)==0) {
+    p = cmd+sizeof("maze run entry");
+    if (UTIL1_ScanDecimal16uNumber(&p, &val16u)==ERR_OK && val16u>0) {
+      MAZE_Run.entrySpeed = val16u;
+      *handled = TRUE;
+    } else {
+      CLS1_SendStr((unsigned char*)"Wrong argument\r\n", io->stdErr);
+      res = ERR_FAILED;
+    }
+  } else if (UTIL1_strncmp((char*)cmd, (char*)"maze run accel ", sizeof("maze run accel ")-1)==0) {
+    p = cmd+sizeof("maze run accel");
+    if (UTIL1_ScanDecimal16uNumber(&p, &val16u)==ERR_OK && val16u>0) {
+      MAZE_Run.accel = val16u;
+      *handled = TRUE;
+    } else {
+      CLS1_SendStr((unsigned char*)"Wrong argument\r\n", io->stdErr);
+      res = ERR_FAILED;
+    }
+  } else if (UTIL1_strncmp((char*)cmd, (char*)"maze run radius ", sizeof("maze run radius ")-1)==0) {
+    p = cmd+sizeof("maze run radius");
+    if (UTIL1_ScanDecimal16uNumber(&p, &val16u)==ERR_OK && val16u>0) {
+      MAZE_Run.radiusMm = val16u;
+      *handled = TRUE;
+    } else {
+      CLS1_SendStr((unsigned char*)"Wrong argument\r\n", io->stdErr);
+      res = ERR_FAILED;
+    }
+#endif
   }
   return res;
 }
@@ -237,12 +1147,30 @@ TURN_Kind MAZE_GetSolvedTurn(uint8_t *solvedIdx) {
 void MAZE_ClearSolution(void) {
   isSolved = FALSE;
   pathLength = 0;
+#if MAZE_HAS_GRAPH
+  MAZE_ClearGraph();
+#endif
 }
 
 void MAZE_Deinit(void) {
 }
 
 void MAZE_Init(void) {
+#if MAZE_HAS_GRAPH
+  MAZE_CalcMutex = FRTOS1_xSemaphoreCreateMutex();
+  if (MAZE_CalcMutex==NULL) { /* creation failed */
+    for(;;){} /* error */
+  }
+  FRTOS1_vQueueAddToRegistry(MAZE_CalcMutex, "MazeCalc");
+  MAZE_Run.maxSpeed = MAZE_RUN_MAX_SPEED;
+  MAZE_Run.entrySpeed = MAZE_RUN_ENTRY_SPEED;
+  MAZE_Run.accel = MAZE_RUN_ACCEL;
+  MAZE_Run.radiusMm = MAZE_RUN_RADIUS_MM;
+  MAZE_exploreMs = MAZE_runMs = 0;
+#endif
   MAZE_ClearSolution();
+#if PL_CONFIG_HAS_CONFIG_NVM
+  (void)MAZE_Load(); /* use the stored solution, if any */
+#endif
 }
 #endif /* PL_HAS_LINE_SENSOR */
@@ -13,14 +13,72 @@
 #include "Turn.h"
 #include "Reflectance.h"
 
+/*! \brief Step of the route through the maze: the turn at an intersection, followed by the segment to the next one. */
+typedef struct {
+  TURN_Kind turn;     /*!< turn at the intersection, TURN_STOP at the finish */
+  uint16_t lengthMm;  /*!< length of the segment after the turn */
+  uint16_t timeMs;    /*!< time needed for the segment while exploring */
+} MAZE_Segment;
+
+/*!
+ * \brief Starts exploring the maze: the current position is the start.
+ */
+void MAZE_Start(void);
+
+/*!
+ * \brief Returns a step of the fastest route from the start to the finish, calculated on the map when the maze is solved.
+ * \param idx Index of the step, starting with zero
+ * \param seg Where to store the step
+ * \return TRUE if there is a step with this index
+ */
+bool MAZE_GetRouteSegment(uint8_t idx, MAZE_Segment *seg);
+
+#if PL_CONFIG_HAS_LINE_JUNCTION /* the speed run uses the map */
+/*!
+ * \brief Starts a speed run on the fastest route, if the maze has been solved.
+ * \return TRUE if the speed run has been started
+ */
+bool MAZE_StartRun(void);
+
+/*!
+ * \brief Stops the speed run, e.g. if the line following is stopped.
+ */
+void MAZE_StopRun(void);
+
+/*!
+ * \brief Returns TRUE while a speed run is in progress.
+ */
+bool MAZE_IsRunning(void);
+
+/*!
+ * \brief Speed for the speed run at the current position: accelerating after a turn, braking for the next one.
+ * \return Speed in mm/s
+ */
+uint16_t MAZE_RunSpeed(void);
+
+/*!
+ * \brief Checks with the driven distance if the next turn of the speed run has to start.
+ * \return TRUE if the turn has to start
+ */
+bool MAZE_RunAtTurn(void);
+
+/*!
+ * \brief Performs the next turn of the speed run, a rolling turn for 90 degree.
+ * \param finished Set to TRUE if the finish has been reached
+ * \param stopIt Callback to stop turning, or NULL.
+ * \return ERR_OK, ERR_BUSY if stopped by the callback, or ERR_FAILED if no speed run is in progress
+ */
+uint8_t MAZE_RunTurn(bool *finished, TURN_StopFct stopIt);
+#endif
+
 /*!
- * \brief Adds a new path while going forward through the maze
+ * \brief Adds a new path while going forward through the maze. While exploring, the path is simplified with every turn added.
  * \param kind New path to be added
  */
 void MAZE_AddPath(TURN_Kind kind);
 
 /*!
- * \brief Tries to simplify the path, basically cutting dead end paths.
+ * \brief Tries to simplify the end of the path, basically cutting a dead end path (e.g. left, U turn, left is straight).
  */
 void MAZE_SimplifyPath(void);
 
@@ -48,19 +106,20 @@ void MAZE_ClearSolution(void);
 TURN_Kind MAZE_GetSolvedTurn(uint8_t *solvedIdx);
 
 /*!
- * \brief Selects the new turn based.
- * \param prev Line previous the intersection
- * \param curr Line kind of the intersection.
- * \return The new turn.
+ * \brief Selects the new turn based on the intersection and the left or right hand rule.
+ * \param prev Line previous the intersection (branches to the sides)
+ * \param curr Line kind after the intersection (line continues straight or not).
+ * \return The new turn, TURN_FINISHED for the finish area.
  */
 TURN_Kind MAZE_SelectTurn(REF_LineKind prev, REF_LineKind curr);
 
 /*!
- * \brief Performs a turn.
- * \return Returns TRUE while turn is still in progress.
- * \param finished Set to TRUE if we have reached the finish area
+ * \brief Evaluates the intersection, performs the turn and adds it to the path.
+ * \return Returns ERR_OK, ERR_BUSY if stopped by the callback, or ERR_FAILED if no turn could be selected.
+ * \param finished Set to TRUE if we have reached the finish area, the path is then solved
+ * \param stopIt Callback to stop turning, or NULL.
  */
-uint8_t MAZE_EvaluteTurn(bool *finished);
+uint8_t MAZE_EvaluteTurn(bool *finished, TURN_StopFct stopIt);
 
 #if PL_CONFIG_HAS_SHELL
 #include "CLS1.h"
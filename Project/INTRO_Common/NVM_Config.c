@@ -23,18 +23,58 @@ static bool isErased(uint8_t *ptr, int nofBytes) {
   return TRUE;
 }
 
-uint8_t NVMC_SaveReflectanceData(void *data, uint16_t dataSize) {
-  if (dataSize>NVMC_REFLECTANCE_DATA_SIZE) {
+static uint8_t SaveData(IFsh1_TAddress addr, uint16_t areaSize, void *data, uint16_t dataSize) {
+  if (dataSize>areaSize) {
     return ERR_OVERFLOW;
   }
-  return IFsh1_SetBlockFlash(data, (IFsh1_TAddress)(NVMC_REFLECTANCE_DATA_START_ADDR), dataSize);  
+  return IFsh1_SetBlockFlash(data, addr, dataSize);
 }
 
-void *NVMC_GetReflectanceData(void) {
-  if (isErased((uint8_t*)NVMC_REFLECTANCE_DATA_START_ADDR, NVMC_REFLECTANCE_DATA_SIZE)) {
+static void *GetData(uint32_t addr, uint16_t areaSize) {
+  if (isErased((uint8_t*)addr, areaSize)) {
     return NULL;
   }
-  return (void*)NVMC_REFLECTANCE_DATA_START_ADDR;
+  return (void*)addr;
+}
+
+uint8_t NVMC_SaveReflectanceData(void *data, uint16_t dataSize) {
+  return SaveData((IFsh1_TAddress)(NVMC_REFLECTANCE_DATA_START_ADDR), NVMC_REFLECTANCE_DATA_SIZE, data, dataSize);
+}
+
+void *NVMC_GetReflectanceData(void) {
+  return GetData(NVMC_REFLECTANCE_DATA_START_ADDR, NVMC_REFLECTANCE_DATA_SIZE);
+}
+
+uint8_t NVMC_SaveOdometryData(void *data, uint16_t dataSize) {
+  return SaveData((IFsh1_TAddress)(NVMC_ODOMETRY_DATA_START_ADDR), NVMC_ODOMETRY_DATA_SIZE, data, dataSize);
+}
+
+void *NVMC_GetOdometryData(void) {
+  return GetData(NVMC_ODOMETRY_DATA_START_ADDR, NVMC_ODOMETRY_DATA_SIZE);
+}
+
+uint8_t NVMC_SaveTurnData(void *data, uint16_t dataSize) {
+  return SaveData((IFsh1_TAddress)(NVMC_TURN_DATA_START_ADDR), NVMC_TURN_DATA_SIZE, data, dataSize);
+}
+
+void *NVMC_GetTurnData(void) {
+  return GetData(NVMC_TURN_DATA_START_ADDR, NVMC_TURN_DATA_SIZE);
+}
+
+uint8_t NVMC_SaveTrackData(void *data, uint16_t dataSize) {
+  return SaveData((IFsh1_TAddress)(NVMC_TRACK_DATA_START_ADDR), NVMC_TRACK_DATA_SIZE, data, dataSize);
+}
+
+void *NVMC_GetTrackData(void) {
+  return GetData(NVMC_TRACK_DATA_START_ADDR, NVMC_TRACK_DATA_SIZE);
+}
+
+uint8_t NVMC_SaveMazeData(void *data, uint16_t dataSize) {
+  return SaveData((IFsh1_TAddress)(NVMC_MAZE_DATA_START_ADDR), NVMC_MAZE_DATA_SIZE, data, dataSize);
+}
+
+void *NVMC_GetMazeData(void) {
+  return GetData(NVMC_MAZE_DATA_START_ADDR, NVMC_MAZE_DATA_SIZE);
 }
 
 void NVMC_Init(void) {
@@ -34,6 +34,22 @@
 #define NVMC_REFLECTANCE_DATA_SIZE        (6*2*2) /* maximum of 6 sensors (min and max) values with 16 bits */
 #define NVMC_REFLECTANCE_END_ADDR         (NVMC_REFLECTANCE_DATA_START_ADDR+NVMC_REFLECTANCE_DATA_SIZE)
 
+#define NVMC_ODOMETRY_DATA_START_ADDR     (NVMC_REFLECTANCE_END_ADDR)
+#define NVMC_ODOMETRY_DATA_SIZE           (8) /* steps per meter (32bit), wheel base (16bit) and reserved (16bit) */
+#define NVMC_ODOMETRY_END_ADDR            (NVMC_ODOMETRY_DATA_START_ADDR+NVMC_ODOMETRY_DATA_SIZE)
+
+#define NVMC_TURN_DATA_START_ADDR         (NVMC_ODOMETRY_END_ADDR)
+#define NVMC_TURN_DATA_SIZE               (8) /* steps for 90 degree (32bit), steps line and post line (16bit each) */
+#define NVMC_TURN_END_ADDR                (NVMC_TURN_DATA_START_ADDR+NVMC_TURN_DATA_SIZE)
+
+#define NVMC_TRACK_DATA_START_ADDR        (NVMC_TURN_END_ADDR)
+#define NVMC_TRACK_DATA_SIZE              (8+256*4) /* header and 256 track segments of 4 bytes */
+#define NVMC_TRACK_END_ADDR               (NVMC_TRACK_DATA_START_ADDR+NVMC_TRACK_DATA_SIZE)
+
+#define NVMC_MAZE_DATA_START_ADDR         (NVMC_TRACK_END_ADDR)
+#define NVMC_MAZE_DATA_SIZE               (1024) /* header, path and map of a solved maze */
+#define NVMC_MAZE_END_ADDR                (NVMC_MAZE_DATA_START_ADDR+NVMC_MAZE_DATA_SIZE)
+
 /*!
  * \brief Saves the reflectance calibration data
  * \param data Pointer to the data
@@ -48,6 +64,62 @@ uint8_t NVMC_SaveReflectanceData(void *data, uint16_t dataSize);
  */
 void *NVMC_GetReflectanceData(void);
 
+/*!
+ * \brief Saves the odometry calibration data
+ * \param data Pointer to the data
+ * \param dataSize Size of data in bytes
+ * \return Error code, ERR_OK if everything is fine
+ */
+uint8_t NVMC_SaveOdometryData(void *data, uint16_t dataSize);
+
+/*!
+ * \brief Returns the odometry calibration data
+ * \return Pointer to data, or NULL for failure
+ */
+void *NVMC_GetOdometryData(void);
+
+/*!
+ * \brief Saves the turn calibration data
+ * \param data Pointer to the data
+ * \param dataSize Size of data in bytes
+ * \return Error code, ERR_OK if everything is fine
+ */
+uint8_t NVMC_SaveTurnData(void *data, uint16_t dataSize);
+
+/*!
+ * \brief Returns the turn calibration data
+ * \return Pointer to data, or NULL for failure
+ */
+void *NVMC_GetTurnData(void);
+
+/*!
+ * \brief Saves the recorded track
+ * \param data Pointer to the data
+ * \param dataSize Size of data in bytes
+ * \return Error code, ERR_OK if everything is fine
+ */
+uint8_t NVMC_SaveTrackData(void *data, uint16_t dataSize);
+
+/*!
+ * \brief Returns the recorded track
+ * \return Pointer to data, or NULL for failure
+ */
+void *NVMC_GetTrackData(void);
+
+/*!
+ * \brief Saves the solved maze
+ * \param data Pointer to the data
+ * \param dataSize Size of data in bytes
+ * \return Error code, ERR_OK if everything is fine
+ */
+uint8_t NVMC_SaveMazeData(void *data, uint16_t dataSize);
+
+/*!
+ * \brief Returns the solved maze
+ * \return Pointer to data, or NULL for failure
+ */
+void *NVMC_GetMazeData(void);
+
 /*! \brief Driver initialization  */
 void NVMC_Init(void);
 
@@ -0,0 +1,278 @@
+/**
+ * \file
+ * \brief Implementation of the odometry module.
+ *
+ * The pose is integrated with fixed point arithmetic: positions are in micro meters,
+ * the heading is a 32bit binary angle (2^32 is a full circle) so it wraps around naturally.
+ * Sine and cosine are taken from a quarter wave lookup table.
+ * Every update needs a constant number of instructions, so it can run in the drive control loop.
+ */
+
+#include "Platform.h"
+#if PL_CONFIG_HAS_ODOMETRY
+#include "Odometry.h"
+#include "FRTOS1.h"
+#include "UTIL1.h"
+#include "Q4CLeft.h"
+#include "Q4CRight.h"
+#if PL_CONFIG_HAS_SHELL
+  #include "CLS1.h"
+#endif
+#if PL_CONFIG_HAS_CONFIG_NVM
+  #include "NVM_Config.h"
+#endif
+
+#define ODO_DEFAULT_STEPS_PER_M     10180 /* encoder steps per meter, matches 680 steps for a 90 degree turn */
+#define ODO_DEFAULT_WHEEL_BASE_MM   85    /* distance between the wheels */
+#define ODO_MAX_STEPS_PER_UPDATE    500   /* more steps between two updates means the encoder has been changed by software */
+#define ODO_BAM32_PER_RAD           683565276UL /* 2^32/(2*pi) */
+
+/* calibration data, as stored in NVM */
+typedef struct {
+  uint32_t stepsPerM;   /* encoder steps per meter */
+  uint16_t wheelBaseMm; /* distance between the wheels in mm */
+  uint16_t reserved;
+} ODO_CalibData;
+
+static ODO_CalibData ODO_Calib;
+static int32_t ODO_umPerStepQ8;  /* micro meters per encoder step, Q8 */
+static int32_t ODO_bamPerUm;     /* 32bit binary angle per micro meter of wheel difference */
+
+static int32_t ODO_xUm, ODO_yUm;  /* position */
+static uint32_t ODO_heading;      /* heading, 32bit binary angle */
+static int32_t ODO_distUm;        /* travelled distance */
+static int32_t ODO_prevLeft, ODO_prevRight; /* encoder values of last update */
+
+/* sin() for 0..90 degree in 64 steps, Q15 */
+static const int16_t ODO_SinTable[65] = {
+  0, 804, 1608, 2410, 3212, 4011, 4808, 5602,
+  6393, 7179, 7962, 8739, 9512, 10278, 11039, 11793,
+  12539, 13279, 14010, 14732, 15446, 16151, 16846, 17530,
+  18204, 18868, 19519, 20159, 20787, 21403, 22005, 22594,
+  23170, 23731, 24279, 24811, 25329, 25832, 26319, 26790,
+  27245, 27683, 28105, 28510, 28898, 29268, 29621, 29956,
+  30273, 30571, 30852, 31113, 31356, 31580, 31785, 31971,
+  32137, 32285, 32412, 32521, 32609, 32678, 32728, 32757,
+  32767,
+};
+
+int16_t ODO_Sin(ODO_Angle angle) {
+  uint8_t quadrant, idx, frac;
+  int32_t val;
+
+  quadrant = angle>>14;
+  idx = (angle>>8)&0x3F;
+  frac = angle&0xFF;
+  if (quadrant&1) { /* 90..180 and 270..360 degree: mirror the table */
+    idx = 63-idx;
+    frac = 255-frac;
+  }
+  /* linear interpolation between two table entries */
+  val = ODO_SinTable[idx]+(((int32_t)(ODO_SinTable[idx+1]-ODO_SinTable[idx])*frac)>>8);
+  if (quadrant&2) { /* 180..360 degree: negative */
+    val = -val;
+  }
+  return (int16_t)val;
+}
+
+int16_t ODO_Cos(ODO_Angle angle) {
+  return ODO_Sin(angle+0x4000);
+}
+
+static void ODO_CalcFactors(void) {
+  ODO_umPerStepQ8 = (int32_t)((1000000UL<<8)/ODO_Calib.stepsPerM);
+  ODO_bamPerUm = (int32_t)(ODO_BAM32_PER_RAD/(ODO_Calib.wheelBaseMm*1000UL));
+}
+
+void ODO_GetPose(ODO_Pose *pose) {
+  FRTOS1_taskENTER_CRITICAL();
+  pose->xUm = ODO_xUm;
+  pose->yUm = ODO_yUm;
+  pose->heading = (ODO_Angle)(ODO_heading>>16);
+  FRTOS1_taskEXIT_CRITICAL();
+}
+
+int32_t ODO_GetDistanceUm(void) {
+  return ODO_distUm;
+}
+
+int32_t ODO_MmToSteps(int32_t mm) {
+  return (mm*(int32_t)ODO_Calib.stepsPerM)/1000;
+}
+
+uint16_t ODO_GetWheelBaseMm(void) {
+  return ODO_Calib.wheelBaseMm;
+}
+
+void ODO_SyncEncoders(void) {
+  FRTOS1_taskENTER_CRITICAL();
+  ODO_prevLeft = (int32_t)Q4CLeft_GetPos();
+  ODO_prevRight = (int32_t)Q4CRight_GetPos();
+  FRTOS1_taskEXIT_CRITICAL();
+}
+
+void ODO_Reset(void) {
+  FRTOS1_taskENTER_CRITICAL();
+  ODO_xUm = 0;
+  ODO_yUm = 0;
+  ODO_heading = 0;
+  ODO_distUm = 0;
+  FRTOS1_taskEXIT_CRITICAL();
+  ODO_SyncEncoders();
+}
+
+void ODO_Update(void) {
+  int32_t left, right, dL, dR, dCenter;
+  int32_t dHeading;
+  ODO_Angle mid;
+
+  FRTOS1_taskENTER_CRITICAL();
+  left = (int32_t)Q4CLeft_GetPos();
+  right = (int32_t)Q4CRight_GetPos();
+  dL = left-ODO_prevLeft;
+  dR = right-ODO_prevRight;
+  ODO_prevLeft = left;
+  ODO_prevRight = right;
+  FRTOS1_taskEXIT_CRITICAL();
+  if (dL>ODO_MAX_STEPS_PER_UPDATE || dL<-ODO_MAX_STEPS_PER_UPDATE || dR>ODO_MAX_STEPS_PER_UPDATE || dR<-ODO_MAX_STEPS_PER_UPDATE) {
+    return; /* encoder has been reset: ignore this delta */
+  }
+  if (dL==0 && dR==0) {
+    return; /* not moving */
+  }
+  /* wheel movement in micro meters */
+  dL = (dL*ODO_umPerStepQ8)>>8;
+  dR = (dR*ODO_umPerStepQ8)>>8;
+  dCenter = (dL+dR)/2;
+  dHeading = (dR-dL)*ODO_bamPerUm;
+  /* use the heading in the middle of the movement for the position update */
+  mid = (ODO_Angle)((ODO_heading+(uint32_t)(dHeading/2))>>16);
+  FRTOS1_taskENTER_CRITICAL();
+  ODO_xUm += (dCenter*ODO_Cos(mid)+(1<<14))>>15;
+  ODO_yUm += (dCenter*ODO_Sin(mid)+(1<<14))>>15;
+  ODO_heading += (uint32_t)dHeading;
+  ODO_distUm += dCenter;
+  FRTOS1_taskEXIT_CRITICAL();
+}
+
+#if PL_CONFIG_HAS_SHELL
+static void ODO_PrintHelp(const CLS1_StdIOType *io) {
+  CLS1_SendHelpStr((unsigned char*)"odo", (unsigned char*)"Group of odometry commands\r\n", io->stdOut);
+  CLS1_SendHelpStr((unsigned char*)"  help|status", (unsigned char*)"Shows odometry help or status\r\n", io->stdOut);
+  CLS1_SendHelpStr((unsigned char*)"  reset", (unsigned char*)"Reset pose and distance\r\n", io->stdOut);
+  CLS1_SendHelpStr((unsigned char*)"  stepsperm <steps>", (unsigned char*)"Number of encoder steps per meter\r\n", io->stdOut);
+  CLS1_SendHelpStr((unsigned char*)"  wheelbase <mm>", (unsigned char*)"Distance between the wheels in mm\r\n", io->stdOut);
+#if PL_CONFIG_HAS_CONFIG_NVM
+  CLS1_SendHelpStr((unsigned char*)"  save", (unsigned char*)"Store calibration values in NVM\r\n", io->stdOut);
+#endif
+}
+
+static void ODO_PrintStatus(const CLS1_StdIOType *io) {
+  unsigned char buf[32];
+  ODO_Pose pose;
+
+  ODO_GetPose(&pose);
+  CLS1_SendStatusStr((unsigned char*)"odo", (unsigned char*)"\r\n", io->stdOut);
+
+  UTIL1_Num32sToStr(buf, sizeof(buf), pose.xUm/1000);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" mm\r\n");
+  CLS1_SendStatusStr((unsigned char*)"  x", buf, io->stdOut);
+
+  UTIL1_Num32sToStr(buf, sizeof(buf), pose.yUm/1000);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" mm\r\n");
+  CLS1_SendStatusStr((unsigned char*)"  y", buf, io->stdOut);
+
+  UTIL1_Num32sToStr(buf, sizeof(buf), ((int32_t)pose.heading*360)>>16);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" degree\r\n");
+  CLS1_SendStatusStr((unsigned char*)"  heading", buf, io->stdOut);
+
+  UTIL1_Num32sToStr(buf, sizeof(buf), ODO_GetDistanceUm()/1000);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" mm\r\n");
+  CLS1_SendStatusStr((unsigned char*)"  distance", buf, io->stdOut);
+
+  UTIL1_Num32uToStr(buf, sizeof(buf), ODO_Calib.stepsPerM);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" steps/m\r\n");
+  CLS1_SendStatusStr((unsigned char*)"  steps", buf, io->stdOut);
+
+  UTIL1_Num32uToStr(buf, sizeof(buf), ODO_Calib.wheelBaseMm);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" mm\r\n");
+  CLS1_SendStatusStr((unsigned char*)"  wheel base", buf, io->stdOut);
+}
+
+uint8_t ODO_ParseCommand(const unsigned char *cmd, bool *handled, const CLS1_StdIOType *io) {
+  uint8_t res = ERR_OK;
+  const unsigned char *p;
+  uint32_t val32u;
+  uint16_t val16u;
+
+  if (UTIL1_strcmp((char*)cmd, (char*)CLS1_CMD_HELP)==0 || UTIL1_strcmp((char*)cmd, (char*)"odo help")==0) {
+    ODO_PrintHelp(io);
+    *handled = TRUE;
+  } else if (UTIL1_strcmp((char*)cmd, (char*)CLS1_CMD_STATUS)==0 || UTIL1_strcmp((char*)cmd, (char*)"odo status")==0) {
+    ODO_PrintStatus(io);
+    *handled = TRUE;
+  } else if (UTIL1_strcmp((char*)cmd, (char*)"odo reset")==0) {
+    ODO_Reset();
+    *handled = TRUE;
+  } else if (UTIL1_strncmp((char*)cmd, (char*)"odo stepsperm ", sizeof("odo stepsperm ")-1)==0) {
+    p = cmd+sizeof("odo stepsperm");
+    if (UTIL1_ScanDecimal32uNumber(&p, &val32u)==ERR_OK && val32u>0) {
+      FRTOS1_taskENTER_CRITICAL();
+      ODO_Calib.stepsPerM = val32u;
+      ODO_CalcFactors();
+      FRTOS1_taskEXIT_CRITICAL();
+      *handled = TRUE;
+    } else {
+      CLS1_SendStr((unsigned char*)"Wrong argument\r\n", io->stdErr);
+      res = ERR_FAILED;
+    }
+  } else if (UTIL1_strncmp((char*)cmd, (char*)"odo wheelbase ", sizeof("odo wheelbase ")-1)==0) {
+    p = cmd+sizeof("odo wheelbase");
+    if (UTIL1_ScanDecimal16uNumber(&p, &val16u)==ERR_OK && val16u>0) {
+      FRTOS1_taskENTER_CRITICAL();
+      ODO_Calib.wheelBaseMm = val16u;
+      ODO_CalcFactors();
+      FRTOS1_taskEXIT_CRITICAL();
+      *handled = TRUE;
+    } else {
+      CLS1_SendStr((unsigned char*)"Wrong argument\r\n", io->stdErr);
+      res = ERR_FAILED;
+    }
+#if PL_CONFIG_HAS_CONFIG_NVM
+  } else if (UTIL1_strcmp((char*)cmd, (char*)"odo save")==0) {
+    if (NVMC_SaveOdometryData(&ODO_Calib, sizeof(ODO_Calib))!=ERR_OK) {
+      CLS1_SendStr((unsigned char*)"Flashing odometry data FAILED!\r\n", io->stdErr);
+      res = ERR_FAILED;
+    }
+    *handled = TRUE;
+#endif
+  }
+  return res;
+}
+#endif /* PL_CONFIG_HAS_SHELL */
+
+void ODO_Deinit(void) {
+  /* nothing needed */
+}
+
+void ODO_Init(void) {
+#if PL_CONFIG_HAS_CONFIG_NVM
+  ODO_CalibData *ptr;
+
+  ptr = (ODO_CalibData*)NVMC_GetOdometryData();
+  if (ptr!=NULL && ptr->stepsPerM!=0 && ptr->wheelBaseMm!=0) { /* valid data */
+    ODO_Calib = *ptr;
+  } else {
+    ODO_Calib.stepsPerM = ODO_DEFAULT_STEPS_PER_M;
+    ODO_Calib.wheelBaseMm = ODO_DEFAULT_WHEEL_BASE_MM;
+    ODO_Calib.reserved = 0;
+  }
+#else
+  ODO_Calib.stepsPerM = ODO_DEFAULT_STEPS_PER_M;
+  ODO_Calib.wheelBaseMm = ODO_DEFAULT_WHEEL_BASE_MM;
+  ODO_Calib.reserved = 0;
+#endif
+  ODO_CalcFactors();
+  ODO_Reset();
+}
+#endif /* PL_CONFIG_HAS_ODOMETRY */
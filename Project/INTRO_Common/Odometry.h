@@ -0,0 +1,99 @@
+/**
+ * \file
+ * \brief Interface to the odometry module.
+ *
+ * This module estimates the pose (position and heading) of the robot
+ * based on the quadrature encoder values of the two wheels (differential drive).
+ */
+
+#ifndef ODOMETRY_H_
+#define ODOMETRY_H_
+
+#include "Platform.h"
+#if PL_CONFIG_HAS_ODOMETRY
+
+#if PL_CONFIG_HAS_SHELL
+#include "CLS1.h"
+/*!
+ * \brief Shell command line parser.
+ * \param[in] cmd Pointer to command string
+ * \param[out] handled If command is handled by the parser
+ * \param[in] io Std I/O handler of shell
+ */
+uint8_t ODO_ParseCommand(const unsigned char *cmd, bool *handled, const CLS1_StdIOType *io);
+#endif
+
+/*! \brief Binary angle: 0x10000 is a full circle, 0x4000 is 90 degree. Positive is counter-clockwise. */
+typedef uint16_t ODO_Angle;
+
+/*! \brief Pose of the robot, relative to the position and heading at the last reset. */
+typedef struct {
+  int32_t xUm;      /*!< x position in micro meters, x axis is the heading at reset */
+  int32_t yUm;      /*!< y position in micro meters, positive is to the left */
+  ODO_Angle heading; /*!< heading of the robot */
+} ODO_Pose;
+
+/*!
+ * \brief Returns the current pose of the robot.
+ * \param pose Where to store the pose
+ */
+void ODO_GetPose(ODO_Pose *pose);
+
+/*!
+ * \brief Returns the distance travelled since reset, measured at the center between the wheels.
+ * \return Distance in micro meters, negative if going backward.
+ */
+int32_t ODO_GetDistanceUm(void);
+
+/*!
+ * \brief Converts a distance into encoder steps, using the calibration values.
+ * \param mm Distance in milli meters
+ * \return Number of encoder steps
+ */
+int32_t ODO_MmToSteps(int32_t mm);
+
+/*!
+ * \brief Returns the wheel base (distance between the wheels).
+ * \return Wheel base in milli meters
+ */
+uint16_t ODO_GetWheelBaseMm(void);
+
+/*!
+ * \brief Returns the sine of an angle.
+ * \param angle Binary angle
+ * \return Sine value in Q15 format (32767 is 1.0)
+ */
+int16_t ODO_Sin(ODO_Angle angle);
+
+/*!
+ * \brief Returns the cosine of an angle.
+ * \param angle Binary angle
+ * \return Cosine value in Q15 format (32767 is 1.0)
+ */
+int16_t ODO_Cos(ODO_Angle angle);
+
+/*!
+ * \brief Resets the pose and distance to zero.
+ */
+void ODO_Reset(void);
+
+/*!
+ * \brief Takes the current encoder values as new reference without counting it as a movement.
+ * Needs to be called whenever the encoder counters are changed by software.
+ */
+void ODO_SyncEncoders(void);
+
+/*!
+ * \brief Integrates the pose with the encoder deltas since last call. Called by the drive task every control period.
+ */
+void ODO_Update(void);
+
+/*! \brief Module de-initialization. */
+void ODO_Deinit(void);
+
+/*! \brief Module initialization. */
+void ODO_Init(void);
+
+#endif /* PL_CONFIG_HAS_ODOMETRY */
+
+#endif /* ODOMETRY_H_ */
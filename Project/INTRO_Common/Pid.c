@@ -28,6 +28,18 @@ typedef struct {
 static PID_Config lineFwConfig;
 static PID_Config speedLeftConfig, speedRightConfig;
 static PID_Config posLeftConfig, posRightConfig;
+static PID_Config syncConfig; /* cross-coupling of the two speed controllers */
+static bool PID_lineSaturated = FALSE; /* if the output of the last line PID calculation has been limited */
+
+/* state of the wheel synchronization */
+static struct {
+  bool enabled;             /* if cross-coupling is used */
+  bool started;             /* FALSE if we need to take the current wheel positions as reference */
+  int32_t prevPosL, prevPosR; /* wheel positions of last iteration */
+  int32_t setL, setR;       /* desired speeds the error has been accumulated for */
+  int32_t error;            /* synchronization error in steps, positive if left wheel is ahead */
+  int32_t remainder;        /* remainder of the error normalization, so we do not lose steps */
+} PID_Sync;
 
 static int32_t PID(int32_t currVal, int32_t setVal, PID_Config *config) {
   int32_t error;
@@ -102,8 +114,8 @@ static uint8_t errorWithinPercent(int32_t error) {
 
 #define PID_DEBUG 0
 
-void PID_LineCfg(uint16_t currLine, uint16_t setLine, PID_Config *config) {
-  int32_t pid, speed, speedL, speedR;
+void PID_LineCfg(uint16_t currLine, uint16_t setLine, uint8_t maxSpeedPercent, int32_t feedForward, PID_Config *config) {
+  int32_t pid, pidUnlimited, speed, speedL, speedR;
 #if PID_DEBUG
   unsigned char buf[16];
   static uint8_t cnt = 0;
@@ -111,12 +123,13 @@ void PID_LineCfg(uint16_t currLine, uint16_t setLine, PID_Config *config) {
   uint8_t errorPercent;
   MOT_Direction directionL=MOT_DIR_FORWARD, directionR=MOT_DIR_FORWARD;
 
-  pid = PID(currLine, setLine, config);
+  pid = PID(currLine, setLine, config)+feedForward; /* feed-forward is added outside of the PID, so it does not wind up the integral */
+  pidUnlimited = pid;
   errorPercent = errorWithinPercent(currLine-setLine);
 
   /* transform into different speed for motors. The PID is used as difference value to the motor PWM */
   if (errorPercent <= 20) { /* pretty on center: move forward both motors with base speed */
-    speed = ((int32_t)config->maxSpeedPercent)*(0xffff/100); /* 100% */
+    speed = ((int32_t)maxSpeedPercent)*(0xffff/100); /* 100% */
     pid = Limit(pid, -speed, speed);
     if (pid<0) { /* turn right */
       speedR = speed;
@@ -127,7 +140,7 @@ void PID_LineCfg(uint16_t currLine, uint16_t setLine, PID_Config *config) {
     }
   } else if (errorPercent <= 40) {
     /* outside left/right halve position from center, slow down one motor and speed up the other */
-    speed = ((int32_t)config->maxSpeedPercent)*(0xffff/100)*8/10; /* 80% */
+    speed = ((int32_t)maxSpeedPercent)*(0xffff/100)*8/10; /* 80% */
     pid = Limit(pid, -speed, speed);
     if (pid<0) { /* turn right */
       speedR = speed+pid; /* decrease speed */
@@ -137,7 +150,7 @@ void PID_LineCfg(uint16_t currLine, uint16_t setLine, PID_Config *config) {
       speedL = speed-pid; /* decrease speed */
     }
   } else if (errorPercent <= 70) {
-    speed = ((int32_t)config->maxSpeedPercent)*(0xffff/100)*6/10; /* %60 */
+    speed = ((int32_t)maxSpeedPercent)*(0xffff/100)*6/10; /* %60 */
     pid = Limit(pid, -speed, speed);
     if (pid<0) { /* turn right */
       speedR = 0 /*maxSpeed+pid*/; /* decrease speed */
@@ -148,7 +161,7 @@ void PID_LineCfg(uint16_t currLine, uint16_t setLine, PID_Config *config) {
     }
   } else  {
     /* line is far to the left or right: use backward motor motion */
-    speed = ((int32_t)config->maxSpeedPercent)*(0xffff/100)*10/10; /* %80 */
+    speed = ((int32_t)maxSpeedPercent)*(0xffff/100)*10/10; /* %80 */
     if (pid<0) { /* turn right */
       speedR = -speed+pid; /* decrease speed */
       speedL = speed-pid; /* increase speed */
@@ -161,6 +174,7 @@ void PID_LineCfg(uint16_t currLine, uint16_t setLine, PID_Config *config) {
     directionL = AbsSpeed(&speedL);
     directionR = AbsSpeed(&speedR);
   }
+  PID_lineSaturated = pid!=pidUnlimited || errorPercent>70;
   /* speed is now always positive, make sure it is within 16bit PWM boundary */
   if (speedL>0xFFFF) {
     speedL = 0xFFFF;
@@ -213,7 +227,23 @@ void PID_LineCfg(uint16_t currLine, uint16_t setLine, PID_Config *config) {
 }
 
 void PID_Line(uint16_t currLine, uint16_t setLine) {
-  PID_LineCfg(currLine, setLine, &lineFwConfig);
+  PID_LineCfg(currLine, setLine, lineFwConfig.maxSpeedPercent, 0, &lineFwConfig);
+}
+
+void PID_LineSpeed(uint16_t currLine, uint16_t setLine, uint8_t maxSpeedPercent) {
+  PID_LineCfg(currLine, setLine, maxSpeedPercent, 0, &lineFwConfig);
+}
+
+void PID_LineFeedForward(uint16_t currLine, uint16_t setLine, uint8_t maxSpeedPercent, int32_t feedForward) {
+  PID_LineCfg(currLine, setLine, maxSpeedPercent, feedForward, &lineFwConfig);
+}
+
+uint8_t PID_GetLineMaxSpeedPercent(void) {
+  return lineFwConfig.maxSpeedPercent;
+}
+
+bool PID_LineIsSaturated(void) {
+  return PID_lineSaturated;
 }
 
 void PID_Speed(int32_t currSpeed, int32_t setSpeed, bool isLeft) {
@@ -224,6 +254,53 @@ void PID_Speed(int32_t currSpeed, int32_t setSpeed, bool isLeft) {
   }
 }
 
+static int32_t Abs32(int32_t val) {
+  return val<0?-val:val;
+}
+
+void PID_SpeedSync(int32_t currSpeedL, int32_t currSpeedR, int32_t setSpeedL, int32_t setSpeedR, int32_t posL, int32_t posR) {
+  int32_t dL, dR, norm, num, corr, maxCorr;
+
+  if (!PID_Sync.enabled || (setSpeedL==0 && setSpeedR==0)) {
+    PID_Sync.started = FALSE; /* start again with a new reference */
+    PID_SpeedCfg(currSpeedL, setSpeedL, TRUE, &speedLeftConfig);
+    PID_SpeedCfg(currSpeedR, setSpeedR, FALSE, &speedRightConfig);
+    return;
+  }
+  if (!PID_Sync.started || setSpeedL!=PID_Sync.setL || setSpeedR!=PID_Sync.setR) {
+    /* new speed ratio: hold the heading from here */
+    PID_Sync.started = TRUE;
+    PID_Sync.prevPosL = posL;
+    PID_Sync.prevPosR = posR;
+    PID_Sync.setL = setSpeedL;
+    PID_Sync.setR = setSpeedR;
+    PID_Sync.error = 0;
+    PID_Sync.remainder = 0;
+    syncConfig.lastError = 0;
+    syncConfig.integral = 0;
+  }
+  dL = posL-PID_Sync.prevPosL;
+  dR = posR-PID_Sync.prevPosR;
+  PID_Sync.prevPosL = posL;
+  PID_Sync.prevPosR = posR;
+  #define PID_SYNC_MAX_STEPS 500 /* more steps in one iteration means the encoder has been reset */
+  if (Abs32(dL)>PID_SYNC_MAX_STEPS || Abs32(dR)>PID_SYNC_MAX_STEPS) {
+    dL = dR = 0; /* ignore the jump */
+  }
+  /* The wheels are in sync if dL/setL==dR/setR. The error dL*setR-dR*setL is normalized with the
+   * larger speed, so it is the position difference in steps for straight driving. */
+  norm = Abs32(setSpeedL)>Abs32(setSpeedR)?Abs32(setSpeedL):Abs32(setSpeedR);
+  num = dL*setSpeedR-dR*setSpeedL+PID_Sync.remainder;
+  PID_Sync.error += num/norm;
+  PID_Sync.remainder = num%norm;
+  corr = PID(PID_Sync.error, 0, &syncConfig); /* negative if left is ahead */
+  maxCorr = (norm*syncConfig.maxSpeedPercent)/100;
+  corr = Limit(corr, -maxCorr, maxCorr);
+  /* distribute the correction according to the influence of each wheel on the error */
+  PID_SpeedCfg(currSpeedL, setSpeedL+(corr*setSpeedR)/norm, TRUE, &speedLeftConfig);
+  PID_SpeedCfg(currSpeedR, setSpeedR-(corr*setSpeedL)/norm, FALSE, &speedRightConfig);
+}
+
 void PID_PosCfg(int32_t currPos, int32_t setPos, bool isLeft, PID_Config *config) {
   int32_t speed, val;
   MOT_Direction direction=MOT_DIR_FORWARD;
@@ -285,6 +362,9 @@ static void PID_PrintHelp(const CLS1_StdIOType *io) {
   CLS1_SendHelpStr((unsigned char*)"  pos speed <value>", (unsigned char*)"Maximum speed % value\r\n", io->stdOut);
   CLS1_SendHelpStr((unsigned char*)"  fw (p|i|d|w) <value>", (unsigned char*)"Sets P, I, D or anti-Windup line value\r\n", io->stdOut);
   CLS1_SendHelpStr((unsigned char*)"  fw speed <value>", (unsigned char*)"Maximum speed % value\r\n", io->stdOut);
+  CLS1_SendHelpStr((unsigned char*)"  sync (on|off)", (unsigned char*)"Enables or disables wheel synchronization in speed mode\r\n", io->stdOut);
+  CLS1_SendHelpStr((unsigned char*)"  sync (p|i|d|w) <value>", (unsigned char*)"Sets P, I, D or anti-Windup synchronization value\r\n", io->stdOut);
+  CLS1_SendHelpStr((unsigned char*)"  sync speed <value>", (unsigned char*)"Maximum correction % of speed\r\n", io->stdOut);
 }
 
 static void PrintPIDstatus(PID_Config *config, const unsigned char *kindStr, const CLS1_StdIOType *io) {
@@ -339,6 +419,8 @@ static void PID_PrintStatus(const CLS1_StdIOType *io) {
   PrintPIDstatus(&speedRightConfig, (unsigned char*)"speed R", io);
   PrintPIDstatus(&posLeftConfig, (unsigned char*)"pos L", io);
   PrintPIDstatus(&posRightConfig, (unsigned char*)"pos R", io);
+  CLS1_SendStatusStr((unsigned char*)"  sync", PID_Sync.enabled?(unsigned char*)"on\r\n":(unsigned char*)"off\r\n", io->stdOut);
+  PrintPIDstatus(&syncConfig, (unsigned char*)"sync", io);
 }
 
 static uint8_t ParsePidParameter(PID_Config *config, const unsigned char *cmd, bool *handled, const CLS1_StdIOType *io) {
@@ -415,6 +497,15 @@ uint8_t PID_ParseCommand(const unsigned char *cmd, bool *handled, const CLS1_Std
     res = ParsePidParameter(&posRightConfig, cmd+sizeof("pid pos R ")-1, handled, io);
   } else if (UTIL1_strncmp((char*)cmd, (char*)"pid fw ", sizeof("pid fw ")-1)==0) {
     res = ParsePidParameter(&lineFwConfig, cmd+sizeof("pid fw ")-1, handled, io);
+  } else if (UTIL1_strcmp((char*)cmd, (char*)"pid sync on")==0) {
+    PID_Sync.started = FALSE;
+    PID_Sync.enabled = TRUE;
+    *handled = TRUE;
+  } else if (UTIL1_strcmp((char*)cmd, (char*)"pid sync off")==0) {
+    PID_Sync.enabled = FALSE;
+    *handled = TRUE;
+  } else if (UTIL1_strncmp((char*)cmd, (char*)"pid sync ", sizeof("pid sync ")-1)==0) {
+    res = ParsePidParameter(&syncConfig, cmd+sizeof("pid sync ")-1, handled, io);
   }
   return res;
 }
@@ -433,6 +524,9 @@ void PID_Start(void) {
   posLeftConfig.integral = 0;
   posRightConfig.lastError = 0;
   posRightConfig.integral = 0;
+  syncConfig.lastError = 0;
+  syncConfig.integral = 0;
+  PID_Sync.started = FALSE; /* take new reference position */
 }
 
 void PID_Deinit(void) {
@@ -477,5 +571,15 @@ void PID_Init(void) {
   posRightConfig.lastError = posLeftConfig.lastError;
   posRightConfig.integral = posLeftConfig.integral;
   posRightConfig.maxSpeedPercent = posLeftConfig.maxSpeedPercent;
+
+  syncConfig.pFactor100 = 2000; /* 20 steps/sec correction per step difference */
+  syncConfig.iFactor100 = 10;
+  syncConfig.dFactor100 = 0;
+  syncConfig.iAntiWindup = 1000;
+  syncConfig.maxSpeedPercent = 50; /* correction is at most half of the speed */
+  syncConfig.lastError = 0;
+  syncConfig.integral = 0;
+  PID_Sync.enabled = FALSE;
+  PID_Sync.started = FALSE;
 }
 #endif /* PL_CONFIG_HAS_PID */
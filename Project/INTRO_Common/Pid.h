@@ -29,6 +29,20 @@ uint8_t PID_ParseCommand(const unsigned char *cmd, bool *handled, const CLS1_Std
  */
 void PID_Speed(int32_t currSpeed, int32_t setSpeed, bool isLeft);
 
+/*!
+ * \brief Performs PID closed loop calculation for the speed of both wheels, with optional cross-coupling.
+ * If synchronization is enabled, the integrated position difference of the two wheels is fed back into both
+ * speed controllers, so the ratio of the wheel movements matches the ratio of the desired speeds (heading hold).
+ * Equal speeds drive straight, different speeds drive an arc with constant radius.
+ * \param currSpeedL Current speed of left motor
+ * \param currSpeedR Current speed of right motor
+ * \param setSpeedL Desired speed of left motor
+ * \param setSpeedR Desired speed of right motor
+ * \param posL Current position of left wheel
+ * \param posR Current position of right wheel
+ */
+void PID_SpeedSync(int32_t currSpeedL, int32_t currSpeedR, int32_t setSpeedL, int32_t setSpeedR, int32_t posL, int32_t posR);
+
 /*!
  * \brief Performs PID closed loop calculation for the line position
  * \param currPos Current position of wheel
@@ -39,6 +53,35 @@ void PID_Pos(int32_t currPos, int32_t setPos, bool isLeft);
 
 void PID_Line(uint16_t currLine, uint16_t setLine);
 
+/*!
+ * \brief Performs PID closed loop calculation for the line position, with a speed limit different from the configured one.
+ * \param currLine Current line position
+ * \param setLine Desired line position
+ * \param maxSpeedPercent Speed limit to be used, in percent
+ */
+void PID_LineSpeed(uint16_t currLine, uint16_t setLine, uint8_t maxSpeedPercent);
+
+/*!
+ * \brief Performs PID closed loop calculation for the line position, with a feed-forward steering value.
+ * \param currLine Current line position
+ * \param setLine Desired line position
+ * \param maxSpeedPercent Speed limit to be used, in percent
+ * \param feedForward Steering value added to the PID output (PWM difference, positive turns left)
+ */
+void PID_LineFeedForward(uint16_t currLine, uint16_t setLine, uint8_t maxSpeedPercent, int32_t feedForward);
+
+/*!
+ * \brief Returns the configured speed limit for line following.
+ * \return Speed limit in percent
+ */
+uint8_t PID_GetLineMaxSpeedPercent(void);
+
+/*!
+ * \brief Tells if the output of the last line PID calculation has been limited, or the line has been far off the middle.
+ * \return TRUE if the output has been saturated
+ */
+bool PID_LineIsSaturated(void);
+
 /*! \brief Driver re-init and reset */
 void PID_Start(void);
 
@@ -30,6 +30,12 @@
 #if PL_CONFIG_HAS_RTOS
   #include "RTOS.h"
 #endif
+#if PL_CONFIG_HAS_BUS
+  #include "Bus.h"
+#endif
+#if PL_CONFIG_HAS_LOW_POWER
+  #include "LowPower.h"
+#endif
 #if PL_CONFIG_HAS_SHELL
   #include "Shell.h"
 #endif
@@ -69,9 +75,21 @@
 #if PL_CONFIG_HAS_CONFIG_NVM
   #include "NVM_Config.h"
 #endif
+#if PL_CONFIG_HAS_ODOMETRY
+  #include "Odometry.h"
+#endif
 #if PL_CONFIG_HAS_LINE_MAZE
   #include "Maze.h"
 #endif
+#if PL_CONFIG_HAS_LINE_TRACK
+  #include "Track.h"
+#endif
+#if PL_CONFIG_HAS_LINE_JUNCTION
+  #include "Junction.h"
+#endif
+#if PL_CONFIG_HAS_LINE_LAP
+  #include "Lap.h"
+#endif
 #if PL_CONFIG_HAS_LCD
   #include "LCD.h"
 #endif
@@ -83,15 +101,15 @@ void PL_Init(void) {
 #if PL_CONFIG_HAS_EVENTS
   EVNT_Init();
 #endif
+#if PL_CONFIG_HAS_TRIGGER
+  TRG_Init();
+#endif
 #if PL_CONFIG_HAS_TIMER
-  TMR_Init();
+  TMR_Init(); /* uses a trigger */
 #endif
 #if PL_CONFIG_HAS_KEYS
   KEY_Init();
 #endif
-#if PL_CONFIG_HAS_TRIGGER
-  TRG_Init();
-#endif
 #if PL_CONFIG_HAS_BUZZER
   BUZ_Init();
 #endif
@@ -101,6 +119,12 @@ void PL_Init(void) {
 #if PL_CONFIG_HAS_RTOS
   RTOS_Init();
 #endif
+#if PL_CONFIG_HAS_BUS
+  BUS_Init();
+#endif
+#if PL_CONFIG_HAS_LOW_POWER
+  LP_Init();
+#endif
 #if PL_CONFIG_HAS_SHELL
   SHELL_Init();
 #endif
@@ -140,6 +164,18 @@ void PL_Init(void) {
 #if PL_CONFIG_HAS_CONFIG_NVM
   NVMC_Init();
 #endif
+#if PL_CONFIG_HAS_ODOMETRY
+  ODO_Init();
+#endif
+#if PL_CONFIG_HAS_LINE_TRACK
+  TRACK_Init();
+#endif
+#if PL_CONFIG_HAS_LINE_JUNCTION
+  JCT_Init();
+#endif
+#if PL_CONFIG_HAS_LINE_LAP
+  LAP_Init();
+#endif
 #if PL_CONFIG_HAS_LINE_MAZE
   MAZE_Init();
 #endif
@@ -155,6 +191,18 @@ void PL_Deinit(void) {
 #if PL_CONFIG_HAS_LINE_MAZE
   MAZE_Deinit();
 #endif
+#if PL_CONFIG_HAS_LINE_LAP
+  LAP_Deinit();
+#endif
+#if PL_CONFIG_HAS_LINE_JUNCTION
+  JCT_Deinit();
+#endif
+#if PL_CONFIG_HAS_LINE_TRACK
+  TRACK_Deinit();
+#endif
+#if PL_CONFIG_HAS_ODOMETRY
+  ODO_Deinit();
+#endif
 #if PL_CONFIG_HAS_CONFIG_NVM
   NVMC_Deinit();
 #endif
@@ -191,6 +239,12 @@ void PL_Deinit(void) {
 #if PL_CONFIG_HAS_SHELL_QUEUE
   SQUEUE_Deinit();
 #endif
+#if PL_CONFIG_HAS_LOW_POWER
+  LP_Deinit();
+#endif
+#if PL_CONFIG_HAS_BUS
+  BUS_Deinit();
+#endif
 #if PL_CONFIG_HAS_RTOS
   RTOS_Deinit();
 #endif
@@ -200,15 +254,15 @@ void PL_Deinit(void) {
 #if PL_CONFIG_HAS_BUZZER
   BUZ_Deinit();
 #endif
-#if PL_CONFIG_HAS_TRIGGER
-  TRG_Deinit();
-#endif
 #if PL_CONFIG_HAS_KEYS
   KEY_Deinit();
 #endif
 #if PL_CONFIG_HAS_TIMER
   TMR_Deinit();
 #endif
+#if PL_CONFIG_HAS_TRIGGER
+  TRG_Deinit();
+#endif
 #if PL_CONFIG_HAS_EVENTS
   EVNT_Init();
 #endif
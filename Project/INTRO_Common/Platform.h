@@ -62,8 +62,11 @@
 #define PL_CONFIG_HAS_TIMER             (1 && !defined(PL_LOCAL_CONFIG_CONFIG_HAS_TIMER_DISABLED)) /* timer interrupts */
 #define PL_CONFIG_HAS_KEYS              (1 && !defined(PL_LOCAL_CONFIG_HAS_KEYS_DISABLED)) /* support for keys */
 #define PL_CONFIG_HAS_TRIGGER           (1 && !defined(PL_LOCAL_CONFIG_HAS_TRIGGER_DISABLED)) /* support for triggers */
+#define PL_CONFIG_HAS_TRIGGER_TASK      (1 && !defined(PL_LOCAL_CONFIG_HAS_TRIGGER_TASK_DISABLED) && PL_CONFIG_HAS_TRIGGER && PL_CONFIG_HAS_RTOS) /* trigger callbacks run in a task */
 #define PL_CONFIG_HAS_DEBOUNCE          (1 && !defined(PL_LOCAL_CONFIG_HAS_DEBOUNCE_DISABLED)) /* support for debouncing */
 #define PL_CONFIG_HAS_RTOS              (1 && !defined(PL_LOCAL_CONFIG_HAS_RTOS_DISABLED)) /* RTOS support */
+#define PL_CONFIG_HAS_BUS               (1 && !defined(PL_LOCAL_CONFIG_HAS_BUS_DISABLED) && PL_CONFIG_HAS_RTOS) /* data bus between the modules */
+#define PL_CONFIG_HAS_LOW_POWER         (1 && !defined(PL_LOCAL_CONFIG_HAS_LOW_POWER_DISABLED) && PL_CONFIG_HAS_RTOS) /* sleep in the idle task */
 #define PL_CONFIG_HAS_SHELL             (1 && !defined(PL_LOCAL_CONFIG_HAS_SHELL_DISABLED)) /* shell support disabled for now */
 #define PL_CONFIG_HAS_SEGGER_RTT        (1 && !defined(PL_LOCAL_CONFIG_HAS_SEGGER_RTT_DISABLED) && PL_CONFIG_HAS_SHELL) /* using RTT with shell */
 #define PL_CONFIG_HAS_SHELL_QUEUE       (1 && !defined(PL_LOCAL_CONFIG_HAS_SHELL_QUEUE_DISABLED) && PL_CONFIG_HAS_SHELL) /* enable shell queueing */
@@ -93,7 +96,11 @@
 #define PL_CONFIG_HAS_REFLECTANCE       (1 && !defined(PL_LOCAL_CONFIG_HAS_REFLECTANCE_DISABLED) && PL_CONFIG_BOARD_IS_ROBO)
 #define PL_CONFIG_HAS_LINE_FOLLOW       (1 && !defined(PL_LOCAL_CONFIG_HAS_LINE_FOLLOW_DISABLED) && PL_CONFIG_HAS_DRIVE)
 #define PL_CONFIG_HAS_TURN              (1 && !defined(PL_LOCAL_CONFIG_HAS_TURN_DISABLED) && PL_CONFIG_HAS_QUADRATURE)
+#define PL_CONFIG_HAS_ODOMETRY          (1 && !defined(PL_LOCAL_CONFIG_HAS_ODOMETRY_DISABLED) && PL_CONFIG_HAS_DRIVE)
 #define PL_CONFIG_HAS_LINE_MAZE         (1 && !defined(PL_LOCAL_CONFIG_HAS_LINE_MAZE_DISABLED) && PL_CONFIG_HAS_LINE_FOLLOW)
+#define PL_CONFIG_HAS_LINE_TRACK        (1 && !defined(PL_LOCAL_CONFIG_HAS_LINE_TRACK_DISABLED) && PL_CONFIG_HAS_LINE_FOLLOW && PL_CONFIG_HAS_ODOMETRY && PL_CONFIG_HAS_REFLECTANCE) /* track learning */
+#define PL_CONFIG_HAS_LINE_JUNCTION     (1 && !defined(PL_LOCAL_CONFIG_HAS_LINE_JUNCTION_DISABLED) && PL_CONFIG_HAS_LINE_FOLLOW && PL_CONFIG_HAS_ODOMETRY && PL_CONFIG_HAS_REFLECTANCE) /* junction detection */
+#define PL_CONFIG_HAS_LINE_LAP          (1 && !defined(PL_LOCAL_CONFIG_HAS_LINE_LAP_DISABLED) && PL_CONFIG_HAS_LINE_JUNCTION && PL_CONFIG_HAS_MOTOR_TACHO) /* lap timing */
 
 /*!
  * \brief Driver de-initialization
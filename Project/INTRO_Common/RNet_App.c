@@ -38,15 +38,76 @@ typedef enum {
 
 static RNETA_State appState = RNETA_NONE;
 
-static int32_t mySpeed;
-static int32_t deltaTurn;
+#if PL_CONFIG_BOARD_IS_ROBO
+static int32_t mySpeed;   /* forward speed requested by the remote */
+static int32_t deltaTurn; /* turn requested by the remote, positive is to the right */
 
+#if PL_CONFIG_HAS_ODOMETRY
+  #define RNETA_SPEED_STEP   100  /* mm/s, the drive limits acceleration and jerk */
+  #define RNETA_SPEED_MAX    600
+  #define RNETA_TURN_STEP    30   /* deg/s */
+  #define RNETA_TURN_MAX     180
+#else
+  #define RNETA_SPEED_STEP   1000 /* steps/s */
+  #define RNETA_SPEED_MAX    10000
+  #define RNETA_TURN_STEP    300
+  #define RNETA_TURN_MAX     2000
+#endif
+
+/* passes the speed and turn of the remote to the drive */
+static void RNETA_DriveRemote(void) {
+#if PL_CONFIG_HAS_ODOMETRY
+  (void)DRV_SetTwist(mySpeed, -deltaTurn); /* angular velocity is counter clockwise */
+  if (DRV_GetMode()!=DRV_MODE_TWIST) {
+    (void)DRV_SetMode(DRV_MODE_TWIST);
+  }
+#else
+  (void)DRV_SetMode(DRV_MODE_SPEED);
+  (void)DRV_SetSpeed(mySpeed+deltaTurn, mySpeed-deltaTurn);
+#endif
+}
+#endif
 
 
 RNWK_ShortAddrType RNETA_GetDestAddr(void) {
   return APP_dstAddr;
 }
 
+#if !PL_CONFIG_BOARD_IS_ROBO && PL_CONFIG_HAS_SHELL
+static uint32_t GetValue32LE(const uint8_t *p) {
+  return (uint32_t)p[0]|((uint32_t)p[1]<<8)|((uint32_t)p[2]<<16)|((uint32_t)p[3]<<24);
+}
+
+/* prints a lap result or the sector splits sent by the robot, times in milli seconds */
+static void PrintLapMessage(RAPP_MSG_Type type, const uint8_t *data, CLS1_ConstStdIOTypePtr io) {
+  uint8_t buf[24];
+  uint8_t i;
+
+  CLS1_SendStr((unsigned char*)"Lap ", io->stdOut);
+  CLS1_SendNum8u(data[0], io->stdOut);
+  if (type==RAPP_MSG_TYPE_LAP_RESULT) {
+    CLS1_SendStr((unsigned char*)": ", io->stdOut);
+    UTIL1_Num32uToStr(buf, sizeof(buf), GetValue32LE(&data[2])/1000);
+    CLS1_SendStr(buf, io->stdOut);
+    CLS1_SendStr((unsigned char*)" ms, speed avg ", io->stdOut);
+    CLS1_SendNum16u((uint16_t)(data[6]|(data[7]<<8)), io->stdOut);
+    CLS1_SendStr((unsigned char*)" peak ", io->stdOut);
+    CLS1_SendNum16u((uint16_t)(data[8]|(data[9]<<8)), io->stdOut);
+    CLS1_SendStr((unsigned char*)", off line ", io->stdOut);
+    CLS1_SendNum16u((uint16_t)(data[10]|(data[11]<<8)), io->stdOut);
+  } else { /* sector splits */
+    CLS1_SendStr((unsigned char*)" sectors:", io->stdOut);
+    for(i=0;i<data[1];i++) {
+      UTIL1_strcpy(buf, sizeof(buf), (unsigned char*)" ");
+      UTIL1_strcatNum32u(buf, sizeof(buf), GetValue32LE(&data[2+i*4])/1000);
+      UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" ms");
+      CLS1_SendStr(buf, io->stdOut);
+    }
+  }
+  CLS1_SendStr((unsigned char*)"\r\n", io->stdOut);
+}
+#endif
+
 static uint8_t HandleDataRxMessage(RAPP_MSG_Type type, uint8_t size, uint8_t *data, RNWK_ShortAddrType srcAddr, bool *handled, RPHY_PacketDesc *packet) {
 #if PL_CONFIG_HAS_SHELL
   uint8_t buf[32];
@@ -76,23 +137,32 @@ static uint8_t HandleDataRxMessage(RAPP_MSG_Type type, uint8_t size, uint8_t *da
 #endif /* PL_HAS_SHELL */      
       return ERR_OK;
       break;
+#if !PL_CONFIG_BOARD_IS_ROBO
+    case RAPP_MSG_TYPE_LAP_RESULT: /* lap timing of the robot */
+    case RAPP_MSG_TYPE_LAP_SECTORS:
+      *handled = TRUE;
+#if PL_CONFIG_HAS_SHELL
+      if (size>=2 && size>=(type==RAPP_MSG_TYPE_LAP_RESULT?12:2+data[1]*4)) {
+        PrintLapMessage(type, data, io);
+      }
+#endif
+      break;
+#endif
 #if PL_CONFIG_BOARD_IS_ROBO
     case RAPP_MSG_TYPE_STOPP_ALL:
     	*handled = TRUE;
     	val = *data; /* get data value */
     	mySpeed = 0;
     	deltaTurn = 0;
-    	DRV_SetSpeed(0,0);
-		DRV_SetMode(DRV_MODE_SPEED);
+    	RNETA_DriveRemote();
     	CLS1_SendStr((unsigned char*)"MSG: Stopp all!", io->stdOut);
     	break;
     case RAPP_MSG_TYPE_SPEED_INCREASE:
     	*handled = TRUE;
 		val = *data; /* get data value */
-    	if(mySpeed < 10000){
-    		mySpeed += 1000;
-    		DRV_SetMode(DRV_MODE_SPEED);
-    		DRV_SetSpeed(mySpeed+deltaTurn, mySpeed-deltaTurn);
+    	if(mySpeed < RNETA_SPEED_MAX){
+    		mySpeed += RNETA_SPEED_STEP;
+    		RNETA_DriveRemote();
     	}
     	CLS1_SendStr((unsigned char*)"MSG: Speed increase: ", io->stdOut);
     	CLS1_SendNum16s((int16_t)mySpeed, io->stdOut);
@@ -100,10 +170,9 @@ static uint8_t HandleDataRxMessage(RAPP_MSG_Type type, uint8_t size, uint8_t *da
     case RAPP_MSG_TYPE_SPEED_DECREASE:
     	*handled = TRUE;
 		val = *data; /* get data value */
-    	if(mySpeed > -10000){
-			mySpeed -= 1000;
-			DRV_SetMode(DRV_MODE_SPEED);
-			DRV_SetSpeed(mySpeed+deltaTurn, mySpeed-deltaTurn);
+    	if(mySpeed > -RNETA_SPEED_MAX){
+			mySpeed -= RNETA_SPEED_STEP;
+			RNETA_DriveRemote();
 		}
     	CLS1_SendStr((unsigned char*)"MSG: Speed decrease: ", io->stdOut);
     	CLS1_SendNum16s((int16_t)mySpeed, io->stdOut);
@@ -111,11 +180,10 @@ static uint8_t HandleDataRxMessage(RAPP_MSG_Type type, uint8_t size, uint8_t *da
     case RAPP_MSG_TYPE_TURN_LEFTER:
     	*handled = TRUE;
 		val = *data; /* get data value */
-    	if(deltaTurn > -2000)
+    	if(deltaTurn > -RNETA_TURN_MAX)
     	{
-    		deltaTurn -= 300;
-    		DRV_SetMode(DRV_MODE_SPEED);
-    		DRV_SetSpeed(mySpeed+deltaTurn, mySpeed-deltaTurn);
+    		deltaTurn -= RNETA_TURN_STEP;
+    		RNETA_DriveRemote();
     	}
     	CLS1_SendStr((unsigned char*)"MSG: Turn lefter: ", io->stdOut);
 		CLS1_SendNum16s((int16_t)deltaTurn, io->stdOut);
@@ -123,11 +191,10 @@ static uint8_t HandleDataRxMessage(RAPP_MSG_Type type, uint8_t size, uint8_t *da
     case RAPP_MSG_TYPE_TURN_RIGHTER:
     	*handled = TRUE;
 		val = *data; /* get data value */
-    	if(deltaTurn < 2000)
+    	if(deltaTurn < RNETA_TURN_MAX)
 		{
-			deltaTurn += 300;
-			DRV_SetMode(DRV_MODE_SPEED);
-			DRV_SetSpeed(mySpeed+deltaTurn, mySpeed-deltaTurn);
+			deltaTurn += RNETA_TURN_STEP;
+			RNETA_DriveRemote();
 		}
     	CLS1_SendStr((unsigned char*)"MSG: Turn righter: ", io->stdOut);
 		CLS1_SendNum16s((int16_t)deltaTurn, io->stdOut);
@@ -228,9 +295,10 @@ void RNETA_Deinit(void) {
 }
 
 void RNETA_Init(void) {
-
+#if PL_CONFIG_BOARD_IS_ROBO
   mySpeed = 0;
   deltaTurn = 0;
+#endif
 
   RNET1_Init(); /* initialize stack */
   if (RAPP_SetMessageHandlerTable(handlerTable)!=ERR_OK) { /* assign application message handler */
@@ -27,7 +27,9 @@ typedef enum {
   RAPP_MSG_TYPE_TURN_LEFTER = 0x13,
   RAPP_MSG_TYPE_TURN_RIGHTER = 0x14,
   RAPP_MSG_TYPE_REMOTE_ENABLE = 0x15,
-  RAPP_MSG_TYPE_REMOTE_DISABLE = 0x16
+  RAPP_MSG_TYPE_REMOTE_DISABLE = 0x16,
+  RAPP_MSG_TYPE_LAP_RESULT = 0x17,  /* lap number, number of sectors, lap time (us), average and peak speed (steps/s), off line events */
+  RAPP_MSG_TYPE_LAP_SECTORS = 0x18  /* lap number, number of sectors, split times (us) */
   /* \todo extend with your own messages */
 } RAPP_MSG_Type;
 
@@ -15,6 +15,19 @@
 #include "Motor.h"
 #include "Reflectance.h"
 
+/* The tick timer is the SysTick on all boards (the FRTOS1 component does not use the LPTMR): it counts down to 0 and reloads. */
+uint32_t RTOS_GetTickTimerCount(void) {
+  return SYST_RVR-SYST_CVR;
+}
+
+uint32_t RTOS_GetTickTimerPeriod(void) {
+  return SYST_RVR+1;
+}
+
+bool RTOS_IsTickPending(void) {
+  return (SCB_ICSR&SCB_ICSR_PENDSTSET_MASK)!=0;
+}
+
 static void AppTask(void* param) {
   const int *whichLED = (int*)param;
 
@@ -20,6 +20,25 @@ void RTOS_Deinit(void);
 /*! \brief Creates all application tasks */
 void RTOS_Run(void);
 
+/*!
+ * \brief Returns the counter of the timer running the tick, the SysTick.
+ * \return Timer counts since the last tick, counting up from 0 to RTOS_GetTickTimerPeriod()-1
+ */
+uint32_t RTOS_GetTickTimerCount(void);
+
+/*!
+ * \brief Returns the period of the tick timer.
+ * \return Timer counts per tick
+ */
+uint32_t RTOS_GetTickTimerPeriod(void);
+
+/*!
+ * \brief Tells if the tick timer has expired, but the tick interrupt has not been served yet.
+ * Then RTOS_GetTickTimerCount() has already restarted from 0.
+ * \return TRUE if the tick interrupt is pending
+ */
+bool RTOS_IsTickPending(void);
+
 #endif /* PL_CONFIG_HAS_RTOS */
 
 #endif /* RTOS_H_ */
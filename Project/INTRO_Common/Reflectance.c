@@ -23,12 +23,21 @@
 #include "Application.h"
 #include "Event.h"
 #include "Shell.h"
+#if PL_CONFIG_HAS_LINE_FOLLOW
+  #include "LineFollow.h"
+#endif
 #if PL_CONFIG_HAS_BUZZER
   #include "Buzzer.h"
 #endif
 #if PL_CONFIG_HAS_CONFIG_NVM
   #include "NVM_Config.h"
 #endif
+#if PL_CONFIG_HAS_LINE_JUNCTION
+  #include "Junction.h"
+#endif
+#if PL_CONFIG_HAS_BUS
+  #include "Bus.h"
+#endif
 
 #define REF_NOF_SENSORS       6 /* number of sensors */
 #define REF_SENSOR1_IS_LEFT   1 /* sensor number one is on the left side */
@@ -352,6 +361,25 @@ static REF_LineKind ReadLineKind(SensorTimeType val[REF_NOF_SENSORS]) {
 }
 #endif
 
+#if PL_CONFIG_HAS_LINE_JUNCTION
+/* returns the sensors seeing a line, with bit 0 for the leftmost sensor */
+static uint8_t ReadLineMask(SensorTimeType val[REF_NOF_SENSORS]) {
+  uint8_t mask = 0;
+  int i;
+
+  for(i=0;i<REF_NOF_SENSORS;i++) {
+    if (val[i]>=REF_MIN_LINE_VAL) {
+#if REF_SENSOR1_IS_LEFT
+      mask |= 1<<i;
+#else
+      mask |= 1<<(REF_NOF_SENSORS-1-i);
+#endif
+    }
+  }
+  return mask;
+}
+#endif
+
 #if PL_CONFIG_HAS_LINE_FOLLOW
 static REF_LineKind refLineKind = REF_LINE_NONE;
 
@@ -361,10 +389,25 @@ REF_LineKind REF_GetLineKind(void) {
 #endif
 
 static void REF_Measure(void) {
+#if PL_CONFIG_HAS_BUS && PL_CONFIG_HAS_LINE_FOLLOW
+  BUS_Sample *sample;
+#endif
+
   ReadCalibrated(SensorCalibrated, SensorRaw);
   refCenterLineVal = ReadLine(SensorCalibrated, SensorRaw, REF_USE_WHITE_LINE);
 #if PL_CONFIG_HAS_LINE_FOLLOW
   refLineKind = ReadLineKind(SensorCalibrated);
+#if PL_CONFIG_HAS_LINE_JUNCTION
+  JCT_AddFrame(ReadLineMask(SensorCalibrated), refLineKind);
+#endif
+#if PL_CONFIG_HAS_BUS
+  sample = BUS_Claim(BUS_TOPIC_LINE);
+  sample->u.line.value = (uint16_t)refCenterLineVal;
+  sample->u.line.kind = (uint8_t)refLineKind;
+  BUS_Publish(BUS_TOPIC_LINE); /* wakes up the line following */
+#else
+  LF_SensorFrameReady();
+#endif
 #endif
 }
 
@@ -601,7 +644,7 @@ static void ReflTask (void *pvParameters) {
   (void)pvParameters; /* not used */
   for(;;) {
     REF_StateMachine();
-    FRTOS1_vTaskDelay(50/portTICK_PERIOD_MS);
+    FRTOS1_vTaskDelay(REF_MEASURE_PERIOD_MS/portTICK_PERIOD_MS);
   }
 }
 
@@ -13,6 +13,7 @@
 #if PL_CONFIG_HAS_REFLECTANCE
 
 #define REF_NOF_SENSORS 6
+#define REF_MEASURE_PERIOD_MS  50 /* period of the sensor measurement */
 #define REF_MIDDLE_LINE_VALUE  ((REF_NOF_SENSORS+1)*1000/2)
 #define REF_MAX_LINE_VALUE     ((REF_NOF_SENSORS-1)*1000) /* maximum value for REF_GetLine() */
 
@@ -27,6 +28,8 @@ typedef enum {
 
 REF_LineKind REF_GetLineKind(void);
 
+unsigned char *REF_LineKindStr(REF_LineKind line);
+
 void REF_GetSensorValues(uint16_t *values, int nofValues);
 
 #if PL_CONFIG_HAS_SHELL
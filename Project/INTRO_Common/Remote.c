@@ -141,6 +141,31 @@ static void RemoteTask (void *pvParameters) {
 #endif
 
 #if PL_CONFIG_HAS_MOTOR
+#if PL_CONFIG_HAS_DRIVE && PL_CONFIG_HAS_ODOMETRY
+#define REMOTE_TWIST_MAX_MM_SEC   500 /* linear velocity at full joystick deflection */
+#define REMOTE_TWIST_MAX_DEG_SEC  180 /* angular velocity at full joystick deflection */
+
+/* maps the joystick to linear and angular velocity, the drive limits acceleration and jerk */
+static void REMOTE_HandleMotorMsg(int16_t speedVal, int16_t directionVal, int16_t z) {
+  #define MIN_VALUE  100 /* values below this value are ignored */
+
+  if (!REMOTE_isOn) {
+    return;
+  }
+  if (z<-900) { /* have a way to stop motor: turn FRDM USB port side up or down */
+    (void)DRV_SetTwist(0, 0);
+    return;
+  }
+  if (speedVal<MIN_VALUE && speedVal>-MIN_VALUE) {
+    speedVal = 0;
+  }
+  if (directionVal<MIN_VALUE && directionVal>-MIN_VALUE) {
+    directionVal = 0;
+  }
+  /* values are -1000...+1000, positive direction is to the right, positive angular velocity counter clockwise */
+  (void)DRV_SetTwist((int32_t)speedVal*REMOTE_TWIST_MAX_MM_SEC/1000, -(int32_t)directionVal*REMOTE_TWIST_MAX_DEG_SEC/1000);
+}
+#else
 static void REMOTE_HandleMotorMsg(int16_t speedVal, int16_t directionVal, int16_t z) {
   #define SCALE_DOWN 30
   #define MIN_VALUE  250 /* values below this value are ignored */
@@ -204,6 +229,7 @@ static void REMOTE_HandleMotorMsg(int16_t speedVal, int16_t directionVal, int16_
 #endif
   }
 }
+#endif /* PL_CONFIG_HAS_DRIVE && PL_CONFIG_HAS_ODOMETRY */
 #endif
 
 #if PL_CONFIG_HAS_MOTOR
@@ -282,12 +308,21 @@ uint8_t REMOTE_HandleRemoteRxMessage(RAPP_MSG_Type type, uint8_t size, uint8_t *
       if (val=='F') { /* F button, disable remote */
         SHELL_ParseCmd((unsigned char*)"buzzer buz 300 500");
         REMOTE_SetOnOff(FALSE);
+#if PL_CONFIG_HAS_ODOMETRY
+        (void)DRV_SetTwist(0, 0); /* turn off motors */
+#else
         DRV_SetSpeed(0,0); /* turn off motors */
+#endif
         SHELL_SendString("Remote OFF\r\n");
       } else if (val=='G') { /* center joystick button: enable remote */
         SHELL_ParseCmd((unsigned char*)"buzzer buz 300 1000");
         REMOTE_SetOnOff(TRUE);
+#if PL_CONFIG_HAS_ODOMETRY
+        (void)DRV_SetTwist(0, 0);
+        DRV_SetMode(DRV_MODE_TWIST);
+#else
         DRV_SetMode(DRV_MODE_SPEED);
+#endif
         SHELL_SendString("Remote ON\r\n");
       } else if (val=='C') { /* red 'C' button */
         /*! \todo add functionality */
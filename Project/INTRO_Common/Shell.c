@@ -17,6 +17,9 @@
 #if PL_CONFIG_HAS_BLUETOOTH
   #include "BT1.h"
 #endif
+#if PL_CONFIG_HAS_TRIGGER
+  #include "Trigger.h"
+#endif
 #if PL_CONFIG_HAS_BUZZER
   #include "Buzzer.h"
 #endif
@@ -57,9 +60,21 @@
 #if PL_CONFIG_HAS_TURN
   #include "Turn.h"
 #endif
+#if PL_CONFIG_HAS_ODOMETRY
+  #include "Odometry.h"
+#endif
 #if PL_CONFIG_HAS_LINE_FOLLOW
   #include "LineFollow.h"
 #endif
+#if PL_CONFIG_HAS_LINE_TRACK
+  #include "Track.h"
+#endif
+#if PL_CONFIG_HAS_LINE_JUNCTION
+  #include "Junction.h"
+#endif
+#if PL_CONFIG_HAS_LINE_LAP
+  #include "Lap.h"
+#endif
 #if PL_CONFIG_HAS_RADIO
   #include "RApp.h"
   #include "RNet_App.h"
@@ -74,6 +89,12 @@
 #if PL_CONFIG_HAS_LINE_MAZE
   #include "Maze.h"
 #endif
+#if PL_CONFIG_HAS_BUS
+  #include "Bus.h"
+#endif
+#if PL_CONFIG_HAS_LOW_POWER
+  #include "LowPower.h"
+#endif
 #if PL_CONFIG_HAS_USB_CDC
   #include "CDC1.h"
 #endif
@@ -168,6 +189,9 @@ static const CLS1_ParseCommandCallback CmdParserTable[] =
 #if defined(BT1_PARSE_COMMAND_ENABLED) && BT1_PARSE_COMMAND_ENABLED
   BT1_ParseCommand,
 #endif
+#if PL_CONFIG_HAS_TRIGGER
+  TRG_ParseCommand,
+#endif
 #if PL_CONFIG_HAS_BUZZER
   BUZ_ParseCommand,
 #endif
@@ -207,9 +231,21 @@ static const CLS1_ParseCommandCallback CmdParserTable[] =
 #if PL_CONFIG_HAS_TURN
   TURN_ParseCommand,
 #endif
+#if PL_CONFIG_HAS_ODOMETRY
+  ODO_ParseCommand,
+#endif
 #if PL_CONFIG_HAS_LINE_FOLLOW
   LF_ParseCommand,
 #endif
+#if PL_CONFIG_HAS_LINE_TRACK
+  TRACK_ParseCommand,
+#endif
+#if PL_CONFIG_HAS_LINE_JUNCTION
+  JCT_ParseCommand,
+#endif
+#if PL_CONFIG_HAS_LINE_LAP
+  LAP_ParseCommand,
+#endif
 #if PL_CONFIG_HAS_RADIO
 #if RNET1_PARSE_COMMAND_ENABLED
   RNET1_ParseCommand,
@@ -221,6 +257,12 @@ static const CLS1_ParseCommandCallback CmdParserTable[] =
 #endif
 #if PL_CONFIG_HAS_LINE_MAZE
   MAZE_ParseCommand,
+#endif
+#if PL_CONFIG_HAS_BUS
+  BUS_ParseCommand,
+#endif
+#if PL_CONFIG_HAS_LOW_POWER
+  LP_ParseCommand,
 #endif
   NULL /* Sentinel */
 };
@@ -340,6 +382,13 @@ static void ShellTask(void *pvParameters) {
     }
 #endif /* PL_CONFIG_SQUEUE_SINGLE_CHAR */
 #endif /* PL_CONFIG_HAS_SHELL_QUEUE */
+#if PL_CONFIG_HAS_LINE_FOLLOW
+	#if SHELL_HANDLER_ARRAY
+    LF_FlushLog(ios[0].stdio);
+	#else
+    LF_FlushLog(CLS1_GetStdio());
+	#endif
+#endif
 
 //#if RNET_CONFIG_REMOTE_STDIO		// Lab 34.3 Remote STDIo Kevin
 //    RSTDIO_Print(ioRemote); // dispatch incoming messages and send them to local stan
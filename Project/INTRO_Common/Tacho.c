@@ -17,6 +17,9 @@
 #include "UTIL1.h"
 #include "FRTOS1.h"
 #include "Timer.h"
+#if PL_CONFIG_HAS_BUS
+  #include "Bus.h"
+#endif
 
 #define TACHO_SAMPLE_PERIOD_MS (1)
   /*!< \todo speed sample period in ms. Make sure that speed is sampled at the given rate. */
@@ -31,6 +34,8 @@ static volatile uint8_t TACHO_PosHistory_Index = 0;
 
 static int32_t TACHO_currLeftSpeed = 0, TACHO_currRightSpeed = 0;
   /*!< current speed for each wheel */
+static bool TACHO_isSampling = FALSE;
+  /*!< if TACHO_Sample() gets called from the timer interrupt */
 
 int32_t TACHO_GetSpeed(bool isLeft) {
   if (isLeft) {
@@ -52,6 +57,9 @@ void TACHO_CalcSpeed(void) {
   int32_t deltaLeft, deltaRight, newLeft, newRight, oldLeft, oldRight;
   int32_t speedLeft, speedRight;
   bool negLeft, negRight;
+#if PL_CONFIG_HAS_BUS
+  BUS_Sample *sample;
+#endif
 
   EnterCritical();
   oldLeft = (int32_t)TACHO_LeftPosHistory[TACHO_PosHistory_Index]; /* oldest left entry */
@@ -91,6 +99,14 @@ void TACHO_CalcSpeed(void) {
   }
   TACHO_currLeftSpeed = -speedLeft; /* store current speed in global variable */
   TACHO_currRightSpeed = -speedRight; /* store current speed in global variable */
+#if PL_CONFIG_HAS_BUS
+  sample = BUS_Claim(BUS_TOPIC_WHEELS);
+  sample->u.wheels.speedLeft = TACHO_currLeftSpeed;
+  sample->u.wheels.speedRight = TACHO_currRightSpeed;
+  sample->u.wheels.posLeft = newLeft;
+  sample->u.wheels.posRight = newRight;
+  BUS_Publish(BUS_TOPIC_WHEELS);
+#endif
 }
 
 void TACHO_Sample(void) {
@@ -111,6 +127,36 @@ void TACHO_Sample(void) {
   }
 }
 
+/* fills the history with the current position, so the speed is 0 until new samples come in */
+static void TACHO_ResetHistory(void) {
+  Q4CLeft_QuadCntrType left, right;
+  uint8_t i;
+
+  EnterCritical();
+  left = Q4CLeft_GetPos();
+  right = Q4CRight_GetPos();
+  for(i=0;i<NOF_HISTORY;i++) {
+    TACHO_LeftPosHistory[i] = left;
+    TACHO_RightPosHistory[i] = right;
+  }
+  TACHO_PosHistory_Index = 0;
+  ExitCritical();
+}
+
+void TACHO_SetSampling(bool on) {
+  if (on==TACHO_isSampling) {
+    return;
+  }
+  TACHO_isSampling = on;
+  if (on) {
+    TACHO_ResetHistory(); /* do not measure the speed from the position before the pause */
+    TMR_RequestSampling();
+  } else {
+    TMR_ReleaseSampling();
+    TACHO_ResetHistory(); /* standing still */
+  }
+}
+
 #if PL_CONFIG_HAS_SHELL
 /*!
  * \brief Prints the system low power status
@@ -149,12 +195,14 @@ uint8_t TACHO_ParseCommand(const unsigned char *cmd, bool *handled, const CLS1_S
 #endif /* PL_HAS_SHELL */
 
 void TACHO_Deinit(void) {
+  TACHO_SetSampling(FALSE);
 }
 
 void TACHO_Init(void) {
   TACHO_currLeftSpeed = 0;
   TACHO_currRightSpeed = 0;
   TACHO_PosHistory_Index = 0;
+  TACHO_isSampling = FALSE; /* the drive starts the sampling with TACHO_SetSampling() when it drives the wheels */
 }
 
 #endif /* PL_CONFIG_HAS_MOTOR_TACHO */
@@ -29,6 +29,12 @@ void TACHO_CalcSpeed(void);
  */
 void TACHO_Sample(void);
 
+/*!
+ * \brief Starts or stops the sampling with the timer interrupt. Without sampling, the speed is 0.
+ * \param on TRUE while the wheels are driven or still moving
+ */
+void TACHO_SetSampling(bool on);
+
 #if PL_CONFIG_HAS_SHELL
 #include "CLS1.h"
 /*!
@@ -4,6 +4,8 @@
  * \author Erich Styger, erich.styger@hslu.ch
  *
  * This module implements the driver for all our timers.
+ * The timer interrupt only samples while a module has requested it with TMR_RequestSampling(),
+ * the LED heartbeat runs with a trigger, so nothing depends on an unconditional 1 ms interrupt.
   */
 
 #include "Platform.h"
@@ -19,31 +21,98 @@
 #if PL_CONFIG_HAS_MOTOR_TACHO
   #include "Tacho.h"
 #endif
+#include "CS1.h"
 
+#define TMR_CONFIG_CONTROL_TI1  (1 && PL_CONFIG_HAS_TRIGGER)
+  /*!< 1: TI1 only runs while sampling is requested. Needs the Enable() and Disable() methods of the TI1 component.
+   * Without triggers the heartbeat is counted in TMR_OnInterrupt(), so TI1 keeps running. */
+#if TMR_CONFIG_CONTROL_TI1
+  #include "TI1.h"
+#endif
 
+#define TMR_HEARTBEAT_MS  1000 /*!< period of the LED heartbeat */
 
+static volatile uint8_t TMR_nofSamplingRequests = 0; /*!< number of modules which need TMR_OnInterrupt() */
+#if PL_CONFIG_HAS_TRIGGER
+static TRG_Handle TMR_HeartbeatTrigger = TRG_NO_TRIGGER;
 
-void TMR_OnInterrupt(void) {
-  /* this one gets called from an interrupt!!!! */
+static void TMR_OnHeartbeat(void *data) {
+  (void)data;
+  EVNT_SetEvent(EVNT_LED_HEARTBEAT);
+  (void)TRG_SetTrigger(TMR_HeartbeatTrigger, TMR_HEARTBEAT_MS/TRG_TICKS_MS, TMR_OnHeartbeat, NULL);
+}
+#endif
 
-	//EVNT_SetEvent(EVNT_TRIGGER_TICK);
+void TMR_RequestSampling(void) {
+  CS1_CriticalVariable()
 
-	static uint16_t counter = 0;
+  CS1_EnterCritical();
+  TMR_nofSamplingRequests++;
+#if TMR_CONFIG_CONTROL_TI1
+  if (TMR_nofSamplingRequests==1) {
+    (void)TI1_Enable();
+  }
+#endif
+  CS1_ExitCritical();
+}
+
+void TMR_ReleaseSampling(void) {
+  CS1_CriticalVariable()
 
-	counter++;
+  CS1_EnterCritical();
+  if (TMR_nofSamplingRequests!=0) {
+    TMR_nofSamplingRequests--;
+#if TMR_CONFIG_CONTROL_TI1
+    if (TMR_nofSamplingRequests==0) {
+      (void)TI1_Disable();
+    }
+#endif
+  }
+  CS1_ExitCritical();
+}
 
-	if(counter>=1000){
-		counter = 0;
+bool TMR_IsSampling(void) {
+  return TMR_nofSamplingRequests!=0;
+}
 
-		EVNT_SetEvent(EVNT_LED_HEARTBEAT);
-	}
+void TMR_OnInterrupt(void) {
+  /* this one gets called from an interrupt!!!! */
+#if !PL_CONFIG_HAS_TRIGGER
+  static uint16_t counter = 0;
 
+  counter++;
+  if (counter>=TMR_HEARTBEAT_MS/TMR_TICK_MS) {
+    counter = 0;
+    EVNT_SetEvent(EVNT_LED_HEARTBEAT);
+  }
+#endif
+  if (TMR_nofSamplingRequests==0) {
+    return; /* nobody needs the samples */
+  }
+#if PL_CONFIG_HAS_MOTOR_TACHO
+  TACHO_Sample();
+#endif
 }
 
 void TMR_Init(void) {
+  TMR_nofSamplingRequests = 0;
+#if TMR_CONFIG_CONTROL_TI1
+  (void)TI1_Disable(); /* until somebody requests sampling */
+#endif
+#if PL_CONFIG_HAS_TRIGGER
+  TMR_HeartbeatTrigger = TRG_AllocTrigger();
+  if (TMR_HeartbeatTrigger==TRG_NO_TRIGGER) {
+    for(;;){} /* no free trigger? */
+  }
+  (void)TRG_SetTrigger(TMR_HeartbeatTrigger, TMR_HEARTBEAT_MS/TRG_TICKS_MS, TMR_OnHeartbeat, NULL);
+#endif
 }
 
 void TMR_Deinit(void) {
+#if PL_CONFIG_HAS_TRIGGER
+  TRG_FreeTrigger(TMR_HeartbeatTrigger);
+  TMR_HeartbeatTrigger = TRG_NO_TRIGGER;
+#endif
 }
 
 #endif /* PL_CONFIG_HAS_TIMER*/
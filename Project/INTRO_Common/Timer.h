@@ -20,6 +20,18 @@
 /*! \brief Function called from timer interrupt every TMR_TICK_MS. */
 void TMR_OnInterrupt(void);
 
+/*! \brief Requests the periodic sampling in TMR_OnInterrupt(), e.g. for the tacho. */
+void TMR_RequestSampling(void);
+
+/*! \brief Releases a request of TMR_RequestSampling(). */
+void TMR_ReleaseSampling(void);
+
+/*!
+ * \brief Tells if the periodic sampling is needed, then the timer has to keep running in low power mode.
+ * \return TRUE if a module has requested the sampling
+ */
+bool TMR_IsSampling(void);
+
 /*! \brief Timer driver initialization */
 void TMR_Init(void);
 
@@ -0,0 +1,484 @@
+/**
+ * \file
+ * \brief Implementation of the track learning module.
+ *
+ * The track is stored in a fixed size buffer with one entry for every 20 mm driven along the line.
+ * Each entry holds the curvature, measured with the heading change of the odometry, and the line events seen (gaps, side lines).
+ * At the end of the recording lap a speed plan is calculated: the speed in each segment is limited by the lateral acceleration,
+ * and a backward pass makes sure the robot can brake in time for the next curve.
+ * On a replay lap the position on the track is the distance driven since the start of the lap, corrected with the line events.
+ */
+
+#include "Platform.h"
+#if PL_CONFIG_HAS_LINE_TRACK
+#include "Track.h"
+#include "Odometry.h"
+#include "FRTOS1.h"
+#include "UTIL1.h"
+#include "Util.h"
+#if PL_CONFIG_HAS_SHELL
+  #include "CLS1.h"
+#endif
+#if PL_CONFIG_HAS_CONFIG_NVM
+  #include "NVM_Config.h"
+#endif
+
+#define TRACK_SEGMENT_MM         20     /* length of a profile entry */
+#define TRACK_SEGMENT_UM         (TRACK_SEGMENT_MM*1000)
+#define TRACK_MAX_SEGMENTS       256    /* number of profile entries, 5.12 m of track */
+#define TRACK_MAX_HEADING_STEP   0x0800 /* about 11 degree: a bigger heading change between two updates means we have turned on the spot */
+#define TRACK_MAX_CURV           20000  /* 1/km, 50 mm radius */
+#define TRACK_FF_LOOKAHEAD       1      /* number of entries to look ahead for the feed-forward, compensates the motor delay */
+#define TRACK_SNAP_WINDOW        5      /* number of entries around the position to search for a recorded line event */
+#define TRACK_MAX_LAT_ACCEL      4000   /* upper limit for the lateral acceleration, keeps the speed calculation in 32bit */
+#define TRACK_MAX_SPEED          2550   /* upper limit for the speed, fits into the profile entry */
+#define TRACK_PROFILE_MAGIC      0x5452 /* 'TR', marks a valid profile in NVM */
+
+#define TRACK_FLAG_GAP    (1<<0)  /* no line seen in this segment */
+#define TRACK_FLAG_MARK   (1<<1)  /* side line or intersection seen in this segment */
+
+typedef struct {
+  int16_t curv;   /* curvature in 1/km, positive is to the left */
+  uint8_t flags;  /* TRACK_FLAG_xxx */
+  uint8_t speed;  /* planned speed in 10 mm/s */
+} TRACK_Segment;
+
+/* profile, as stored in NVM */
+typedef struct {
+  uint16_t magic;        /* TRACK_PROFILE_MAGIC */
+  uint16_t nofSegments;  /* number of valid entries in seg[] */
+  uint32_t lapMs;        /* lap time of the recording lap */
+  TRACK_Segment seg[TRACK_MAX_SEGMENTS];
+} TRACK_Profile;
+
+static TRACK_Profile TRACK_profile;
+static bool TRACK_profileValid = FALSE;
+static TRACK_Mode TRACK_mode = TRACK_MODE_OFF;
+
+static struct {
+  int32_t latAccel;  /* lateral acceleration limit, mm/s^2 */
+  int32_t decel;     /* braking deceleration, mm/s^2 */
+  int32_t maxSpeed;  /* speed limit, mm/s */
+  uint8_t ffGain;    /* feed-forward gain in percent */
+} TRACK_config;
+
+static struct {
+  bool active;           /* lap is running */
+  bool overflow;         /* track is longer than the profile buffer */
+  bool snapped;          /* position has been corrected with the current line event */
+  int32_t offsetUm;      /* odometry distance at lap start, plus distance not driven along the line */
+  int32_t prevDistUm;    /* odometry distance of last update */
+  ODO_Angle prevHeading; /* heading of last update */
+  int32_t segHeading;    /* heading change in the current segment */
+  uint8_t segFlags;      /* line events in the current segment */
+  uint16_t segIdx;       /* current segment */
+  uint32_t startTicks;   /* tick count at lap start */
+  uint32_t lastLapMs;    /* time of last lap */
+} TRACK_lap;
+
+void TRACK_SetMode(TRACK_Mode mode) {
+  FRTOS1_taskENTER_CRITICAL();
+  TRACK_mode = mode;
+  TRACK_lap.active = FALSE; /* a running lap is not valid any more */
+  FRTOS1_taskEXIT_CRITICAL();
+}
+
+TRACK_Mode TRACK_GetMode(void) {
+  return TRACK_mode;
+}
+
+/* calculates the planned speed for each segment of the profile */
+static void TRACK_PlanSpeed(void) {
+  int i;
+  int32_t curv;
+  uint32_t v2, limit2, next2 = 0;
+
+  for(i=TRACK_profile.nofSegments-1;i>=0;i--) {
+    v2 = (uint32_t)TRACK_config.maxSpeed*(uint32_t)TRACK_config.maxSpeed;
+    curv = TRACK_profile.seg[i].curv;
+    if (curv<0) {
+      curv = -curv;
+    }
+    if (curv>0) {
+      limit2 = (((uint32_t)TRACK_config.latAccel*1000)/(uint32_t)curv)*1000; /* v^2=a/k */
+      if (limit2<v2) {
+        v2 = limit2;
+      }
+    }
+    if (i<TRACK_profile.nofSegments-1 && next2<v2) { /* need to brake for the next segment */
+      v2 = next2;
+    }
+    TRACK_profile.seg[i].speed = (uint8_t)(UTIL_ISqrt(v2)/10);
+    next2 = v2+2*(uint32_t)TRACK_config.decel*TRACK_SEGMENT_MM; /* speed from which we can brake within one segment */
+  }
+}
+
+void TRACK_StartLap(void) {
+  ODO_Pose pose;
+
+  ODO_GetPose(&pose);
+  FRTOS1_taskENTER_CRITICAL();
+  TRACK_lap.prevDistUm = ODO_GetDistanceUm();
+  TRACK_lap.offsetUm = TRACK_lap.prevDistUm;
+  TRACK_lap.prevHeading = pose.heading;
+  TRACK_lap.segHeading = 0;
+  TRACK_lap.segFlags = 0;
+  TRACK_lap.segIdx = 0;
+  TRACK_lap.overflow = FALSE;
+  TRACK_lap.snapped = FALSE;
+  TRACK_lap.startTicks = FRTOS1_xTaskGetTickCount();
+  if (TRACK_mode==TRACK_MODE_RECORD) {
+    TRACK_profileValid = FALSE;
+    TRACK_profile.magic = TRACK_PROFILE_MAGIC;
+    TRACK_profile.nofSegments = 0;
+    TRACK_profile.lapMs = 0;
+    TRACK_lap.active = TRUE;
+  } else {
+    TRACK_lap.active = TRACK_profileValid; /* also measure the lap time if we are not replaying */
+  }
+  FRTOS1_taskEXIT_CRITICAL();
+}
+
+void TRACK_EndLap(bool finished) {
+  if (!TRACK_lap.active) {
+    return;
+  }
+  TRACK_lap.active = FALSE;
+  TRACK_lap.lastLapMs = (FRTOS1_xTaskGetTickCount()-TRACK_lap.startTicks)*portTICK_PERIOD_MS;
+  if (TRACK_mode==TRACK_MODE_RECORD) {
+    if (finished && TRACK_profile.nofSegments>0) {
+      TRACK_profile.lapMs = TRACK_lap.lastLapMs;
+      TRACK_PlanSpeed();
+      TRACK_profileValid = TRUE;
+      TRACK_mode = TRACK_MODE_REPLAY; /* use it for the next laps */
+    } else {
+      TRACK_profile.nofSegments = 0;
+    }
+  }
+}
+
+/* stores the segments up to the current distance */
+static void TRACK_Record(int32_t lapDistUm) {
+  int32_t curv;
+
+  while (lapDistUm>=((int32_t)TRACK_lap.segIdx+1)*TRACK_SEGMENT_UM) {
+    if (TRACK_lap.segIdx>=TRACK_MAX_SEGMENTS) {
+      TRACK_lap.overflow = TRUE;
+      return;
+    }
+    curv = (TRACK_lap.segHeading*9587)/(TRACK_SEGMENT_MM*100); /* 2*pi*1e6/65536 = 95.87: binary angle per mm to 1/km */
+    if (curv>TRACK_MAX_CURV) {
+      curv = TRACK_MAX_CURV;
+    } else if (curv<-TRACK_MAX_CURV) {
+      curv = -TRACK_MAX_CURV;
+    }
+    TRACK_profile.seg[TRACK_lap.segIdx].curv = (int16_t)curv;
+    TRACK_profile.seg[TRACK_lap.segIdx].flags = TRACK_lap.segFlags;
+    TRACK_profile.seg[TRACK_lap.segIdx].speed = 0;
+    TRACK_lap.segIdx++;
+    TRACK_profile.nofSegments = TRACK_lap.segIdx;
+    TRACK_lap.segHeading = 0;
+    TRACK_lap.segFlags = 0;
+  }
+}
+
+/* finds the position on the recorded track */
+static void TRACK_Localize(int32_t lapDistUm, REF_LineKind kind) {
+  int32_t idx, i, d;
+  uint8_t flag;
+
+  idx = lapDistUm/TRACK_SEGMENT_UM;
+  if (kind==REF_LINE_STRAIGHT) {
+    TRACK_lap.snapped = FALSE;
+  } else if (!TRACK_lap.snapped) { /* new line event: search it in the profile, closest first */
+    TRACK_lap.snapped = TRUE;
+    flag = (kind==REF_LINE_NONE)?TRACK_FLAG_GAP:TRACK_FLAG_MARK;
+    for(d=0;d<=TRACK_SNAP_WINDOW;d++) {
+      i = idx+d;
+      if (i<TRACK_profile.nofSegments && (TRACK_profile.seg[i].flags&flag)) {
+        break;
+      }
+      i = idx-d;
+      if (i>=0 && i<TRACK_profile.nofSegments && (TRACK_profile.seg[i].flags&flag)) {
+        break;
+      }
+    }
+    if (d<=TRACK_SNAP_WINDOW) { /* found: we are at the start of this segment */
+      TRACK_lap.offsetUm += lapDistUm-i*TRACK_SEGMENT_UM;
+      idx = i;
+    }
+  }
+  if (idx<0) {
+    idx = 0;
+  }
+  TRACK_lap.segIdx = (uint16_t)idx;
+}
+
+void TRACK_Update(REF_LineKind kind) {
+  ODO_Pose pose;
+  int32_t dist;
+  int16_t dHeading;
+
+  if (!TRACK_lap.active) {
+    return;
+  }
+  ODO_GetPose(&pose);
+  dist = ODO_GetDistanceUm();
+  dHeading = (int16_t)(pose.heading-TRACK_lap.prevHeading);
+  if (dHeading>TRACK_MAX_HEADING_STEP || dHeading<-TRACK_MAX_HEADING_STEP || dist<TRACK_lap.prevDistUm) {
+    /* turned on the spot or moved backward since the last update: this is not part of the track */
+    TRACK_lap.offsetUm += dist-TRACK_lap.prevDistUm;
+  } else {
+    TRACK_lap.segHeading += dHeading;
+  }
+  TRACK_lap.prevDistUm = dist;
+  TRACK_lap.prevHeading = pose.heading;
+  if (kind==REF_LINE_NONE) {
+    TRACK_lap.segFlags |= TRACK_FLAG_GAP;
+  } else if (kind!=REF_LINE_STRAIGHT) {
+    TRACK_lap.segFlags |= TRACK_FLAG_MARK;
+  }
+  if (TRACK_mode==TRACK_MODE_RECORD) {
+    if (!TRACK_lap.overflow) {
+      TRACK_Record(dist-TRACK_lap.offsetUm);
+    }
+  } else {
+    TRACK_Localize(dist-TRACK_lap.offsetUm, kind);
+  }
+}
+
+bool TRACK_GetFeedForward(int32_t *speedMmSec, int32_t *curv) {
+  uint16_t idx;
+
+  if (!TRACK_lap.active || TRACK_mode!=TRACK_MODE_REPLAY || !TRACK_profileValid) {
+    return FALSE;
+  }
+  idx = TRACK_lap.segIdx;
+  if (idx>=TRACK_profile.nofSegments) {
+    return FALSE; /* beyond the recorded track */
+  }
+  *speedMmSec = (int32_t)TRACK_profile.seg[idx].speed*10;
+  idx += TRACK_FF_LOOKAHEAD;
+  if (idx>=TRACK_profile.nofSegments) {
+    idx = TRACK_profile.nofSegments-1;
+  }
+  *curv = ((int32_t)TRACK_profile.seg[idx].curv*TRACK_config.ffGain)/100;
+  return TRUE;
+}
+
+#if PL_CONFIG_HAS_CONFIG_NVM
+static bool TRACK_Load(void) {
+  TRACK_Profile *ptr;
+
+  ptr = (TRACK_Profile*)NVMC_GetTrackData();
+  if (ptr==NULL || ptr->magic!=TRACK_PROFILE_MAGIC || ptr->nofSegments==0 || ptr->nofSegments>TRACK_MAX_SEGMENTS) {
+    return FALSE; /* no valid data */
+  }
+  TRACK_profile = *ptr;
+  TRACK_profileValid = TRUE;
+  return TRUE;
+}
+#endif
+
+#if PL_CONFIG_HAS_SHELL
+static void TRACK_PrintHelp(const CLS1_StdIOType *io) {
+  CLS1_SendHelpStr((unsigned char*)"track", (unsigned char*)"Group of track learning commands\r\n", io->stdOut);
+  CLS1_SendHelpStr((unsigned char*)"  help|status", (unsigned char*)"Shows track help or status\r\n", io->stdOut);
+  CLS1_SendHelpStr((unsigned char*)"  record|replay|off", (unsigned char*)"Record the next lap, use the recorded track, or disable\r\n", io->stdOut);
+  CLS1_SendHelpStr((unsigned char*)"  print", (unsigned char*)"Print the recorded profile\r\n", io->stdOut);
+  CLS1_SendHelpStr((unsigned char*)"  alat <mm/s^2>", (unsigned char*)"Lateral acceleration limit\r\n", io->stdOut);
+  CLS1_SendHelpStr((unsigned char*)"  decel <mm/s^2>", (unsigned char*)"Braking deceleration\r\n", io->stdOut);
+  CLS1_SendHelpStr((unsigned char*)"  vmax <mm/s>", (unsigned char*)"Speed limit\r\n", io->stdOut);
+  CLS1_SendHelpStr((unsigned char*)"  ffgain <%>", (unsigned char*)"Feed-forward steering gain\r\n", io->stdOut);
+#if PL_CONFIG_HAS_CONFIG_NVM
+  CLS1_SendHelpStr((unsigned char*)"  save|load", (unsigned char*)"Store or load the recorded track in NVM\r\n", io->stdOut);
+#endif
+}
+
+static void TRACK_PrintStatus(const CLS1_StdIOType *io) {
+  unsigned char buf[32];
+
+  CLS1_SendStatusStr((unsigned char*)"track", (unsigned char*)"\r\n", io->stdOut);
+  switch(TRACK_mode) {
+    case TRACK_MODE_OFF:    UTIL1_strcpy(buf, sizeof(buf), (unsigned char*)"off"); break;
+    case TRACK_MODE_RECORD: UTIL1_strcpy(buf, sizeof(buf), (unsigned char*)"record"); break;
+    case TRACK_MODE_REPLAY: UTIL1_strcpy(buf, sizeof(buf), (unsigned char*)"replay"); break;
+    default:                UTIL1_strcpy(buf, sizeof(buf), (unsigned char*)"UNKNOWN"); break;
+  }
+  if (TRACK_lap.active) {
+    UTIL1_strcat(buf, sizeof(buf), (unsigned char*)", lap running");
+  }
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)"\r\n");
+  CLS1_SendStatusStr((unsigned char*)"  mode", buf, io->stdOut);
+
+  if (TRACK_profileValid) {
+    UTIL1_Num16uToStr(buf, sizeof(buf), TRACK_profile.nofSegments*TRACK_SEGMENT_MM);
+    UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" mm, ");
+    UTIL1_strcatNum32u(buf, sizeof(buf), TRACK_profile.lapMs);
+    UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" ms\r\n");
+  } else {
+    UTIL1_strcpy(buf, sizeof(buf), (unsigned char*)"none\r\n");
+  }
+  CLS1_SendStatusStr((unsigned char*)"  profile", buf, io->stdOut);
+
+  UTIL1_Num16uToStr(buf, sizeof(buf), TRACK_lap.segIdx*TRACK_SEGMENT_MM);
+  UTIL1_strcat(buf, sizeof(buf), TRACK_lap.overflow?(unsigned char*)" mm, buffer full\r\n":(unsigned char*)" mm\r\n");
+  CLS1_SendStatusStr((unsigned char*)"  position", buf, io->stdOut);
+
+  UTIL1_Num32uToStr(buf, sizeof(buf), TRACK_lap.lastLapMs);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" ms\r\n");
+  CLS1_SendStatusStr((unsigned char*)"  last lap", buf, io->stdOut);
+
+  UTIL1_Num32sToStr(buf, sizeof(buf), TRACK_config.latAccel);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" mm/s^2\r\n");
+  CLS1_SendStatusStr((unsigned char*)"  alat", buf, io->stdOut);
+
+  UTIL1_Num32sToStr(buf, sizeof(buf), TRACK_config.decel);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" mm/s^2\r\n");
+  CLS1_SendStatusStr((unsigned char*)"  decel", buf, io->stdOut);
+
+  UTIL1_Num32sToStr(buf, sizeof(buf), TRACK_config.maxSpeed);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" mm/s\r\n");
+  CLS1_SendStatusStr((unsigned char*)"  vmax", buf, io->stdOut);
+
+  UTIL1_Num8uToStr(buf, sizeof(buf), TRACK_config.ffGain);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)"%\r\n");
+  CLS1_SendStatusStr((unsigned char*)"  ffgain", buf, io->stdOut);
+}
+
+static void TRACK_PrintProfile(const CLS1_StdIOType *io) {
+  unsigned char buf[48];
+  uint16_t i;
+
+  if (!TRACK_profileValid) {
+    CLS1_SendStr((unsigned char*)"No track recorded\r\n", io->stdErr);
+    return;
+  }
+  CLS1_SendStr((unsigned char*)"mm\tcurv[1/km]\tspeed[mm/s]\tevents\r\n", io->stdOut);
+  for(i=0;i<TRACK_profile.nofSegments;i++) {
+    UTIL1_Num16uToStr(buf, sizeof(buf), i*TRACK_SEGMENT_MM);
+    UTIL1_chcat(buf, sizeof(buf), '\t');
+    UTIL1_strcatNum16s(buf, sizeof(buf), TRACK_profile.seg[i].curv);
+    UTIL1_chcat(buf, sizeof(buf), '\t');
+    UTIL1_strcatNum16u(buf, sizeof(buf), TRACK_profile.seg[i].speed*10);
+    UTIL1_chcat(buf, sizeof(buf), '\t');
+    if (TRACK_profile.seg[i].flags&TRACK_FLAG_GAP) {
+      UTIL1_strcat(buf, sizeof(buf), (unsigned char*)"gap ");
+    }
+    if (TRACK_profile.seg[i].flags&TRACK_FLAG_MARK) {
+      UTIL1_strcat(buf, sizeof(buf), (unsigned char*)"mark");
+    }
+    UTIL1_strcat(buf, sizeof(buf), (unsigned char*)"\r\n");
+    CLS1_SendStr(buf, io->stdOut);
+  }
+}
+
+uint8_t TRACK_ParseCommand(const unsigned char *cmd, bool *handled, const CLS1_StdIOType *io) {
+  uint8_t res = ERR_OK;
+  const unsigned char *p;
+  uint16_t val16u;
+  uint8_t val8u;
+
+  if (UTIL1_strcmp((char*)cmd, (char*)CLS1_CMD_HELP)==0 || UTIL1_strcmp((char*)cmd, (char*)"track help")==0) {
+    TRACK_PrintHelp(io);
+    *handled = TRUE;
+  } else if (UTIL1_strcmp((char*)cmd, (char*)CLS1_CMD_STATUS)==0 || UTIL1_strcmp((char*)cmd, (char*)"track status")==0) {
+    TRACK_PrintStatus(io);
+    *handled = TRUE;
+  } else if (UTIL1_strcmp((char*)cmd, (char*)"track record")==0) {
+    TRACK_SetMode(TRACK_MODE_RECORD);
+    *handled = TRUE;
+  } else if (UTIL1_strcmp((char*)cmd, (char*)"track replay")==0) {
+    if (!TRACK_profileValid) {
+      CLS1_SendStr((unsigned char*)"No track recorded\r\n", io->stdErr);
+      res = ERR_FAILED;
+    } else {
+      TRACK_SetMode(TRACK_MODE_REPLAY);
+    }
+    *handled = TRUE;
+  } else if (UTIL1_strcmp((char*)cmd, (char*)"track off")==0) {
+    TRACK_SetMode(TRACK_MODE_OFF);
+    *handled = TRUE;
+  } else if (UTIL1_strcmp((char*)cmd, (char*)"track print")==0) {
+    TRACK_PrintProfile(io);
+    *handled = TRUE;
+  } else if (UTIL1_strncmp((char*)cmd, (char*)"track alat ", sizeof("track alat ")-1)==0) {
+    p = cmd+sizeof("track alat");
+    if (UTIL1_ScanDecimal16uNumber(&p, &val16u)==ERR_OK && val16u>0 && val16u<=TRACK_MAX_LAT_ACCEL) {
+      TRACK_config.latAccel = val16u;
+      *handled = TRUE;
+    } else {
+      CLS1_SendStr((unsigned char*)"Wrong argument\r\n", io->stdErr);
+      res = ERR_FAILED;
+    }
+  } else if (UTIL1_strncmp((char*)cmd, (char*)"track decel ", sizeof("track decel ")-1)==0) {
+    p = cmd+sizeof("track decel");
+    if (UTIL1_ScanDecimal16uNumber(&p, &val16u)==ERR_OK && val16u>0) {
+      TRACK_config.decel = val16u;
+      *handled = TRUE;
+    } else {
+      CLS1_SendStr((unsigned char*)"Wrong argument\r\n", io->stdErr);
+      res = ERR_FAILED;
+    }
+  } else if (UTIL1_strncmp((char*)cmd, (char*)"track vmax ", sizeof("track vmax ")-1)==0) {
+    p = cmd+sizeof("track vmax");
+    if (UTIL1_ScanDecimal16uNumber(&p, &val16u)==ERR_OK && val16u>0 && val16u<=TRACK_MAX_SPEED) {
+      TRACK_config.maxSpeed = val16u;
+      *handled = TRUE;
+    } else {
+      CLS1_SendStr((unsigned char*)"Wrong argument\r\n", io->stdErr);
+      res = ERR_FAILED;
+    }
+  } else if (UTIL1_strncmp((char*)cmd, (char*)"track ffgain ", sizeof("track ffgain ")-1)==0) {
+    p = cmd+sizeof("track ffgain");
+    if (UTIL1_ScanDecimal8uNumber(&p, &val8u)==ERR_OK && val8u<=200) {
+      TRACK_config.ffGain = val8u;
+      *handled = TRUE;
+    } else {
+      CLS1_SendStr((unsigned char*)"Wrong argument\r\n", io->stdErr);
+      res = ERR_FAILED;
+    }
+#if PL_CONFIG_HAS_CONFIG_NVM
+  } else if (UTIL1_strcmp((char*)cmd, (char*)"track save")==0) {
+    if (!TRACK_profileValid) {
+      CLS1_SendStr((unsigned char*)"No track recorded\r\n", io->stdErr);
+      res = ERR_FAILED;
+    } else if (NVMC_SaveTrackData(&TRACK_profile, sizeof(TRACK_profile))!=ERR_OK) {
+      CLS1_SendStr((unsigned char*)"Flashing track data FAILED!\r\n", io->stdErr);
+      res = ERR_FAILED;
+    }
+    *handled = TRUE;
+  } else if (UTIL1_strcmp((char*)cmd, (char*)"track load")==0) {
+    TRACK_SetMode(TRACK_MODE_OFF);
+    if (!TRACK_Load()) {
+      CLS1_SendStr((unsigned char*)"No track in NVM\r\n", io->stdErr);
+      res = ERR_FAILED;
+    } else {
+      TRACK_PlanSpeed(); /* parameters might have changed */
+    }
+    *handled = TRUE;
+#endif
+  }
+  return res;
+}
+#endif /* PL_CONFIG_HAS_SHELL */
+
+void TRACK_Deinit(void) {
+  /* nothing needed */
+}
+
+void TRACK_Init(void) {
+  TRACK_mode = TRACK_MODE_OFF;
+  TRACK_profileValid = FALSE;
+  TRACK_profile.nofSegments = 0;
+  TRACK_lap.active = FALSE;
+  TRACK_lap.lastLapMs = 0;
+  TRACK_config.latAccel = 3000;
+  TRACK_config.decel = 2000;
+  TRACK_config.maxSpeed = 800;
+  TRACK_config.ffGain = 80; /* leave some work for the PID, the recorded curvature is never exact */
+#if PL_CONFIG_HAS_CONFIG_NVM
+  (void)TRACK_Load(); /* use the stored track, if any */
+#endif
+}
+#endif /* PL_CONFIG_HAS_LINE_TRACK */
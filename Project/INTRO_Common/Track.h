@@ -0,0 +1,80 @@
+/**
+ * \file
+ * \brief Interface to the track learning module.
+ *
+ * During a recording lap the track is stored as a distance indexed profile (curvature and line events).
+ * On the following laps the robot localizes itself along the profile and gets feed-forward steering and
+ * a pre-planned speed, so the line PID only has to correct small errors.
+ */
+
+#ifndef TRACK_H_
+#define TRACK_H_
+
+#include "Platform.h"
+#if PL_CONFIG_HAS_LINE_TRACK
+#include "Reflectance.h"
+
+#if PL_CONFIG_HAS_SHELL
+#include "CLS1.h"
+/*!
+ * \brief Shell command line parser.
+ * \param[in] cmd Pointer to command string
+ * \param[out] handled If command is handled by the parser
+ * \param[in] io Std I/O handler of shell
+ */
+uint8_t TRACK_ParseCommand(const unsigned char *cmd, bool *handled, const CLS1_StdIOType *io);
+#endif
+
+typedef enum {
+  TRACK_MODE_OFF,    /*!< not recording and no feed-forward */
+  TRACK_MODE_RECORD, /*!< record the track during the next lap */
+  TRACK_MODE_REPLAY  /*!< use the recorded track for feed-forward */
+} TRACK_Mode;
+
+/*!
+ * \brief Sets the mode of the module.
+ * \param mode New mode
+ */
+void TRACK_SetMode(TRACK_Mode mode);
+
+/*!
+ * \brief Returns the current mode of the module.
+ * \return Current mode
+ */
+TRACK_Mode TRACK_GetMode(void);
+
+/*!
+ * \brief Called by the line following at the start of a lap.
+ */
+void TRACK_StartLap(void);
+
+/*!
+ * \brief Called by the line following at the end of a lap.
+ * A completed recording lap is turned into a speed plan and the mode switches to replay.
+ * \param finished TRUE if the lap has been completed, FALSE if it has been aborted
+ */
+void TRACK_EndLap(bool finished);
+
+/*!
+ * \brief Records or localizes along the track. Called by the line following every cycle while following the line.
+ * \param kind Current line kind
+ */
+void TRACK_Update(REF_LineKind kind);
+
+/*!
+ * \brief Returns the feed-forward values for the current position on the track.
+ * \param[out] speedMmSec Planned speed in mm/s
+ * \param[out] curv Feed-forward curvature in 1/km, positive is to the left
+ * \return TRUE if the values are valid, FALSE if there is no profile for the current position
+ */
+bool TRACK_GetFeedForward(int32_t *speedMmSec, int32_t *curv);
+
+/*! \brief Module de-initialization. */
+void TRACK_Deinit(void);
+
+/*! \brief Module initialization. */
+void TRACK_Init(void);
+
+#endif /* PL_CONFIG_HAS_LINE_TRACK */
+
+#endif /* TRACK_H_ */
@@ -5,90 +5,532 @@
  *
  * This module implements a trigger module.
  * Triggers are special events which are triggered in a given time in the future
+ * The pending triggers are kept in a list sorted by expiry time, where each entry stores its ticks
+ * relative to the entry before. So a tick only decrements the first entry, and only the triggers at
+ * the front of the list have to be looked at when they fire. Adding a trigger walks the list, outside of the tick.
+ * With the trigger task, the tick only moves expired triggers to a second list and wakes up the task,
+ * which runs the callbacks. This keeps slow callbacks out of the tick interrupt.
+ * The tick counts down by the ticks elapsed since the previous call, so triggers still fire on time
+ * if the RTOS has suppressed ticks in tickless idle. To make the RTOS wake up for the next pending trigger,
+ * the trigger task waits with a timeout until then.
  */
 #include "Platform.h"
 #if PL_CONFIG_HAS_TRIGGER
 #include "Trigger.h"
 #include "CS1.h"
 #include <stddef.h> /* for NULL */
+#if PL_CONFIG_HAS_RTOS
+  #include "FRTOS1.h"
+#endif
+#if PL_CONFIG_HAS_SHELL
+  #include "CLS1.h"
+  #include "UTIL1.h"
+#endif
+
+/* The cycles spent in the tick are measured with the cycle counter of the DWT (Cortex-M4).
+ * The SysTick is no measure for it: it runs the tick, and tickless idle reprograms it.
+ * The Cortex-M0+ has no cycle counter, there the statistics are not available. */
+#if defined(DWT_CYCCNT)
+  #define TRG_HAS_CYCLES      1
+  #define TRG_DEMCR_TRCENA    (1UL<<24) /* DEMCR: enables the DWT */
+  #define TRG_DWT_CYCCNTENA   (1UL<<0)  /* DWT_CTRL: enables the cycle counter */
+#else
+  #define TRG_HAS_CYCLES      0
+#endif
+
+#define TRG_TASK_PRIORITY  (configMAX_PRIORITIES-1) /* above all other tasks, the callbacks are short */
+
+#if PL_CONFIG_HAS_TRIGGER_TASK && configUSE_TICKLESS_IDLE
+  #define TRG_WAIT_FOR_EXPIRY  1 /* trigger task wakes up for the next expiry, so tickless idle does not sleep past it */
+#else
+  #define TRG_WAIT_FOR_EXPIRY  0 /* ticks are never suppressed, the tick moves expired triggers to the task */
+#endif
+
+typedef enum {
+  TRG_STATE_IDLE,     /*!< not set */
+  TRG_STATE_PENDING,  /*!< in the list of pending triggers */
+  TRG_STATE_EXPIRED   /*!< expired, waiting for the trigger task to run the callback */
+} TRG_State;
 
 /*! \brief Descriptor for a trigger. */
 typedef struct TRG_TriggerDesc {
-  TRG_TriggerTime ticks;    /*!< tick count until trigger */
+  TRG_TriggerTime ticks;    /*!< tick count after the previous trigger in the list */
   TRG_Callback callback;    /*!< callback function */
   TRG_CallBackDataPtr data; /*!< additional data pointer for callback */
+  TRG_Handle next, prev;    /*!< neighbours in the list of pending or expired triggers */
+  uint8_t state;            /*!< TRG_State */
+  bool allocated;           /*!< handle is in use */
+  bool inIsr;               /*!< callback runs in the tick interrupt */
 } TRG_TriggerDesc;
 
-static TRG_TriggerDesc TRG_Triggers[TRG_NOF_TRIGGERS];  /*!< Array of triggers */
+static TRG_TriggerDesc TRG_Triggers[TRG_MAX_TRIGGERS];  /*!< Array of triggers */
+static TRG_Handle TRG_Head = TRG_NO_TRIGGER;            /*!< first pending trigger, expires next */
+#if PL_CONFIG_HAS_RTOS
+static portTickType TRG_LastTick;                       /*!< RTOS tick count of the previous TRG_AddTick() */
+#endif
+
+#if TRG_HAS_CYCLES
+/*! \brief Cycles spent in TRG_AddTick() */
+static struct {
+  uint32_t last, max; /*!< cycles of the last and the longest tick */
+  uint32_t sum;       /*!< sum of the cycles, for the average */
+  uint32_t nofTicks;  /*!< number of ticks in sum */
+} TRG_Cycles;
+#endif
+
+#if PL_CONFIG_HAS_TRIGGER_TASK
+static TRG_Handle TRG_ExpiredHead = TRG_NO_TRIGGER;  /*!< expired triggers, oldest first */
+static TRG_Handle TRG_ExpiredTail = TRG_NO_TRIGGER;  /*!< newest expired trigger */
+static xSemaphoreHandle TRG_Sem = NULL;              /*!< given by the tick for expired triggers */
+static bool TRG_DeferEnabled = TRUE;                 /*!< run callbacks in the task, can be turned off to compare */
+
+/*! \brief Statistics of the trigger task */
+static struct {
+  uint32_t tickCntr;    /*!< counts the ticks, to measure the latency */
+  uint32_t expiredTick[TRG_MAX_TRIGGERS]; /*!< tick when the trigger has expired */
+  uint32_t nofDeferred; /*!< callbacks run by the task */
+  uint32_t maxLatency;  /*!< longest time in ticks from expiry until the callback has run */
+} TRG_TaskStats;
+#endif
+
+/* removes a pending or expired trigger from its list, called with interrupts disabled */
+static void TRG_Unlink(TRG_Handle trigger) {
+  TRG_TriggerDesc *t = &TRG_Triggers[trigger];
 
-uint8_t TRG_SetTrigger(TRG_TriggerKind trigger, TRG_TriggerTime ticks, TRG_Callback callback, TRG_CallBackDataPtr data) {
+#if PL_CONFIG_HAS_TRIGGER_TASK
+  if (t->state==TRG_STATE_EXPIRED) {
+    if (t->next!=TRG_NO_TRIGGER) {
+      TRG_Triggers[t->next].prev = t->prev;
+    } else {
+      TRG_ExpiredTail = t->prev;
+    }
+    if (t->prev!=TRG_NO_TRIGGER) {
+      TRG_Triggers[t->prev].next = t->next;
+    } else {
+      TRG_ExpiredHead = t->next;
+    }
+    t->next = t->prev = TRG_NO_TRIGGER;
+    t->state = TRG_STATE_IDLE;
+    return;
+  }
+#endif
+  if (t->next!=TRG_NO_TRIGGER) {
+    TRG_Triggers[t->next].ticks += t->ticks; /* keep the expiry time of the following trigger */
+    TRG_Triggers[t->next].prev = t->prev;
+  }
+  if (t->prev!=TRG_NO_TRIGGER) {
+    TRG_Triggers[t->prev].next = t->next;
+  } else {
+    TRG_Head = t->next;
+  }
+  t->next = t->prev = TRG_NO_TRIGGER;
+  t->state = TRG_STATE_IDLE;
+}
+
+#if PL_CONFIG_HAS_TRIGGER_TASK
+/* moves the first pending trigger to the end of the expired list, called with interrupts disabled */
+static void TRG_Defer(TRG_Handle trigger) {
+  TRG_Unlink(trigger);
+  TRG_Triggers[trigger].prev = TRG_ExpiredTail;
+  if (TRG_ExpiredTail!=TRG_NO_TRIGGER) {
+    TRG_Triggers[TRG_ExpiredTail].next = trigger;
+  } else {
+    TRG_ExpiredHead = trigger;
+  }
+  TRG_ExpiredTail = trigger;
+  TRG_Triggers[trigger].state = TRG_STATE_EXPIRED;
+  TRG_TaskStats.expiredTick[trigger] = TRG_TaskStats.tickCntr;
+}
+#endif
+
+/* inserts a trigger into the list, behind triggers with the same expiry time. Called with interrupts disabled */
+static void TRG_Link(TRG_Handle trigger, TRG_TriggerTime ticks) {
+  TRG_Handle prev = TRG_NO_TRIGGER, i = TRG_Head;
+
+  while (i!=TRG_NO_TRIGGER && ticks>=TRG_Triggers[i].ticks) {
+    ticks -= TRG_Triggers[i].ticks;
+    prev = i;
+    i = TRG_Triggers[i].next;
+  }
+  TRG_Triggers[trigger].ticks = ticks;
+  TRG_Triggers[trigger].prev = prev;
+  TRG_Triggers[trigger].next = i;
+  if (i!=TRG_NO_TRIGGER) {
+    TRG_Triggers[i].ticks -= ticks;
+    TRG_Triggers[i].prev = trigger;
+  }
+  if (prev!=TRG_NO_TRIGGER) {
+    TRG_Triggers[prev].next = trigger;
+  } else {
+    TRG_Head = trigger;
+  }
+  TRG_Triggers[trigger].state = TRG_STATE_PENDING;
+}
+
+#if TRG_WAIT_FOR_EXPIRY
+/* returns TRUE if running in an interrupt service routine */
+static bool TRG_InIsr(void) {
+  uint32_t ipsr;
+
+  __asm volatile ("mrs %0, ipsr" : "=r" (ipsr));
+  return ipsr!=0;
+}
+#endif
+
+uint8_t TRG_SetTrigger(TRG_Handle trigger, TRG_TriggerTime ticks, TRG_Callback callback, TRG_CallBackDataPtr data) {
+#if TRG_WAIT_FOR_EXPIRY
+  bool isHead;
+#endif
   CS1_CriticalVariable()
-  
+
+  if (trigger>=TRG_MAX_TRIGGERS || callback==NULL) {
+    return ERR_FAILED;
+  }
   CS1_EnterCritical();
-  TRG_Triggers[trigger].ticks = ticks;
+  if (TRG_Triggers[trigger].state!=TRG_STATE_IDLE) { /* pending or expired: restart it */
+    TRG_Unlink(trigger);
+  }
+  TRG_Link(trigger, ticks);
   TRG_Triggers[trigger].callback = callback;
   TRG_Triggers[trigger].data = data;
+#if TRG_WAIT_FOR_EXPIRY
+  isHead = (TRG_Head==trigger);
+#endif
   CS1_ExitCritical();
+#if TRG_WAIT_FOR_EXPIRY
+  if (isHead) { /* expires before the time the trigger task is waiting for */
+    if (TRG_InIsr()) {
+      (void)FRTOS1_xSemaphoreGiveFromISR(TRG_Sem, NULL);
+    } else {
+      (void)FRTOS1_xSemaphoreGive(TRG_Sem);
+    }
+  }
+#endif
   return ERR_OK;
 }
 
-/*!
- * \brief Goes through the list of triggers and returns TRUE in case we have to call a callback.
- * \return Returns TRUE if we have called a callback.
- */
-static bool CheckCallbacks(void) {
-  TRG_TriggerKind i;
+bool TRG_GetNextExpiry(TRG_TriggerTime *ticks) {
+  bool pending = FALSE;
+  CS1_CriticalVariable()
+
+  CS1_EnterCritical();
+  if (TRG_Head!=TRG_NO_TRIGGER) {
+    *ticks = TRG_Triggers[TRG_Head].ticks;
+    pending = TRUE;
+  }
+  CS1_ExitCritical();
+  return pending;
+}
+
+void TRG_CancelTrigger(TRG_Handle trigger) {
+  CS1_CriticalVariable()
+
+  if (trigger>=TRG_MAX_TRIGGERS) {
+    return;
+  }
+  CS1_EnterCritical();
+  if (TRG_Triggers[trigger].state!=TRG_STATE_IDLE) {
+    TRG_Unlink(trigger);
+  }
+  CS1_ExitCritical();
+}
+
+void TRG_SetRunInIsr(TRG_Handle trigger, bool inIsr) {
+  if (trigger<TRG_MAX_TRIGGERS) {
+    TRG_Triggers[trigger].inIsr = inIsr;
+  }
+}
+
+TRG_Handle TRG_AllocTrigger(void) {
+  TRG_Handle i;
+  CS1_CriticalVariable()
+
+  CS1_EnterCritical();
+  for(i=TRG_NOF_TRIGGERS;i<TRG_MAX_TRIGGERS;i++) {
+    if (!TRG_Triggers[i].allocated) {
+      TRG_Triggers[i].allocated = TRUE;
+      CS1_ExitCritical();
+      return i;
+    }
+  }
+  CS1_ExitCritical();
+  return TRG_NO_TRIGGER;
+}
+
+void TRG_FreeTrigger(TRG_Handle trigger) {
+  CS1_CriticalVariable()
+
+  if (trigger<TRG_NOF_TRIGGERS || trigger>=TRG_MAX_TRIGGERS) {
+    return; /* static trigger or invalid handle */
+  }
+  CS1_EnterCritical();
+  if (TRG_Triggers[trigger].state!=TRG_STATE_IDLE) {
+    TRG_Unlink(trigger);
+  }
+  TRG_Triggers[trigger].inIsr = FALSE;
+  TRG_Triggers[trigger].allocated = FALSE;
+  CS1_ExitCritical();
+}
+
+void TRG_AddTick(void) {
+  TRG_Handle head;
   TRG_Callback callback;
   TRG_CallBackDataPtr data;
-  bool calledCallBack = FALSE;
+  uint32_t elapsed;
+#if TRG_HAS_CYCLES
+  uint32_t start, cycles;
+#endif
+#if PL_CONFIG_HAS_RTOS
+  portTickType now;
+#endif
+#if PL_CONFIG_HAS_TRIGGER_TASK
+  bool deferred = FALSE;
+#endif
   CS1_CriticalVariable()
 
-  for(i=(TRG_TriggerKind)0;i<TRG_NOF_TRIGGERS;i++) {
+#if TRG_HAS_CYCLES
+  start = DWT_CYCCNT;
+#endif
+  CS1_EnterCritical();
+#if PL_CONFIG_HAS_RTOS
+  now = FRTOS1_xTaskGetTickCountFromISR();
+  elapsed = (uint32_t)(now-TRG_LastTick); /* more than one tick after tickless idle */
+  TRG_LastTick = now;
+#else
+  elapsed = 1;
+#endif
+#if PL_CONFIG_HAS_TRIGGER_TASK
+  TRG_TaskStats.tickCntr += elapsed;
+#endif
+  /* count down the first triggers, this counts down all the triggers behind too */
+  for(head=TRG_Head;head!=TRG_NO_TRIGGER && elapsed!=0;head=TRG_Triggers[head].next) {
+    if (TRG_Triggers[head].ticks>=elapsed) {
+      TRG_Triggers[head].ticks -= elapsed;
+      break;
+    }
+    elapsed -= TRG_Triggers[head].ticks;
+    TRG_Triggers[head].ticks = 0; /* has expired while ticks were suppressed */
+  }
+  for(;;) {
+    head = TRG_Head;
+    if (head==TRG_NO_TRIGGER || TRG_Triggers[head].ticks!=0) {
+      break; /* nothing (more) expired */
+    }
+#if PL_CONFIG_HAS_TRIGGER_TASK
+    if (TRG_DeferEnabled && !TRG_Triggers[head].inIsr) {
+      TRG_Defer(head); /* callback runs in the trigger task */
+      deferred = TRUE;
+      continue;
+    }
+#endif
+    callback = TRG_Triggers[head].callback; /* get a copy */
+    data = TRG_Triggers[head].data; /* get backup of data, as callback might setup this trigger again */
+    TRG_Unlink(head); /* NULL callback prevents that we are called again */
+    CS1_ExitCritical();
+    callback(data); /* may set a trigger at the current time, which is handled in this loop */
     CS1_EnterCritical();
-    if (TRG_Triggers[i].ticks==0 && TRG_Triggers[i].callback != NULL) { /* trigger! */
-      callback = TRG_Triggers[i].callback; /* get a copy */
-      data = TRG_Triggers[i].data; /* get backup of data, as we overwrite it below */
-      /* reset trigger structure, as callback might setup this trigger again */
-      TRG_Triggers[i].callback = NULL; /* NULL callback prevents that we are called again */
-      CS1_ExitCritical();
-      callback(data);
-      calledCallBack = TRUE; /* callback may have set a trigger at the current time: rescan trigger list */
-    } else {
-      CS1_ExitCritical();
+  }
+  CS1_ExitCritical();
+#if PL_CONFIG_HAS_TRIGGER_TASK
+  if (deferred) {
+    (void)FRTOS1_xSemaphoreGiveFromISR(TRG_Sem, NULL); /* the tick interrupt switches to the trigger task */
+  }
+#endif
+#if TRG_HAS_CYCLES
+  cycles = DWT_CYCCNT-start; /* counts up, wraps around */
+  TRG_Cycles.last = cycles;
+  if (cycles>TRG_Cycles.max) {
+    TRG_Cycles.max = cycles;
+  }
+  TRG_Cycles.sum += cycles;
+  TRG_Cycles.nofTicks++;
+  if (TRG_Cycles.nofTicks>=1024) { /* restart the average before the sum can overflow */
+    TRG_Cycles.sum /= 2;
+    TRG_Cycles.nofTicks /= 2;
+  }
+#endif
+}
+
+#if PL_CONFIG_HAS_TRIGGER_TASK
+/* runs the callbacks of the expired triggers, in the order they have expired */
+static void TRG_RunExpired(void) {
+  TRG_Handle head;
+  TRG_Callback callback;
+  TRG_CallBackDataPtr data;
+  uint32_t latency;
+  CS1_CriticalVariable()
+
+  CS1_EnterCritical();
+  while (TRG_ExpiredHead!=TRG_NO_TRIGGER) {
+    head = TRG_ExpiredHead;
+    callback = TRG_Triggers[head].callback;
+    data = TRG_Triggers[head].data; /* get backup of data, as callback might setup this trigger again */
+    TRG_Unlink(head);
+    latency = TRG_TaskStats.tickCntr-TRG_TaskStats.expiredTick[head];
+    if (latency>TRG_TaskStats.maxLatency) {
+      TRG_TaskStats.maxLatency = latency;
     }
-  } /* for */
-  return calledCallBack;
+    TRG_TaskStats.nofDeferred++;
+    CS1_ExitCritical();
+    callback(data);
+    CS1_EnterCritical();
+  }
+  CS1_ExitCritical();
 }
 
-void TRG_AddTick(void) {
-  TRG_TriggerKind i;
-  uint8_t res;
+static void TRG_Task(void *pvParameters) {
+  portTickType timeout = portMAX_DELAY;
+#if TRG_WAIT_FOR_EXPIRY
+  TRG_TriggerTime ticks;
+#endif
+
+  (void)pvParameters;
+  for(;;) {
+#if TRG_WAIT_FOR_EXPIRY
+    /* the RTOS only suppresses ticks until the next task wakes up */
+    timeout = TRG_GetNextExpiry(&ticks) ? (ticks!=0 ? ticks : 1) : portMAX_DELAY;
+#endif
+    (void)FRTOS1_xSemaphoreTake(TRG_Sem, timeout);
+    TRG_RunExpired(); /* on timeout, the tick has just moved the trigger to the expired list */
+  }
+}
+#endif /* PL_CONFIG_HAS_TRIGGER_TASK */
+
+#if PL_CONFIG_HAS_SHELL
+static void TRG_PrintHelp(const CLS1_StdIOType *io) {
+  CLS1_SendHelpStr((unsigned char*)"trigger", (unsigned char*)"Group of trigger commands\r\n", io->stdOut);
+  CLS1_SendHelpStr((unsigned char*)"  help|status", (unsigned char*)"Shows trigger help or status\r\n", io->stdOut);
+  CLS1_SendHelpStr((unsigned char*)"  reset", (unsigned char*)"Resets the tick cycle statistics\r\n", io->stdOut);
+#if PL_CONFIG_HAS_TRIGGER_TASK
+  CLS1_SendHelpStr((unsigned char*)"  defer on|off", (unsigned char*)"Runs the callbacks in the trigger task or in the tick interrupt\r\n", io->stdOut);
+#endif
+}
+
+static void TRG_PrintStatus(const CLS1_StdIOType *io) {
+  unsigned char buf[48];
+  TRG_Handle i;
+  uint8_t nofPending = 0, nofAllocated = 0;
+#if TRG_HAS_CYCLES
+  uint32_t sum, nofTicks;
+#endif
   CS1_CriticalVariable()
 
   CS1_EnterCritical();
-  for(i=(TRG_TriggerKind)0;i<TRG_NOF_TRIGGERS;i++) {
-    if (TRG_Triggers[i].ticks!=0) { /* prevent underflow */
-      TRG_Triggers[i].ticks--;
+  for(i=TRG_Head;i!=TRG_NO_TRIGGER;i=TRG_Triggers[i].next) {
+    nofPending++;
+  }
+  for(i=TRG_NOF_TRIGGERS;i<TRG_MAX_TRIGGERS;i++) {
+    if (TRG_Triggers[i].allocated) {
+      nofAllocated++;
     }
-  } /* for */
+  }
+#if TRG_HAS_CYCLES
+  sum = TRG_Cycles.sum;
+  nofTicks = TRG_Cycles.nofTicks;
+#endif
   CS1_ExitCritical();
-  do {
-    res = CheckCallbacks(); /* while there are callbacks, re-iterate */
-  } while(res);
+  CLS1_SendStatusStr((unsigned char*)"trigger", (unsigned char*)"\r\n", io->stdOut);
+  UTIL1_Num8uToStr(buf, sizeof(buf), nofPending);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" pending, ");
+  UTIL1_strcatNum8u(buf, sizeof(buf), TRG_NOF_TRIGGERS+nofAllocated);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" of ");
+  UTIL1_strcatNum8u(buf, sizeof(buf), TRG_MAX_TRIGGERS);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" in use\r\n");
+  CLS1_SendStatusStr((unsigned char*)"  triggers", buf, io->stdOut);
+#if TRG_HAS_CYCLES
+  UTIL1_Num32uToStr(buf, sizeof(buf), TRG_Cycles.last);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" last, ");
+  UTIL1_strcatNum32u(buf, sizeof(buf), nofTicks!=0?sum/nofTicks:0);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" avg, ");
+  UTIL1_strcatNum32u(buf, sizeof(buf), TRG_Cycles.max);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" max\r\n");
+  CLS1_SendStatusStr((unsigned char*)"  tick cycles", buf, io->stdOut);
+#else
+  CLS1_SendStatusStr((unsigned char*)"  tick cycles", (unsigned char*)"not available, no cycle counter\r\n", io->stdOut);
+#endif
+#if PL_CONFIG_HAS_TRIGGER_TASK
+  UTIL1_strcpy(buf, sizeof(buf), TRG_DeferEnabled?(unsigned char*)"on, ":(unsigned char*)"off, ");
+  UTIL1_strcatNum32u(buf, sizeof(buf), TRG_TaskStats.nofDeferred);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" run, max ");
+  UTIL1_strcatNum32u(buf, sizeof(buf), TRG_TaskStats.maxLatency);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" ticks late\r\n");
+  CLS1_SendStatusStr((unsigned char*)"  defer", buf, io->stdOut);
+#endif
+}
+
+uint8_t TRG_ParseCommand(const unsigned char *cmd, bool *handled, const CLS1_StdIOType *io) {
+  uint8_t res = ERR_OK;
+  CS1_CriticalVariable()
+
+  if (UTIL1_strcmp((char*)cmd, (char*)CLS1_CMD_HELP)==0 || UTIL1_strcmp((char*)cmd, (char*)"trigger help")==0) {
+    TRG_PrintHelp(io);
+    *handled = TRUE;
+  } else if (UTIL1_strcmp((char*)cmd, (char*)CLS1_CMD_STATUS)==0 || UTIL1_strcmp((char*)cmd, (char*)"trigger status")==0) {
+    TRG_PrintStatus(io);
+    *handled = TRUE;
+  } else if (UTIL1_strcmp((char*)cmd, (char*)"trigger reset")==0) {
+    CS1_EnterCritical();
+#if TRG_HAS_CYCLES
+    TRG_Cycles.last = TRG_Cycles.max = TRG_Cycles.sum = TRG_Cycles.nofTicks = 0;
+#endif
+#if PL_CONFIG_HAS_TRIGGER_TASK
+    TRG_TaskStats.nofDeferred = TRG_TaskStats.maxLatency = 0;
+#endif
+    CS1_ExitCritical();
+    *handled = TRUE;
+#if PL_CONFIG_HAS_TRIGGER_TASK
+  } else if (UTIL1_strcmp((char*)cmd, (char*)"trigger defer on")==0) {
+    TRG_DeferEnabled = TRUE;
+    *handled = TRUE;
+  } else if (UTIL1_strcmp((char*)cmd, (char*)"trigger defer off")==0) {
+    TRG_DeferEnabled = FALSE; /* triggers already expired are still run by the task */
+    *handled = TRUE;
+#endif
+  }
+  return res;
 }
+#endif /* PL_CONFIG_HAS_SHELL */
 
 void TRG_Deinit(void) {
-  /* nothing to do */
+#if PL_CONFIG_HAS_TRIGGER_TASK
+  FRTOS1_vSemaphoreDelete(TRG_Sem);
+  TRG_Sem = NULL;
+#endif
 }
 
 void TRG_Init(void) {
-  TRG_TriggerKind i;
+  TRG_Handle i;
 
-  for(i=(TRG_TriggerKind)0;i<TRG_NOF_TRIGGERS;i++) {
+  for(i=0;i<TRG_MAX_TRIGGERS;i++) {
     TRG_Triggers[i].ticks = 0;
     TRG_Triggers[i].callback = NULL;
     TRG_Triggers[i].data = NULL;
+    TRG_Triggers[i].next = TRG_Triggers[i].prev = TRG_NO_TRIGGER;
+    TRG_Triggers[i].state = TRG_STATE_IDLE;
+    TRG_Triggers[i].allocated = (i<TRG_NOF_TRIGGERS); /* static triggers are always in use */
+    TRG_Triggers[i].inIsr = FALSE;
+  }
+  TRG_Head = TRG_NO_TRIGGER;
+#if PL_CONFIG_HAS_RTOS
+  TRG_LastTick = FRTOS1_xTaskGetTickCount();
+#endif
+#if TRG_HAS_CYCLES
+  DEMCR |= TRG_DEMCR_TRCENA;
+  DWT_CTRL |= TRG_DWT_CYCCNTENA;
+  TRG_Cycles.last = TRG_Cycles.max = TRG_Cycles.sum = TRG_Cycles.nofTicks = 0;
+#endif
+#if PL_CONFIG_HAS_TRIGGER_TASK
+  TRG_ExpiredHead = TRG_ExpiredTail = TRG_NO_TRIGGER;
+  TRG_TaskStats.tickCntr = TRG_TaskStats.nofDeferred = TRG_TaskStats.maxLatency = 0;
+  FRTOS1_vSemaphoreCreateBinary(TRG_Sem);
+  if (TRG_Sem==NULL) {
+    for(;;){} /* out of memory? */
+  }
+  (void)FRTOS1_xSemaphoreTake(TRG_Sem, 0); /* empty token */
+  if (FRTOS1_xTaskCreate(TRG_Task, "Trigger", configMINIMAL_STACK_SIZE, NULL, TRG_TASK_PRIORITY, NULL) != pdPASS) {
+    for(;;){} /* error */
   }
+#endif
 }
 
 #endif /* PL_CONFIG_HAS_TRIGGER */
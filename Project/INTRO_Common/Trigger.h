@@ -5,6 +5,9 @@
  *
  * This module implements Trigger module.
  * Triggers are used to callback functions or hooks with a given relative time delay.
+ * Besides the triggers listed in TRG_TriggerKind, modules can allocate trigger handles at run time.
+ * With PL_CONFIG_HAS_TRIGGER_TASK the callbacks run in a high priority task instead of the tick interrupt,
+ * unless a trigger is marked with TRG_SetRunInIsr().
  */
 
 #ifndef TRIGGER_H_
@@ -19,13 +22,18 @@
 
 /*! \brief Triggers which can be used from the application */
 typedef enum {
-  /*! \todo Extend the list of triggers as needed */
-  TRG_BUZ_BEEP, /*!< Buzzer beep */
-  TRG_KEYPRESS, /*!< key debounce */
-  TRG_BUZ_TUNE, /*!< buzzer tune */
+  /*! \todo Extend the list of triggers as needed, or allocate a handle with TRG_AllocTrigger() */
   TRG_NOF_TRIGGERS /*!< Must be last! */
 } TRG_TriggerKind;
 
+/*! \brief Handle of a trigger: either a TRG_TriggerKind, or a handle returned by TRG_AllocTrigger() */
+typedef uint8_t TRG_Handle;
+
+#define TRG_MAX_TRIGGERS  8
+  /*!< Total number of triggers, static ones in TRG_TriggerKind and allocated ones */
+#define TRG_NO_TRIGGER    ((TRG_Handle)0xFF)
+  /*!< Invalid trigger handle */
+
 /*! \brief Type for the data pointer used by the callback */
 typedef void *TRG_CallBackDataPtr;
 
@@ -36,16 +44,60 @@ typedef void (*TRG_Callback)(TRG_CallBackDataPtr);
 typedef uint16_t TRG_TriggerTime;
 
 /*!
- * \brief Adds a new trigger
+ * \brief Adds a new trigger. If the trigger is already pending, it is restarted with the new time.
  * \param trigger Trigger to be added
  * \param ticks Trigger time in ticks. The time is relative from the current time.
  * \param callback Callback to be called when the trigger fires
  * \param data Optional pointer to data
  * \return error code, ERR_OK if everything is fine
  */
-uint8_t TRG_SetTrigger(TRG_TriggerKind trigger, TRG_TriggerTime ticks, TRG_Callback callback, TRG_CallBackDataPtr data);
+uint8_t TRG_SetTrigger(TRG_Handle trigger, TRG_TriggerTime ticks, TRG_Callback callback, TRG_CallBackDataPtr data);
+
+/*!
+ * \brief Cancels a pending trigger.
+ * \param trigger Trigger to cancel
+ */
+void TRG_CancelTrigger(TRG_Handle trigger);
+
+/*!
+ * \brief Returns the time until the next pending trigger expires, e.g. to decide how long the system can sleep.
+ * \param[out] ticks Number of ticks until the next trigger fires, 0 if it fires with the next tick
+ * \return TRUE if a trigger is pending, FALSE if no trigger is pending and ticks is not changed
+ */
+bool TRG_GetNextExpiry(TRG_TriggerTime *ticks);
+
+/*!
+ * \brief Selects where the callback of a trigger runs. Without PL_CONFIG_HAS_TRIGGER_TASK, all callbacks run in the tick interrupt.
+ * \param trigger Trigger
+ * \param inIsr TRUE if the callback has to run in the tick interrupt, e.g. to toggle a pin with little jitter,
+ *   FALSE (the default) to run it in the trigger task
+ */
+void TRG_SetRunInIsr(TRG_Handle trigger, bool inIsr);
+
+/*!
+ * \brief Allocates a trigger handle.
+ * \return Trigger handle, TRG_NO_TRIGGER if all triggers are in use
+ */
+TRG_Handle TRG_AllocTrigger(void);
+
+/*!
+ * \brief Cancels and releases a trigger handle returned by TRG_AllocTrigger().
+ * \param trigger Trigger handle
+ */
+void TRG_FreeTrigger(TRG_Handle trigger);
+
+#if PL_CONFIG_HAS_SHELL
+#include "CLS1.h"
+/*!
+ * \brief Shell command line parser.
+ * \param[in] cmd Pointer to command string
+ * \param[out] handled If command is handled by the parser
+ * \param[in] io Std I/O handler of shell
+ */
+uint8_t TRG_ParseCommand(const unsigned char *cmd, bool *handled, const CLS1_StdIOType *io);
+#endif
 
-/*! \brief Called from interrupt service routine with a period of TRG_TICKS_MS. */
+/*! \brief Called from the tick hook or a timer interrupt with a period of TRG_TICKS_MS. After tickless idle, the RTOS tick hook is called less often. */
 void TRG_AddTick(void);
 
 /*!\brief De-initializes the module. */
@@ -25,6 +25,19 @@
 #if PL_CONFIG_HAS_DRIVE
   #include "Drive.h"
 #endif
+#if PL_CONFIG_HAS_MOTOR_TACHO
+  #include "Tacho.h"
+#endif
+#if PL_CONFIG_HAS_ODOMETRY
+  #include "Odometry.h"
+#endif
+#include "FRTOS1.h"
+#if PL_CONFIG_HAS_CONFIG_NVM
+  #include "NVM_Config.h"
+#endif
+#if PL_CONFIG_HAS_BUS
+  #include "Bus.h"
+#endif
 
 /* \todo adopt the values for your robot */
 #define TURN_STEPS_90         680
@@ -37,10 +50,52 @@
 #define TURN_STEPS_LINE_TIMEOUT_MS      200
 #define TURN_STEPS_POST_LINE_TIMEOUT_MS 200
 #define TURN_STEPS_STOP_TIMEOUT_MS      150
+#define TURN_ARC_RADIUS_MM    100
+  /*!< default radius for rolling turns */
+#define TURN_ARC_SPEED        1000
+  /*!< default forward speed (steps/sec) on the arc, if entering slower */
+#define TURN_ARC_ACCEL        4000
+  /*!< forward acceleration (steps/sec^2) to the arc speed */
+#define TURN_ARC_TURN_ACCEL   8000
+  /*!< acceleration (steps/sec^2) of the difference of the wheel speeds entering and leaving the arc */
+#define TURN_WHEEL_BASE_MM    85
+  /*!< distance between the wheels, if there is no odometry calibration */
 
 static int32_t TURN_Steps90 = TURN_STEPS_90;
 static int32_t TURN_StepsLine = TURN_STEPS_LINE;
 static int32_t TURN_StepsPostLine = TURN_STEPS_POST_LINE;
+static int32_t TURN_ArcRadiusMm = TURN_ARC_RADIUS_MM;
+static int32_t TURN_ArcSpeed = TURN_ARC_SPEED;
+
+#define TURN_HAS_TO_LINE  (PL_CONFIG_HAS_REFLECTANCE && PL_CONFIG_HAS_LINE_FOLLOW && PL_CONFIG_HAS_BUS)
+  /*!< turning until a line is found */
+#if TURN_HAS_TO_LINE
+#define TURN_TO_LINE_SPEED        1200 /* maximum wheel speed (steps/sec) turning to a line */
+#define TURN_TO_LINE_MIN_SPEED    200  /* creeping speed (steps/sec) close to the line, so we do not stall before it */
+#define TURN_TO_LINE_DECEL        8000 /* deceleration of the wheels (steps/sec^2) */
+#define TURN_TO_LINE_LEAVE_ANGLE  30   /* ignore lines within this angle, to leave the current line */
+#define TURN_TO_LINE_MAX_ANGLE    200  /* default maximum turning angle */
+#define TURN_TO_LINE_CENTER_TOL   300  /* line value tolerance for centered line */
+#define TURN_TO_LINE_ANGLE_TOL    30   /* tolerance on the angle of a 90 or 180 degree turn onto a line */
+
+static BUS_Subscriber *TURN_LineSub; /* sensor frames while turning to a line */
+#endif
+
+#define TURN_HAS_CALIB  (PL_CONFIG_HAS_REFLECTANCE && PL_CONFIG_HAS_LINE_FOLLOW && PL_CONFIG_HAS_SHELL)
+  /*!< calibration of the steps with the help of lines */
+#if TURN_HAS_CALIB
+#define TURN_CALIB_SPEED            600   /* speed (steps/sec) for the calibration moves, slow enough for the line sensor sampling */
+#define TURN_CALIB_NOF_REVOLUTIONS  2     /* number of revolutions to average the steps for 360 degree */
+#define TURN_CALIB_NOF_ARMS         4     /* default number of lines going away from the center: 4 for a line cross */
+#define TURN_CALIB_TIMEOUT_MS       20000 /* timeout for a calibration run */
+#endif
+
+/* calibration data, as stored in NVM */
+typedef struct {
+  int32_t steps90;
+  uint16_t stepsLine;
+  uint16_t stepsPostLine;
+} TURN_CalibData;
 
 /*!
  * \brief Translate a turn kind into a string
@@ -54,6 +109,8 @@ const unsigned char *TURN_TurnKindStr(TURN_Kind kind) {
     case TURN_RIGHT90:                return (const unsigned char*)"RIGHT90";
     case TURN_LEFT180:                return (const unsigned char*)"LEFT180";
     case TURN_RIGHT180:               return (const unsigned char*)"RIGHT180";
+    case TURN_LEFT_TO_LINE:           return (const unsigned char*)"LEFT_TO_LINE";
+    case TURN_RIGHT_TO_LINE:          return (const unsigned char*)"RIGHT_TO_LINE";
     case TURN_STRAIGHT:               return (const unsigned char*)"STRAIGHT";
     case TURN_STEP_LINE_FW:           return (const unsigned char*)"STEP_LINE_FW";
     case TURN_STEP_LINE_BW:           return (const unsigned char*)"STEP_LINE_BW";
@@ -63,33 +120,43 @@ const unsigned char *TURN_TurnKindStr(TURN_Kind kind) {
     case TURN_STEP_LINE_BW_POST_LINE: return (const unsigned char*)"STEP_LINE_BW_POST_LINE";
     case TURN_STOP:                   return (const unsigned char*)"STOP";
     case TURN_FINISHED:               return (const unsigned char*)"FINISHED";
+    case TURN_LEFT45_ARC:             return (const unsigned char*)"LEFT45_ARC";
+    case TURN_LEFT90_ARC:             return (const unsigned char*)"LEFT90_ARC";
+    case TURN_RIGHT45_ARC:            return (const unsigned char*)"RIGHT45_ARC";
+    case TURN_RIGHT90_ARC:            return (const unsigned char*)"RIGHT90_ARC";
     default:                          return (const unsigned char*)"TURN_UNKNOWN!";
   }
 }
 
 void TURN_MoveToPos(int32_t targetLPos, int32_t targetRPos, bool wait, TURN_StopFct stopIt, int32_t timeoutMs) {
+  uint8_t res = ERR_OK;
+
   (void)DRV_SetPos(targetLPos, targetRPos);
   (void)DRV_SetMode(DRV_MODE_POS);
-  for(;;) { /* breaks */
-    if (stopIt!=NULL) {
+  if (!wait) {
+    return;
+  }
+  if (stopIt==NULL) { /* nothing to check in between: block until drive task reports the position */
+    res = DRV_WaitForEvent(DRV_EVENT_POS_REACHED, timeoutMs);
+  } else {
+    for(;;) { /* breaks */
       if (stopIt()) { /* check stop condition */
+        res = ERR_OK;
         break;
       }
-    }
-    WAIT1_WaitOSms(1); /* wait some time, and give Drive module enough time to use new value */
-    timeoutMs--;
-    if (timeoutMs<=0) {
-      break; /* timeout */
-    }
-    if (wait && DRV_HasTurned()) {
-      break;
-    }
-    if (!wait) {
-      break;
-    }
-  } /* for */
+      /* wait one control period, so we check the stop condition on every new drive cycle */
+      res = DRV_WaitForEvent(DRV_EVENT_POS_REACHED, DRV_TASK_PERIOD_MS);
+      if (res==ERR_OK) {
+        break; /* in position */
+      }
+      timeoutMs -= DRV_TASK_PERIOD_MS;
+      if (timeoutMs<=0) {
+        break; /* timeout */
+      }
+    } /* for */
+  }
 #if PL_CONFIG_HAS_SHELL
-  if (timeoutMs<=0) {
+  if (res!=ERR_OK) {
     SHELL_SendString((unsigned char*)"MoveToPos Timeout.\r\n");
   }
 #endif
@@ -97,22 +164,13 @@ void TURN_MoveToPos(int32_t targetLPos, int32_t targetRPos, bool wait, TURN_Stop
 
 static void StepsTurn(int32_t stepsL, int32_t stepsR, TURN_StopFct stopIt, int32_t timeOutMS) {
   int32_t currLPos, currRPos, targetLPos, targetRPos;
-  /* stop before turn */
-  int timeout = TURN_STEPS_STOP_TIMEOUT_MS;
-  
-  DRV_SetMode(DRV_MODE_STOP); /* stop it */
-  WAIT1_WaitOSms(5);
 
-  while (timeout>0 && !DRV_IsStopped()) {
-    /* wait until stopped */
-    timeout-=5;
-    WAIT1_WaitOSms(5);
-  }
+  /* stop before turn */
+  if (DRV_Stop(TURN_STEPS_STOP_TIMEOUT_MS)!=ERR_OK) {
 #if PL_CONFIG_HAS_SHELL
-  if (timeout<=0) {
     SHELL_SendString((unsigned char*)"StepsTurn Stopping Timeout.\r\n");
-  }
 #endif
+  }
   currLPos = Q4CLeft_GetPos();
   currRPos = Q4CRight_GetPos();
   targetLPos = currLPos+stepsL;
@@ -120,6 +178,208 @@ static void StepsTurn(int32_t stepsL, int32_t stepsR, TURN_StopFct stopIt, int32
   TURN_MoveToPos(targetLPos, targetRPos, TRUE, stopIt, timeOutMS); /* go to final position */
 }
 
+static int32_t TURN_GetWheelBaseMm(void) {
+#if PL_CONFIG_HAS_ODOMETRY
+  return ODO_GetWheelBaseMm();
+#else
+  return TURN_WHEEL_BASE_MM;
+#endif
+}
+
+void TURN_TurnArc(int16_t angle, int32_t radiusMm, TURN_StopFct stopIt) {
+  bool isLeft = angle<0;
+  int32_t speed, arcSpeed, diffRate, maxDiffRate, dv, wheelBase;
+  int32_t startLPos, startRPos, turned, targetDiff, remaining, timeoutMs;
+
+  if (isLeft) {
+    angle = -angle; /* make it positive */
+  }
+  angle %= 360; /* keep it inside 360 */
+  wheelBase = TURN_GetWheelBaseMm();
+  if (radiusMm<=0) {
+    radiusMm = 1;
+  }
+  speed = (TACHO_GetSpeed(TRUE)+TACHO_GetSpeed(FALSE))/2; /* enter with the current speed */
+  if (speed<0) {
+    speed = 0;
+  }
+  arcSpeed = speed>TURN_ArcSpeed?speed:TURN_ArcSpeed;
+  /* heading only depends on the difference of the wheels: turning on the spot each wheel moves TURN_Steps90,
+   * so the difference is 2*TURN_Steps90 for 90 degree, independent of the radius */
+  targetDiff = (2*angle*TURN_Steps90)/90;
+  /* on the arc the wheel speeds are v*(R+-b/2)/R, their difference grows with v*b/R */
+  maxDiffRate = (arcSpeed*wheelBase)/radiusMm;
+  if (maxDiffRate<=0) {
+    maxDiffRate = 1;
+  }
+  /* expected duration is the acceleration plus targetDiff/maxDiffRate, allow twice that */
+  timeoutMs = (((arcSpeed-speed)*1000)/TURN_ARC_ACCEL+(targetDiff*1000)/maxDiffRate)*2+TURN_STEPS_STOP_TIMEOUT_MS;
+  diffRate = 0;
+  startLPos = Q4CLeft_GetPos();
+  startRPos = Q4CRight_GetPos();
+  if (DRV_GetMode()!=DRV_MODE_SPEED) {
+    (void)DRV_SetSpeed(speed, speed);
+    (void)DRV_SetMode(DRV_MODE_SPEED);
+  }
+  for(;;) { /* breaks */
+    if (stopIt!=NULL && stopIt()) {
+      speed = 0; /* stopped: do not leave the turn moving */
+      break;
+    }
+    turned = ((int32_t)Q4CRight_GetPos()-startRPos)-((int32_t)Q4CLeft_GetPos()-startLPos);
+    if (!isLeft) {
+      turned = -turned;
+    }
+    remaining = targetDiff-turned;
+    if (remaining<=0) {
+      break; /* turned enough */
+    }
+    if (timeoutMs<=0) {
+#if PL_CONFIG_HAS_SHELL
+      SHELL_SendString((unsigned char*)"TurnArc Timeout.\r\n");
+#endif
+      break;
+    }
+    /* forward speed ramps to the arc speed */
+    dv = (TURN_ARC_ACCEL*DRV_TASK_PERIOD_MS)/1000;
+    speed = speed+dv<arcSpeed?speed+dv:arcSpeed;
+    /* the difference of the wheel speeds follows a trapezoid profile on the remaining heading */
+    maxDiffRate = (speed*wheelBase)/radiusMm;
+    dv = (TURN_ARC_TURN_ACCEL*DRV_TASK_PERIOD_MS)/1000;
+    if ((diffRate*diffRate)/(2*TURN_ARC_TURN_ACCEL)>=remaining) { /* straighten out, to reach the heading without turning any more */
+      diffRate -= dv;
+      if (diffRate<dv) {
+        diffRate = dv; /* keep turning until the heading is reached */
+      }
+    } else if (diffRate<maxDiffRate) {
+      diffRate = diffRate+dv<maxDiffRate?diffRate+dv:maxDiffRate;
+    }
+    if (isLeft) {
+      (void)DRV_SetSpeed(speed-diffRate/2, speed+diffRate/2);
+    } else {
+      (void)DRV_SetSpeed(speed+diffRate/2, speed-diffRate/2);
+    }
+    (void)DRV_WaitForCycle(2*DRV_TASK_PERIOD_MS); /* next set point with the next drive cycle */
+    timeoutMs -= DRV_TASK_PERIOD_MS;
+  } /* for */
+  (void)DRV_SetSpeed(speed, speed); /* leave the turn moving straight */
+}
+
+#if TURN_HAS_TO_LINE
+uint8_t TURN_TurnToLine(int16_t maxAngle, TURN_StopFct stopIt) {
+  bool isLeft = maxAngle<0;
+  int32_t startDiff, turned, maxSteps, leaveSteps;
+  int32_t speed, wheelSpeed, dist, firstDist, firstTurned, remainingSteps, brakeSteps, timeToCenterMs;
+  int8_t lineSide = 0; /* side of the middle where we have seen the line first, 0 if not seen yet */
+  const unsigned char *errMsg = NULL;
+  BUS_Sample sample;
+  uint8_t res;
+
+  if (isLeft) {
+    maxAngle = -maxAngle; /* make it positive */
+  }
+  maxSteps = (maxAngle*TURN_Steps90)/90;
+  leaveSteps = (TURN_TO_LINE_LEAVE_ANGLE*TURN_Steps90)/90;
+  startDiff = (int32_t)Q4CRight_GetPos()-(int32_t)Q4CLeft_GetPos();
+  speed = TURN_TO_LINE_SPEED;
+  firstDist = firstTurned = 0;
+  if (DRV_GetMode()!=DRV_MODE_SPEED) {
+    (void)DRV_SetMode(DRV_MODE_SPEED);
+  }
+  (void)BUS_Wait(TURN_LineSub, &sample, 0); /* skip a frame from before the turn */
+  for(;;) { /* breaks */
+    if (isLeft) {
+      (void)DRV_SetSpeed(-speed, speed);
+    } else {
+      (void)DRV_SetSpeed(speed, -speed);
+    }
+    /* nothing new to decide on before the next sensor frame */
+    if (!BUS_Wait(TURN_LineSub, &sample, (2*REF_MEASURE_PERIOD_MS)/portTICK_PERIOD_MS)) {
+      errMsg = (const unsigned char*)"no sensor frames";
+      res = ERR_FAILED;
+      break;
+    }
+    if (stopIt!=NULL && stopIt()) {
+      res = ERR_BUSY;
+      break;
+    }
+    turned = ((int32_t)Q4CRight_GetPos()-(int32_t)Q4CLeft_GetPos()-startDiff)/2; /* steps of each wheel */
+    if (!isLeft) {
+      turned = -turned;
+    }
+    if (turned>=maxSteps) {
+      errMsg = (const unsigned char*)"no line found";
+      res = ERR_FAILED; /* safety bound */
+      break;
+    }
+    if (turned<leaveSteps || sample.u.line.kind==REF_LINE_NONE) {
+      if (lineSide==0) {
+        continue; /* no new line yet */
+      }
+      errMsg = (const unsigned char*)"lost the line";
+      res = ERR_FAILED; /* turned past it within one frame */
+      break;
+    }
+    /* distance of the line to the middle, towards where it comes from */
+    dist = (int32_t)sample.u.line.value-REF_MIDDLE_LINE_VALUE;
+    if (lineSide==0) { /* first time we see the line */
+      lineSide = dist<0?-1:1;
+      firstDist = dist*lineSide;
+      firstTurned = turned;
+    }
+    dist *= lineSide;
+    if (dist<=TURN_TO_LINE_CENTER_TOL) {
+      if (dist<-TURN_TO_LINE_CENTER_TOL) {
+        errMsg = (const unsigned char*)"overshoot";
+        res = ERR_FAILED; /* passed the middle by more than the tolerance */
+      } else {
+        res = ERR_OK; /* centered */
+      }
+      break;
+    }
+    /* remaining steps to the middle, with the steps per line value unit turned since the line has been seen first */
+    if (dist<firstDist && turned>firstTurned) {
+      remainingSteps = ((turned-firstTurned)*dist)/(firstDist-dist);
+      wheelSpeed = (TACHO_GetSpeed(FALSE)-TACHO_GetSpeed(TRUE))/2; /* measured turning rate */
+      if (wheelSpeed<0) {
+        wheelSpeed = -wheelSpeed;
+      }
+      /* start braking if we would not be able to stop in time, including the travel until the next frame */
+      brakeSteps = (wheelSpeed*wheelSpeed)/(2*TURN_TO_LINE_DECEL)+(wheelSpeed*REF_MEASURE_PERIOD_MS)/1000;
+      if (wheelSpeed>0 && remainingSteps<=brakeSteps) {
+        /* the speed from which we can stop exactly in the remaining time */
+        timeToCenterMs = (remainingSteps*1000)/wheelSpeed;
+        speed = (TURN_TO_LINE_DECEL*timeToCenterMs)/1000;
+        if (speed<TURN_TO_LINE_MIN_SPEED) {
+          speed = TURN_TO_LINE_MIN_SPEED;
+        } else if (speed>TURN_TO_LINE_SPEED) {
+          speed = TURN_TO_LINE_SPEED;
+        }
+      }
+    }
+  } /* for */
+  (void)DRV_Stop(TURN_STEPS_STOP_TIMEOUT_MS);
+  if (res==ERR_OK) { /* check where we have come to a stop */
+    (void)BUS_Wait(TURN_LineSub, &sample, 0); /* skip the frames while braking */
+    if (BUS_Wait(TURN_LineSub, &sample, (2*REF_MEASURE_PERIOD_MS)/portTICK_PERIOD_MS)) {
+      dist = ((int32_t)sample.u.line.value-REF_MIDDLE_LINE_VALUE)*lineSide;
+      if (sample.u.line.kind==REF_LINE_NONE || dist<-TURN_TO_LINE_CENTER_TOL) {
+        errMsg = (const unsigned char*)"overshoot";
+        res = ERR_FAILED;
+      }
+    }
+  }
+#if PL_CONFIG_HAS_SHELL
+  if (errMsg!=NULL) {
+    SHELL_SendString((unsigned char*)"TurnToLine: ");
+    SHELL_SendString((unsigned char*)errMsg);
+    SHELL_SendString((unsigned char*)".\r\n");
+  }
+#endif
+  return res;
+}
+#endif /* TURN_HAS_TO_LINE */
+
 void TURN_Turn(TURN_Kind kind, TURN_StopFct stopIt) {
   switch(kind) {
     case TURN_LEFT45:
@@ -140,6 +400,26 @@ void TURN_Turn(TURN_Kind kind, TURN_StopFct stopIt) {
     case TURN_RIGHT180:
       StepsTurn(2*TURN_Steps90, -(2*TURN_Steps90), stopIt, TURN_STEPS_90_TIMEOUT_MS*2);
      break;
+    case TURN_LEFT45_ARC:
+      TURN_TurnArc(-45, TURN_ArcRadiusMm, stopIt);
+      break;
+    case TURN_LEFT90_ARC:
+      TURN_TurnArc(-90, TURN_ArcRadiusMm, stopIt);
+      break;
+    case TURN_RIGHT45_ARC:
+      TURN_TurnArc(45, TURN_ArcRadiusMm, stopIt);
+      break;
+    case TURN_RIGHT90_ARC:
+      TURN_TurnArc(90, TURN_ArcRadiusMm, stopIt);
+      break;
+#if TURN_HAS_TO_LINE
+    case TURN_LEFT_TO_LINE:
+      (void)TURN_TurnToLine(-TURN_TO_LINE_MAX_ANGLE, stopIt);
+      break;
+    case TURN_RIGHT_TO_LINE:
+      (void)TURN_TurnToLine(TURN_TO_LINE_MAX_ANGLE, stopIt);
+      break;
+#endif
     case TURN_STEP_BORDER_BW:
       StepsTurn(-(3*TURN_StepsLine), -(3*TURN_StepsLine), stopIt, TURN_STEPS_LINE_TIMEOUT_MS);
       break;
@@ -192,17 +472,196 @@ void TURN_TurnAngle(int16_t angle, TURN_StopFct stopIt) {
   }
 }
 
+uint8_t TURN_TurnOntoLine(TURN_Kind kind, TURN_StopFct stopIt) {
+  int16_t angle;
+
+  switch(kind) {
+    case TURN_LEFT90:   angle = -90; break;
+    case TURN_RIGHT90:  angle = 90; break;
+    case TURN_LEFT180:  angle = -180; break;
+    case TURN_RIGHT180: angle = 180; break;
+    default:
+      TURN_Turn(kind, stopIt);
+      return ERR_OK;
+  }
+#if TURN_HAS_TO_LINE
+  /* the line is expected at the angle of the turn: it bounds the turn, with a tolerance for the line and the wheels */
+  return TURN_TurnToLine(angle<0?angle-TURN_TO_LINE_ANGLE_TOL:angle+TURN_TO_LINE_ANGLE_TOL, stopIt);
+#else
+  TURN_TurnAngle(angle, stopIt);
+  TURN_Turn(TURN_STOP, NULL);
+  return ERR_OK;
+#endif
+}
+
+#if PL_CONFIG_HAS_CONFIG_NVM
+static uint8_t TURN_SaveCalib(void) {
+  TURN_CalibData data;
+
+  data.steps90 = TURN_Steps90;
+  data.stepsLine = (uint16_t)TURN_StepsLine;
+  data.stepsPostLine = (uint16_t)TURN_StepsPostLine;
+  return NVMC_SaveTurnData(&data, sizeof(data));
+}
+#endif
+
+#if TURN_HAS_CALIB
+static bool TURN_CalibIsOnLine(void) {
+  return REF_GetLineKind()!=REF_LINE_NONE;
+}
+
+/*!
+ * \brief Waits until the sensors enter a line (no line, then line).
+ * \param timeoutMs Remaining time, gets decremented
+ * \return ERR_OK if a line has been entered, ERR_BUSY for timeout
+ */
+static uint8_t TURN_CalibWaitLine(int32_t *timeoutMs) {
+  bool wasOnLine, onLine;
+
+  wasOnLine = TURN_CalibIsOnLine();
+  for(;;) {
+    FRTOS1_vTaskDelay(DRV_TASK_PERIOD_MS/portTICK_PERIOD_MS);
+    *timeoutMs -= DRV_TASK_PERIOD_MS;
+    onLine = TURN_CalibIsOnLine();
+    if (onLine && !wasOnLine) {
+      return ERR_OK;
+    }
+    wasOnLine = onLine;
+    if (*timeoutMs<=0) {
+      return ERR_BUSY;
+    }
+  }
+}
+
+static void TURN_CalibMove(int32_t speedL, int32_t speedR) {
+  (void)DRV_SetSpeed(speedL, speedR);
+  (void)DRV_SetMode(DRV_MODE_SPEED);
+}
+
+/*!
+ * \brief Spins the robot on the spot over a line cross and counts the steps between the line detections.
+ * As we always count from line edge to line edge, the sensor latency cancels out.
+ * \param nofArms Number of lines going away from the center (4 for a cross, 2 for a single line)
+ * \param steps90 Where to store the steps for a 90 degree turn
+ * \return ERR_OK if everything was fine
+ */
+static uint8_t TURN_CalibSteps90(uint8_t nofArms, int32_t *steps90) {
+  int32_t timeoutMs = TURN_CALIB_TIMEOUT_MS;
+  int32_t startDiff, diff;
+  uint8_t res;
+  int i;
+
+  TURN_CalibMove(-TURN_CALIB_SPEED, TURN_CALIB_SPEED); /* counter-clockwise */
+  res = TURN_CalibWaitLine(&timeoutMs);
+  startDiff = (int32_t)Q4CRight_GetPos()-(int32_t)Q4CLeft_GetPos();
+  for(i=0; i<nofArms*TURN_CALIB_NOF_REVOLUTIONS && res==ERR_OK; i++) {
+    res = TURN_CalibWaitLine(&timeoutMs);
+  }
+  diff = (int32_t)Q4CRight_GetPos()-(int32_t)Q4CLeft_GetPos()-startDiff;
+  (void)DRV_Stop(TURN_STEPS_STOP_TIMEOUT_MS);
+  if (res!=ERR_OK) {
+    return res;
+  }
+  /* each wheel moved diff/2 per revolutions, a quarter of it is 90 degree */
+  *steps90 = (diff+4*TURN_CALIB_NOF_REVOLUTIONS)/(8*TURN_CALIB_NOF_REVOLUTIONS);
+  return ERR_OK;
+}
+
+/*!
+ * \brief Measures the distance between sensor and wheel axle.
+ * The robot drives forward until it detects the line, turns by 180 degree and drives backward until it detects the line again.
+ * From detection to detection the sensor has moved twice the distance to the axle, less the distance the robot
+ * has overrun the line while braking after the first detection. So the overrun is added to the backward travel.
+ * Both detections are at the same speed, so the sensor latency cancels out.
+ * \param stepsLine Where to store the number of steps between sensor and axle
+ * \return ERR_OK if everything was fine
+ */
+static uint8_t TURN_CalibLine(int32_t *stepsLine) {
+  int32_t timeoutMs = TURN_CALIB_TIMEOUT_MS;
+  int32_t detectPos, overrun, startPos, travel;
+  uint8_t res;
+
+  TURN_CalibMove(TURN_CALIB_SPEED, TURN_CALIB_SPEED);
+  res = TURN_CalibWaitLine(&timeoutMs);
+  detectPos = ((int32_t)Q4CLeft_GetPos()+(int32_t)Q4CRight_GetPos())/2;
+  (void)DRV_Stop(TURN_STEPS_STOP_TIMEOUT_MS);
+  if (res!=ERR_OK) {
+    return res;
+  }
+  overrun = ((int32_t)Q4CLeft_GetPos()+(int32_t)Q4CRight_GetPos())/2-detectPos; /* braking distance past the line */
+  TURN_Turn(TURN_LEFT180, NULL);
+  startPos = ((int32_t)Q4CLeft_GetPos()+(int32_t)Q4CRight_GetPos())/2;
+  TURN_CalibMove(-TURN_CALIB_SPEED, -TURN_CALIB_SPEED);
+  res = TURN_CalibWaitLine(&timeoutMs);
+  travel = startPos-((int32_t)Q4CLeft_GetPos()+(int32_t)Q4CRight_GetPos())/2;
+  (void)DRV_Stop(TURN_STEPS_STOP_TIMEOUT_MS);
+  if (res!=ERR_OK) {
+    return res;
+  }
+  *stepsLine = (travel+overrun)/2;
+  return ERR_OK;
+}
+
+static uint8_t TURN_Calibrate(bool isLine, uint8_t nofArms, const CLS1_StdIOType *io) {
+  int32_t steps;
+  uint8_t res;
+
+  if (!REF_IsReady()) {
+    CLS1_SendStr((unsigned char*)"Reflectance sensors not ready (calibrated?)\r\n", io->stdErr);
+    return ERR_FAILED;
+  }
+  if (isLine) {
+    res = TURN_CalibLine(&steps);
+  } else {
+    res = TURN_CalibSteps90(nofArms, &steps);
+  }
+  if (res!=ERR_OK) {
+    CLS1_SendStr((unsigned char*)"Calibration timeout, no line found?\r\n", io->stdErr);
+    return res;
+  }
+  if (isLine) {
+    TURN_StepsLine = steps;
+    CLS1_SendStr((unsigned char*)"steps line: ", io->stdOut);
+  } else {
+    TURN_Steps90 = steps;
+    CLS1_SendStr((unsigned char*)"steps 90: ", io->stdOut);
+  }
+  CLS1_SendNum32s(steps, io->stdOut);
+  CLS1_SendStr((unsigned char*)"\r\n", io->stdOut);
+#if PL_CONFIG_HAS_CONFIG_NVM
+  if (TURN_SaveCalib()!=ERR_OK) {
+    CLS1_SendStr((unsigned char*)"Flashing turn data FAILED!\r\n", io->stdErr);
+    return ERR_FAILED;
+  }
+#endif
+  return ERR_OK;
+}
+#endif /* TURN_HAS_CALIB */
+
 #if PL_CONFIG_HAS_SHELL
 static void TURN_PrintHelp(const CLS1_StdIOType *io) {
   CLS1_SendHelpStr((unsigned char*)"turn", (unsigned char*)"Group of turning commands\r\n", io->stdOut);
   CLS1_SendHelpStr((unsigned char*)"  help|status", (unsigned char*)"Shows turn help or status\r\n", io->stdOut);
   CLS1_SendHelpStr((unsigned char*)"  <angle>", (unsigned char*)"Turn the robot by angle, negative is counter-clockwise, e.g. 'turn -90'\r\n", io->stdOut);
+  CLS1_SendHelpStr((unsigned char*)"  arc <angle>", (unsigned char*)"Rolling turn on an arc, negative is counter-clockwise\r\n", io->stdOut);
+#if TURN_HAS_TO_LINE
+  CLS1_SendHelpStr((unsigned char*)"  toline (left|right)", (unsigned char*)"Turn until the sensors see a centered line\r\n", io->stdOut);
+#endif
+  CLS1_SendHelpStr((unsigned char*)"  arcradius <mm>", (unsigned char*)"Radius for rolling turns\r\n", io->stdOut);
+  CLS1_SendHelpStr((unsigned char*)"  arcspeed <steps/s>", (unsigned char*)"Forward speed for rolling turns, if entering slower\r\n", io->stdOut);
   CLS1_SendHelpStr((unsigned char*)"  forward", (unsigned char*)"Move one step forward\r\n", io->stdOut);
   CLS1_SendHelpStr((unsigned char*)"  forward postline", (unsigned char*)"Move one step forward post the line\r\n", io->stdOut);
   CLS1_SendHelpStr((unsigned char*)"  backward", (unsigned char*)"Move one step backward\r\n", io->stdOut);
   CLS1_SendHelpStr((unsigned char*)"  steps90 <steps>", (unsigned char*)"Number of steps for a 90 degree turn\r\n", io->stdOut);
   CLS1_SendHelpStr((unsigned char*)"  stepsline <steps>", (unsigned char*)"Number of steps for stepping over line\r\n", io->stdOut);
   CLS1_SendHelpStr((unsigned char*)"  stepspostline <steps>", (unsigned char*)"Number of steps for a step post the line\r\n", io->stdOut);
+#if TURN_HAS_CALIB
+  CLS1_SendHelpStr((unsigned char*)"  calib [<arms>]", (unsigned char*)"Calibrate steps90 by spinning over a line cross (default 4 arms)\r\n", io->stdOut);
+  CLS1_SendHelpStr((unsigned char*)"  calib line", (unsigned char*)"Calibrate stepsline by driving over a line in front of the robot\r\n", io->stdOut);
+#endif
+#if PL_CONFIG_HAS_CONFIG_NVM
+  CLS1_SendHelpStr((unsigned char*)"  save", (unsigned char*)"Store step values in NVM\r\n", io->stdOut);
+#endif
 }
 
 static void TURN_PrintStatus(const CLS1_StdIOType *io) {
@@ -221,6 +680,14 @@ static void TURN_PrintStatus(const CLS1_StdIOType *io) {
   UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" steps\r\n");
   CLS1_SendStatusStr((unsigned char*)"  postline", buf, io->stdOut);
 
+  UTIL1_Num32sToStr(buf, sizeof(buf), TURN_ArcRadiusMm);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" mm\r\n");
+  CLS1_SendStatusStr((unsigned char*)"  arc radius", buf, io->stdOut);
+
+  UTIL1_Num32sToStr(buf, sizeof(buf), TURN_ArcSpeed);
+  UTIL1_strcat(buf, sizeof(buf), (unsigned char*)" steps/sec\r\n");
+  CLS1_SendStatusStr((unsigned char*)"  arc speed", buf, io->stdOut);
+
   UTIL1_Num32sToStr(buf, sizeof(buf), Q4CLeft_GetPos());
   UTIL1_strcat(buf, sizeof(buf), (unsigned char*)", ");
   UTIL1_strcatNum16u(buf, sizeof(buf), Q4CLeft_NofErrors());
@@ -266,6 +733,71 @@ uint8_t TURN_ParseCommand(const unsigned char *cmd, bool *handled, const CLS1_St
       CLS1_SendStr((unsigned char*)"Wrong argument\r\n", io->stdErr);
       res = ERR_FAILED;
     }
+  } else if (UTIL1_strncmp((char*)cmd, (char*)"turn arc ", sizeof("turn arc ")-1)==0) {
+    int32_t angle;
+
+    p = cmd+sizeof("turn arc");
+    if (UTIL1_xatoi(&p, &angle)==ERR_OK) {
+      TURN_TurnArc((int16_t)angle, TURN_ArcRadiusMm, NULL);
+      (void)DRV_Stop(TURN_STEPS_STOP_TIMEOUT_MS);
+      *handled = TRUE;
+    } else {
+      CLS1_SendStr((unsigned char*)"Wrong argument\r\n", io->stdErr);
+      res = ERR_FAILED;
+    }
+#if TURN_HAS_TO_LINE
+  } else if (UTIL1_strcmp((char*)cmd, (char*)"turn toline left")==0) {
+    TURN_Turn(TURN_LEFT_TO_LINE, NULL);
+    *handled = TRUE;
+  } else if (UTIL1_strcmp((char*)cmd, (char*)"turn toline right")==0) {
+    TURN_Turn(TURN_RIGHT_TO_LINE, NULL);
+    *handled = TRUE;
+#endif
+  } else if (UTIL1_strncmp((char*)cmd, (char*)"turn arcradius ", sizeof("turn arcradius ")-1)==0) {
+    p = cmd+sizeof("turn arcradius");
+    if (UTIL1_ScanDecimal16uNumber(&p, &val16u)==ERR_OK && val16u>0) {
+      TURN_ArcRadiusMm = val16u;
+      *handled = TRUE;
+    } else {
+      CLS1_SendStr((unsigned char*)"Wrong argument\r\n", io->stdErr);
+      res = ERR_FAILED;
+    }
+  } else if (UTIL1_strncmp((char*)cmd, (char*)"turn arcspeed ", sizeof("turn arcspeed ")-1)==0) {
+    p = cmd+sizeof("turn arcspeed");
+    if (UTIL1_ScanDecimal16uNumber(&p, &val16u)==ERR_OK && val16u>0) {
+      TURN_ArcSpeed = val16u;
+      *handled = TRUE;
+    } else {
+      CLS1_SendStr((unsigned char*)"Wrong argument\r\n", io->stdErr);
+      res = ERR_FAILED;
+    }
+#if TURN_HAS_CALIB
+  } else if (UTIL1_strcmp((char*)cmd, (char*)"turn calib line")==0) {
+    res = TURN_Calibrate(TRUE, 0, io);
+    *handled = TRUE;
+  } else if (UTIL1_strcmp((char*)cmd, (char*)"turn calib")==0) {
+    res = TURN_Calibrate(FALSE, TURN_CALIB_NOF_ARMS, io);
+    *handled = TRUE;
+  } else if (UTIL1_strncmp((char*)cmd, (char*)"turn calib ", sizeof("turn calib ")-1)==0) {
+    uint8_t val8u;
+
+    p = cmd+sizeof("turn calib");
+    if (UTIL1_ScanDecimal8uNumber(&p, &val8u)==ERR_OK && val8u>0) {
+      res = TURN_Calibrate(FALSE, val8u, io);
+      *handled = TRUE;
+    } else {
+      CLS1_SendStr((unsigned char*)"Wrong argument\r\n", io->stdErr);
+      res = ERR_FAILED;
+    }
+#endif
+#if PL_CONFIG_HAS_CONFIG_NVM
+  } else if (UTIL1_strcmp((char*)cmd, (char*)"turn save")==0) {
+    if (TURN_SaveCalib()!=ERR_OK) {
+      CLS1_SendStr((unsigned char*)"Flashing turn data FAILED!\r\n", io->stdErr);
+      res = ERR_FAILED;
+    }
+    *handled = TRUE;
+#endif
   } else if (UTIL1_strcmp((char*)cmd, (char*)"turn forward postline")==0) {
     TURN_Turn(TURN_STEP_LINE_FW_POST_LINE, NULL);
     TURN_Turn(TURN_STOP, NULL);
@@ -314,8 +846,28 @@ void TURN_Deinit(void) {
 }
 
 void TURN_Init(void) {
+#if PL_CONFIG_HAS_CONFIG_NVM
+  TURN_CalibData *data;
+#endif
+
   TURN_Steps90 = TURN_STEPS_90;
   TURN_StepsPostLine = TURN_STEPS_POST_LINE;
   TURN_StepsLine = TURN_STEPS_LINE;
+#if PL_CONFIG_HAS_CONFIG_NVM
+  data = (TURN_CalibData*)NVMC_GetTurnData();
+  if (data!=NULL && data->steps90>0) { /* use calibrated values */
+    TURN_Steps90 = data->steps90;
+    TURN_StepsLine = data->stepsLine;
+    TURN_StepsPostLine = data->stepsPostLine;
+  }
+#endif
+  TURN_ArcRadiusMm = TURN_ARC_RADIUS_MM;
+  TURN_ArcSpeed = TURN_ARC_SPEED;
+#if TURN_HAS_TO_LINE
+  TURN_LineSub = BUS_Subscribe(BUS_TOPIC_LINE, NULL);
+  if (TURN_LineSub==NULL) {
+    for(;;){} /* out of subscribers */
+  }
+#endif
 }
 #endif /* PL_CONFIG_HAS_TURN */
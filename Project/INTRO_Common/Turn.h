@@ -19,6 +19,8 @@ typedef enum {
   TURN_RIGHT90, /* turn 90 degree right and stop */
   TURN_LEFT180, /* turn 180 degree counterclockwise and stop */
   TURN_RIGHT180, /* turn 180 degree clockwise and stop */
+  TURN_LEFT_TO_LINE,  /* turn left until the sensors see a centered line, and stop */
+  TURN_RIGHT_TO_LINE, /* turn right until the sensors see a centered line, and stop */
   TURN_STRAIGHT, /* don't turn */
   TURN_STEP_LINE_FW, /* make a step forward over the line */
   TURN_STEP_LINE_FW_POST_LINE, /* make a step forward over the line and post the line for a turn */
@@ -30,7 +32,11 @@ typedef enum {
   TURN_FINISHED, /* stepped into finish! */
   TURN_STOP_LEFT,   /* stop left motor */
   TURN_STOP_RIGHT,  /* stop right motor */
-  TURN_STOP     /* stop */
+  TURN_STOP,     /* stop */
+  TURN_LEFT45_ARC,  /* rolling 45 degree left turn on an arc, exits moving straight */
+  TURN_LEFT90_ARC,  /* rolling 90 degree left turn on an arc, exits moving straight */
+  TURN_RIGHT45_ARC, /* rolling 45 degree right turn on an arc, exits moving straight */
+  TURN_RIGHT90_ARC  /* rolling 90 degree right turn on an arc, exits moving straight */
 } TURN_Kind;
 
 /*! \brief Callback type function to stop process or turning */
@@ -64,6 +70,37 @@ void TURN_MoveToPos(int32_t targetLPos, int32_t targetRPos, bool wait, TURN_Stop
  */
 void TURN_TurnAngle(int16_t angle, TURN_StopFct stopIt);
 
+/*!
+ * \brief Rolling turn on an arc, without stopping. The robot accelerates from its current forward speed
+ * to the arc speed (at least the current speed), and the heading rate is ramped up and down with limited
+ * acceleration, so the wheels never get a speed step. After the turn the robot keeps moving straight.
+ * \param angle Angle, negative angle means left turn, positive means right turn
+ * \param radiusMm Radius of the arc (at the center between the wheels) in mm
+ * \param stopIt Callback to stop turning, or NULL.
+ */
+void TURN_TurnArc(int16_t angle, int32_t radiusMm, TURN_StopFct stopIt);
+
+/*!
+ * \brief Turns on the spot until the reflectance sensors see a centered line. The robot leaves the current line first.
+ * The decision is taken for every new sensor frame. With the turning rate measured by the tacho and the steps
+ * turned per line position since the line has been seen first, it starts to decelerate early so it stops aligned on the line.
+ * \param maxAngle Maximum angle to turn, negative means left turn, positive means right turn
+ * \param stopIt Callback to stop turning, or NULL.
+ * \return ERR_OK if stopped on a centered line, ERR_FAILED if the maximum angle has been reached, the line has been lost
+ *   or the robot has stopped past the middle of the line, ERR_BUSY if stopped by the callback.
+ */
+uint8_t TURN_TurnToLine(int16_t maxAngle, TURN_StopFct stopIt);
+
+/*!
+ * \brief Turns on the spot by 90 or 180 degree onto the line there, for a turn at an intersection or a U turn.
+ * With line sensing it turns to the line, with the angle of the turn as bound, else it turns by the angle.
+ * Other kinds are passed to TURN_Turn().
+ * \param kind TURN_LEFT90, TURN_RIGHT90, TURN_LEFT180 or TURN_RIGHT180
+ * \param stopIt Callback to stop turning, or NULL.
+ * \return ERR_OK if the robot stopped on the line, error code of TURN_TurnToLine() otherwise.
+ */
+uint8_t TURN_TurnOntoLine(TURN_Kind kind, TURN_StopFct stopIt);
+
 #if PL_CONFIG_HAS_SHELL
 #include "CLS1.h"
 /*!
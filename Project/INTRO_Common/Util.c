@@ -0,0 +1,27 @@
+/**
+ * \file
+ * \brief Small helpers shared by the modules.
+ *
+ * The square root works bit by bit, without division, as the Cortex-M0+ has no divide instruction.
+ */
+
+#include "Platform.h"
+#include "Util.h"
+
+uint32_t UTIL_ISqrt(uint32_t val) {
+  uint32_t res = 0, bit = 1UL<<30;
+
+  while (bit>val) {
+    bit >>= 2;
+  }
+  while (bit!=0) {
+    if (val>=res+bit) {
+      val -= res+bit;
+      res = (res>>1)+bit;
+    } else {
+      res >>= 1;
+    }
+    bit >>= 2;
+  }
+  return res;
+}
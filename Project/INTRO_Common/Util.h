@@ -0,0 +1,20 @@
+/**
+ * \file
+ * \brief Small helpers shared by the modules.
+ *
+ * Integer arithmetic used by several modules, e.g. for speed profiles (v=sqrt(2*a*s)).
+ */
+
+#ifndef UTIL_H_
+#define UTIL_H_
+
+#include "Platform.h"
+
+/*!
+ * \brief Integer square root, rounded down.
+ * \param val Value
+ * \return floor(sqrt(val))
+ */
+uint32_t UTIL_ISqrt(uint32_t val);
+
+#endif /* UTIL_H_ */
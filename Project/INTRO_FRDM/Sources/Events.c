@@ -139,6 +139,9 @@ void FRTOS1_vApplicationIdleHook(void)
   /* Called whenever the RTOS is idle (from the IDLE task).
      Here would be a good place to put the CPU into low power mode. */
   /* Write your code here ... */
+#if PL_CONFIG_HAS_LOW_POWER
+  LP_EnterLowPower();
+#endif
 }
 
 /*
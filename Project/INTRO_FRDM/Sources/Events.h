@@ -74,6 +74,7 @@
 #include "KIN1.h"
 
 #include "Trigger.h"
+#include "LowPower.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -100,6 +100,7 @@
 #include "HF1.h"
 #include "CS1.h"
 #include "Trigger.h"
+#include "LowPower.h"
 
 #ifdef __cplusplus
 extern "C" {
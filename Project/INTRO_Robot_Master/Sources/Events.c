@@ -99,8 +99,7 @@ void FRTOS1_vApplicationTickHook(void)
   /* Called for every RTOS tick. */
   /* Write your code here ... */
 	TRG_AddTick();
-	TMR_OnInterrupt();
-	TACHO_Sample();
+	TMR_OnInterrupt(); /* samples the tacho */
 }
 
 /*
@@ -120,6 +119,9 @@ void FRTOS1_vApplicationIdleHook(void)
   /* Called whenever the RTOS is idle (from the IDLE task).
      Here would be a good place to put the CPU into low power mode. */
   /* Write your code here ... */
+#if PL_CONFIG_HAS_LOW_POWER
+  LP_EnterLowPower();
+#endif
 }
 
 /*
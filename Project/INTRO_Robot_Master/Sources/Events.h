@@ -109,6 +109,7 @@
 
 #include "Timer.h"
 #include "Trigger.h"
+#include "LowPower.h"
 
 #ifdef __cplusplus
 extern "C" {